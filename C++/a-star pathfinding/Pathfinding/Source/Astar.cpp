@@ -8,84 +8,127 @@
 
 using namespace AStar;
 
-int g_bounds = 0;
+//octile step costs are 1 and 1.414, so a bucket this wide rarely holds more than a handful of nodes
+static const float BUCKET_WIDTH = 0.5f;
 
-AStar::AStarNode::AStarNode(Point p, AStarNode* p_ptr, float f, float g, OnList list):
-  fcost(f), gcost(g), parent(p_ptr), pos(p), whichlist(list)
+AStar::AStarNode::AStarNode(float f, float g, uint32_t p, OnList list):
+  fcost(f), gcost(g), parent(p), queueIndex(-1), generation(0), whichlist(list)
 {
 }
 
-AStar::OpenList::OpenList() : last(0)
+AStar::OpenList::OpenList(QueueType type) : 
+  queueType(type),
+  arity(type == QuaternaryHeap ? 4 : 2),
+  last(0),
+  width(0),
+  lowestBucket(0),
+  highestBucket(-1),
+  generation(1),
+  debugColors(true)
 {
-  //initialize all to nullptr
-  for (size_t i = 0; i < openList.size(); ++i)
-  {
-    openList[i] = nullptr;
-  }
 }
 
-AStar::AStarNode* AStar::OpenList::PopCheapest()
+uint32_t AStar::OpenList::PopCheapest()
 {
-  //find lowest cost
-  unsigned min = 0;
-  for (int i = 0; i < last; ++i)
-  {
-    if (openList[i]->fcost < openList[min]->fcost)
-    {
-      min = i;
-    }
-  }
-
-  //swap the cheapest with current last element
-  std::swap(openList[min], openList[--last]);
+  //take the cheapest index off the queue
+  int actualIndex = (queueType == BucketQueue) ? BucketPop() : HeapPop();
 
   //remove from openlist
-  openList[last]->whichlist = Closed;
-  g_terrain.SetColor(openList[last]->pos.r, openList[last]->pos.c, DEBUG_COLOR_YELLOW);
+  nodes[actualIndex].whichlist = Closed;
+  if (debugColors)
+    g_terrain.SetColor(actualIndex / width, actualIndex % width, DEBUG_COLOR_YELLOW);
+
+  //return index of cheapest node from nodes
+  return actualIndex;
+}
+
+AStar::AStarNode& AStar::OpenList::operator[](uint32_t index)
+{
+  //a node left over from an earlier search is reset the first time it is looked at
+  AStarNode& node = nodes[index];
+  if (node.generation != generation)
+  {
+    node = AStarNode();
+    node.generation = generation;
+  }
+  return node;
+}
 
-  //return pointer to cheapest node from nodes
-  int actualIndex = openList[last]->pos.singleIndex();
-  return &nodes[actualIndex];
+uint32_t AStar::OpenList::IndexOf(const Point & pos) const
+{
+  return (pos.r * width) + pos.c;
 }
 
-AStar::AStarNode* AStar::OpenList::find(const Point & pos)
+Point AStar::OpenList::PointOf(uint32_t index) const
 {
-  int actualIndex = pos.singleIndex();
-  return &nodes[actualIndex];
+  return Point(index / width, index % width);
 }
 
-void AStar::OpenList::UpdateCost(AStarNode* node, AStarNode* p_ptr, float newf, float newg)
+void AStar::OpenList::UpdateCost(uint32_t index, uint32_t parent, float newf, float newg)
 {
-  //update cost and parent ptr if its cheaper
-  if (newf < node->fcost)
+  AStarNode& node = nodes[index];
+
+  //update cost and parent if its cheaper
+  if (newf < node.fcost)
   {
-    node->fcost = newf;
-    node->gcost = newg;
-    node->parent = p_ptr;
+    //a bucket is keyed on fcost, so pull the node out before the cost changes
+    if (queueType == BucketQueue)
+      BucketRemove(index);
+
+    node.fcost = newf;
+    node.gcost = newg;
+    node.parent = parent;
+
+    //decrease-key, the node can only move towards the front
+    if (queueType == BucketQueue)
+      BucketInsert(index);
+    else
+      SiftUp(node.queueIndex);
   }
 }
 
-void AStar::OpenList::push(const AStarNode & node)
+void AStar::OpenList::push(const Point & pos, uint32_t parent, float f, float g)
 {
   //add to openlist
-  g_terrain.SetColor(node.pos.r, node.pos.c, DEBUG_COLOR_BLUE);
+  if (debugColors)
+    g_terrain.SetColor(pos.r, pos.c, DEBUG_COLOR_BLUE);
 
   //add to list of nodes
-  int actualIndex = node.pos.singleIndex();
-  nodes[actualIndex] = node;
-
-  //add pointer to stored node to openlist
-  openList[last] = &nodes[actualIndex];
+  int actualIndex = IndexOf(pos);
+  nodes[actualIndex] = AStarNode(f, g, parent, Open);
+  nodes[actualIndex].generation = generation;
 
-  //increment end
-  ++last;
+  //add index of stored node to the queue
+  if (queueType == BucketQueue)
+    BucketInsert(actualIndex);
+  else
+    HeapInsert(actualIndex);
 }
 
 void AStar::OpenList::clear()
 {
+  //only the buckets this search used can still hold nodes, keep their storage around
+  for (int i = lowestBucket; i <= highestBucket; ++i)
+    buckets[i].clear();
   last = 0;
-  //std::fill(openList.begin(), openList.end(), nullptr);
+  lowestBucket = 0;
+  highestBucket = -1;
+
+  //bumping the stamp makes every node stale, wipe them for real only when it wraps
+  if (++generation == 0)
+    reset();
+}
+
+void AStar::OpenList::reset()
+{
+  for (size_t i = 0; i < buckets.size(); ++i)
+    buckets[i].clear();
+  last = 0;
+  lowestBucket = 0;
+  highestBucket = -1;
+
   std::fill(nodes.begin(), nodes.end(), AStarNode());
+  generation = 1;
 }
 
 bool AStar::OpenList::empty() const
@@ -93,6 +136,178 @@ bool AStar::OpenList::empty() const
   return !last;
 }
 
+void AStar::OpenList::Resize(int w)
+{
+  //only reallocate when the map size changes, a node and a heap slot per cell
+  if (w == width)
+    return;
+
+  width = w;
+  size_t cells = static_cast<size_t>(w) * w;
+  //swap in fresh storage so a smaller map gives the memory back
+  std::vector<AStarNode>(cells).swap(nodes);
+  std::vector<int>(cells, -1).swap(openList);
+  last = 0;
+  lowestBucket = 0;
+  highestBucket = -1;
+  buckets.clear();
+  generation = 1;
+}
+
+AStar::QueueType AStar::OpenList::GetQueueType() const
+{
+  return queueType;
+}
+
+bool AStar::OpenList::WasVisited(uint32_t index) const
+{
+  //pushed or expanded by the current search
+  return nodes[index].generation == generation;
+}
+
+void AStar::OpenList::SetDebugColors(bool enable)
+{
+  debugColors = enable;
+}
+
+bool AStar::OpenList::GetDebugColors() const
+{
+  return debugColors;
+}
+
+bool AStar::OpenList::Cheaper(int lhs, int rhs) const
+{
+  const AStarNode& l = nodes[lhs];
+  const AStarNode& r = nodes[rhs];
+  if (l.fcost != r.fcost)
+    return l.fcost < r.fcost;
+
+  //on a tie prefer the node furthest from the start, it is usually closer to the goal
+  return l.gcost > r.gcost;
+}
+
+void AStar::OpenList::SiftUp(int pos)
+{
+  int actualIndex = openList[pos];
+  while (pos > 0)
+  {
+    int parent = (pos - 1) / arity;
+    if (!Cheaper(actualIndex, openList[parent]))
+      break;
+
+    //move parent down into the hole
+    openList[pos] = openList[parent];
+    nodes[openList[pos]].queueIndex = pos;
+    pos = parent;
+  }
+  openList[pos] = actualIndex;
+  nodes[actualIndex].queueIndex = pos;
+}
+
+void AStar::OpenList::SiftDown(int pos)
+{
+  int actualIndex = openList[pos];
+  while (1)
+  {
+    int first = (pos * arity) + 1;
+    if (first >= last)
+      break;
+
+    //find the cheapest child
+    int end = (std::min)(first + arity, last);
+    int best = first;
+    for (int child = first + 1; child < end; ++child)
+    {
+      if (Cheaper(openList[child], openList[best]))
+        best = child;
+    }
+
+    if (!Cheaper(openList[best], actualIndex))
+      break;
+
+    //move child up into the hole
+    openList[pos] = openList[best];
+    nodes[openList[pos]].queueIndex = pos;
+    pos = best;
+  }
+  openList[pos] = actualIndex;
+  nodes[actualIndex].queueIndex = pos;
+}
+
+void AStar::OpenList::HeapInsert(int index)
+{
+  openList[last] = index;
+  SiftUp(last);
+  ++last;
+}
+
+int AStar::OpenList::HeapPop()
+{
+  int cheapest = openList[0];
+
+  //move the last element to the root and restore the heap
+  --last;
+  if (last > 0)
+  {
+    openList[0] = openList[last];
+    SiftDown(0);
+  }
+  return cheapest;
+}
+
+int AStar::OpenList::BucketOf(float fcost) const
+{
+  int bucket = static_cast<int>(fcost / BUCKET_WIDTH);
+  return (std::max)(bucket, 0);
+}
+
+void AStar::OpenList::BucketInsert(int index)
+{
+  int bucket = BucketOf(nodes[index].fcost);
+  if (bucket >= static_cast<int>(buckets.size()))
+    buckets.resize(bucket + 1);
+
+  //weighted heuristics are not consistent, so a new node can land below the cursor
+  if (!last || bucket < lowestBucket)
+    lowestBucket = bucket;
+  highestBucket = (std::max)(highestBucket, bucket);
+
+  nodes[index].queueIndex = static_cast<int>(buckets[bucket].size());
+  buckets[bucket].push_back(index);
+  ++last;
+}
+
+void AStar::OpenList::BucketRemove(int index)
+{
+  std::vector<int>& bucket = buckets[BucketOf(nodes[index].fcost)];
+
+  //swap with the back of the bucket and shrink
+  int pos = nodes[index].queueIndex;
+  bucket[pos] = bucket.back();
+  nodes[bucket[pos]].queueIndex = pos;
+  bucket.pop_back();
+  --last;
+}
+
+int AStar::OpenList::BucketPop()
+{
+  //advance to the first non-empty bucket
+  while (buckets[lowestBucket].empty())
+    ++lowestBucket;
+
+  //every node in a lower bucket is cheaper, so the cheapest in this bucket is the global minimum
+  std::vector<int>& bucket = buckets[lowestBucket];
+  int cheapest = bucket[0];
+  for (size_t i = 1; i < bucket.size(); ++i)
+  {
+    if (Cheaper(bucket[i], cheapest))
+      cheapest = bucket[i];
+  }
+
+  BucketRemove(cheapest);
+  return cheapest;
+}
+
 std::ostream & AStar::operator<<(std::ostream & out, const Point & p)
 {
   out << "(" << static_cast<int>(p.r) << ", " << static_cast<int>(p.c) << ")" << std::endl;
@@ -143,11 +358,6 @@ bool AStar::Point::operator!=(const Point & p) const
   return (r != p.r) || (c != p.c);
 }
 
-bool AStar::Point::inBounds() const
-{
-  return r >= 0 && r < g_bounds && c >= 0 && c < g_bounds;
-}
-
 /*
 inline int AStar::Point::row() const
 {
@@ -160,11 +370,6 @@ inline int AStar::Point::col() const
 }
 */
 
-inline int AStar::Point::singleIndex() const
-{
-  return (r * g_bounds) + c;
-}
-
 float AStar::MovementAlgo::GetHCost(const Point& currPos, const Point& endPos)
 {
   float rdiff = std::abs(static_cast<float>(endPos.r - currPos.r));
@@ -198,8 +403,11 @@ float AStar::MovementAlgo::GetHCost(const Point& currPos, const Point& endPos)
 
 AStar::MovementAlgo::MovementAlgo():
   heur(Octile),
+  algorithm(AStarSearch),
   h_weight(0.f),
-  isSingleStep(false)
+  isSingleStep(false),
+  bounds(0),
+  nodesExpanded(0)
 {
   float diagCost = sqrtf(2.f);                                       //coordinate system is row, col
   directions[0] = std::make_pair(Point(1, 0), 1.f);                  //up
@@ -212,101 +420,272 @@ AStar::MovementAlgo::MovementAlgo():
   directions[7] = std::make_pair(Point(-1, -1), diagCost);           //down_left
 }
 
-bool AStar::MovementAlgo::PathFind(WaypointList & path)
+bool AStar::MovementAlgo::PathFind(WaypointList & path, unsigned maxExpansions)
 {
   Terrain& terrain = g_terrain;
-  MovementAlgo& g_algo = g_movement_algo;
+
+  //returns false once the budget is spent, the open list keeps the search for the next call
+  unsigned budget = isSingleStep ? 1 : maxExpansions;
+  unsigned expanded = 0;
 
   while (!openlist.empty())
   {
-    AStarNode* current = openlist.PopCheapest();
-    
-    if (current->pos == goal) //if startnode is the goal
+    uint32_t currentIndex = openlist.PopCheapest();
+    Point currentPos = openlist.PointOf(currentIndex);
+    ++nodesExpanded;
+
+    if (currentPos == goal) //if startnode is the goal
     {
-      //follow parent pointer back to start from goal and add
-      int curR, curC;
+      //follow parent index back to start from goal and add, then turn the new points around
       D3DXVECTOR3 spot;
-      AStarNode* next = current;
-      while (next != nullptr)
+      size_t first = path.size();
+      uint32_t next = currentIndex;
+      while (next != NO_PARENT)
       {
-        curR = next->pos.r;
-        curC = next->pos.c;
-        spot = terrain.GetCoordinates(curR, curC);
-        path.push_front(spot);
-        next = next->parent;
+        Point nextPos = openlist.PointOf(next);
+        uint32_t parent = openlist[next].parent;
+        spot = terrain.GetCoordinates(nextPos.r, nextPos.c);
+        path.push_back(spot);
+
+        //jump points can be several tiles apart, fill in the straight or diagonal run between them
+        if (parent != NO_PARENT)
+        {
+          Point parentPos = openlist.PointOf(parent);
+          Point step((parentPos.r > nextPos.r) - (parentPos.r < nextPos.r),
+                     (parentPos.c > nextPos.c) - (parentPos.c < nextPos.c));
+          for (Point tile = nextPos + step; tile != parentPos; tile += step)
+          {
+            spot = terrain.GetCoordinates(tile.r, tile.c);
+            path.push_back(spot);
+          }
+        }
+        next = parent;
       }
+      std::reverse(path.begin() + first, path.end());
       return true;
     }
+    else if (algorithm == JumpPointSearch)
+    {
+      ExpandJumpPoints(currentIndex, currentPos);
+    }
+    else if (algorithm == JumpPointSearchPlus)
+    {
+      ExpandJumpPointsPlus(currentIndex, currentPos);
+    }
     else
     {
-      Point neighbour;
-      //add neighbours if they are valid
-      for (unsigned i = 0; i < 8; ++i)
-      {
-        //diagonal correctness check
-        if (i >= 4 && isDiagonalsWalls(current->pos, directions[i].first))
-          continue;
-
-        //who are my neighbours?
-        neighbour = current->pos + directions[i].first;
-
-        //if neighbour is out of map or is a wall, do not add
-        if (!neighbour.inBounds()) continue;
-        if (terrain.IsWall(neighbour.r, neighbour.c)) continue;
-
-        //if node is on the closed list skip
-        AStarNode* nptr = openlist.find(neighbour);
-        if (nptr->whichlist == Closed) continue;        //comment if heuristic is not stable
-
-        //compute total cost of node
-        float hcost = h_weight * GetHCost(neighbour, goal);
-        float gcost = current->gcost + directions[i].second;
-        float fcost = hcost + gcost;
-
-        //if this node is not in open or closed list, add as new node
-        if (nptr->whichlist == None)
-        {
-          openlist.push(AStarNode(neighbour, current, fcost, gcost, Open));
-        }
-        else
-        {
-          openlist.UpdateCost(nptr, current, fcost, gcost);
-        }
-      }
+      ExpandNeighbours(currentIndex, currentPos);
     }
-    //if singlestep break out of the while loop
-    if (isSingleStep) return false;
+    //if singlestep or out of budget break out of the while loop
+    if (budget && ++expanded >= budget) return false;
   }
 
   //if unable to find path just push start node
   if (openlist.empty())
   {
     D3DXVECTOR3 spot = terrain.GetCoordinates(start.r, start.c);
-    path.push_front(spot);
+    path.insert(path.begin(), spot);
   }
   return true;
 }
 
-bool AStar::MovementAlgo::StraightLineCheck(const Point& start, const Point & end)
+void AStar::MovementAlgo::ExpandNeighbours(uint32_t index, const Point & pos)
 {
   Terrain& terrain = g_terrain;
+  Point neighbour;
+
+  //add neighbours if they are valid
+  for (unsigned i = 0; i < 8; ++i)
+  {
+    //diagonal correctness check
+    if (i >= 4 && isDiagonalsWalls(pos, directions[i].first))
+      continue;
+
+    //who are my neighbours?
+    neighbour = pos + directions[i].first;
+
+    //if neighbour is out of map or is a wall, do not add
+    if (!InBounds(neighbour)) continue;
+    if (terrain.IsWall(neighbour.r, neighbour.c)) continue;
+
+    AddSuccessor(index, neighbour, directions[i].second);
+  }
+}
+
+void AStar::MovementAlgo::ExpandJumpPoints(uint32_t index, const Point & pos)
+{
+  Point travel = TravelDirection(index, pos);
+
+  for (unsigned i = 0; i < 8; ++i)
+  {
+    const Point& dir = directions[i].first;
+    if (IsPrunedDirection(pos, travel, dir))
+      continue;
+
+    Point jumpPoint;
+    if (!Jump(pos, dir, jumpPoint))
+      continue;
+
+    //the run to a jump point is a straight or diagonal line
+    int steps = (std::max)(std::abs(jumpPoint.r - pos.r), std::abs(jumpPoint.c - pos.c));
+    AddSuccessor(index, jumpPoint, steps * directions[i].second);
+  }
+}
+
+void AStar::MovementAlgo::ExpandJumpPointsPlus(uint32_t index, const Point & pos)
+{
+  const JumpDistances& jumps = g_terrain.GetJumpDistances()[pos.r][pos.c];
+  Point travel = TravelDirection(index, pos);
 
-  //return true if no walls
-  Point delta = end - start;
-  char r_sign = (delta.r > 0) ? 1 : -1;
-  char c_sign = (delta.c > 0) ? 1 : -1;
-  char r_end = delta.r + r_sign;
-  char c_end = delta.c + c_sign;
+  int rdiff = goal.r - pos.r;
+  int cdiff = goal.c - pos.c;
 
-  for (char i = 0; i != r_end; i += r_sign)
+  for (unsigned i = 0; i < 8; ++i)
   {
-    for (char j = 0; j != c_end; j += c_sign)
+    const Point& dir = directions[i].first;
+    if (IsPrunedDirection(pos, travel, dir))
+      continue;
+
+    int dist = jumps.m_dist[i];
+    int reach = std::abs(dist);
+
+    if (dir.r == 0 || dir.c == 0)
+    {
+      //goal straight ahead and no wall before it
+      int along = dir.r ? rdiff * dir.r : cdiff * dir.c;
+      int across = dir.r ? cdiff : rdiff;
+      if (across == 0 && along > 0 && along <= reach)
+      {
+        AddSuccessor(index, goal, static_cast<float>(along));
+        continue;
+      }
+    }
+    else
     {
-      if (terrain.IsWall(start.r + i, start.c + j))
-        return false;
+      //goal in this quadrant, stop where the goal's row or column is reached
+      int rsteps = rdiff * dir.r;
+      int csteps = cdiff * dir.c;
+      int steps = (std::min)(rsteps, csteps);
+      if (rsteps > 0 && csteps > 0 && steps <= reach)
+      {
+        AddSuccessor(index, pos + Point(dir.r * steps, dir.c * steps), steps * directions[i].second);
+        continue;
+      }
     }
+
+    if (dist > 0)
+      AddSuccessor(index, pos + Point(dir.r * dist, dir.c * dist), dist * directions[i].second);
   }
-  return true;
+}
+
+//direction of the run into this node, (0, 0) for the start node
+AStar::Point AStar::MovementAlgo::TravelDirection(uint32_t index, const Point & pos)
+{
+  uint32_t parent = openlist[index].parent;
+  Point from = (parent == NO_PARENT) ? pos : openlist.PointOf(parent);
+  return Point((pos.r > from.r) - (pos.r < from.r), (pos.c > from.c) - (pos.c < from.c));
+}
+
+//Only natural and forced neighbours are kept, diagonals never cutting corners.
+//A diagonal run keeps going diagonally and along its two straight parts, it
+//has no forced neighbours since a wall beside it would have stopped it. A
+//straight run keeps going forward, and turns to a side (straight or forward
+//diagonally) only where that side opens up after a wall it just passed.
+bool AStar::MovementAlgo::IsPrunedDirection(const Point & pos, const Point & travel, const Point & dir)
+{
+  if (travel == Point(0, 0) || dir == travel)
+    return false;
+
+  if (travel.r && travel.c)
+    return (dir.r != 0 && dir.r != travel.r) || (dir.c != 0 && dir.c != travel.c);
+
+  int along = dir.r * travel.r + dir.c * travel.c;
+  if (along < 0)
+    return true;
+
+  Point side(dir.r - along * travel.r, dir.c - along * travel.c);
+  return !IsWalkable(pos + side) || IsWalkable(pos - travel + side);
+}
+
+bool AStar::MovementAlgo::Jump(const Point & from, const Point & dir, Point & jumpPoint)
+{
+  bool diagonal = dir.r && dir.c;
+  Point pos = from;
+
+  while (1)
+  {
+    Point next = pos + dir;
+
+    //walls end the run, diagonals may not cut corners
+    if (!IsWalkable(next))
+      return false;
+    if (diagonal && (!IsWalkable(Point(next.r, pos.c)) || !IsWalkable(Point(pos.r, next.c))))
+      return false;
+
+    if (next == goal)
+    {
+      jumpPoint = next;
+      return true;
+    }
+
+    if (diagonal)
+    {
+      //a diagonal stops wherever one of its straight components finds something
+      Point ignored;
+      if (Jump(next, Point(dir.r, 0), ignored) || Jump(next, Point(0, dir.c), ignored))
+      {
+        jumpPoint = next;
+        return true;
+      }
+    }
+    else
+    {
+      //forced neighbour, a side opens up next to a wall we just passed
+      Point side(dir.c, dir.r);
+      if ((IsWalkable(next + side) && !IsWalkable(pos + side)) ||
+          (IsWalkable(next - side) && !IsWalkable(pos - side)))
+      {
+        jumpPoint = next;
+        return true;
+      }
+    }
+
+    pos = next;
+  }
+}
+
+void AStar::MovementAlgo::AddSuccessor(uint32_t parent, const Point & pos, float stepCost)
+{
+  //if node is on the closed list skip
+  uint32_t nIndex = openlist.IndexOf(pos);
+  OnList nList = openlist[nIndex].whichlist;
+  if (nList == Closed) return;        //comment if heuristic is not stable
+
+  //compute total cost of node
+  float hcost = h_weight * GetHCost(pos, goal);
+  float gcost = openlist[parent].gcost + stepCost;
+  float fcost = hcost + gcost;
+
+  //if this node is not in open or closed list, add as new node
+  if (nList == None)
+  {
+    openlist.push(pos, parent, fcost, gcost);
+  }
+  else
+  {
+    openlist.UpdateCost(nIndex, parent, fcost, gcost);
+  }
+}
+
+bool AStar::MovementAlgo::IsWalkable(const Point & pt)
+{
+  return InBounds(pt) && !g_terrain.IsWall(pt.r, pt.c);
+}
+
+bool AStar::MovementAlgo::StraightLineCheck(const Point& start, const Point & end)
+{
+  //return true if no walls, only the cells the segment touches are looked at
+  return g_terrain.IsClearPath(start.r, start.c, end.r, end.c);
 }
 
 bool AStar::MovementAlgo::isDiagonalsWalls(const Point & pt, const Point & dir)
@@ -314,140 +693,121 @@ bool AStar::MovementAlgo::isDiagonalsWalls(const Point & pt, const Point & dir)
   Point pt1 = pt + Point(dir.r, 0);
   Point pt2 = pt + Point(0, dir.c);
 
-  bool diag1 = pt1.inBounds() && g_terrain.IsWall(pt1.r, pt1.c);
-  bool diag2 = pt2.inBounds() && g_terrain.IsWall(pt2.r, pt2.c);
+  bool diag1 = InBounds(pt1) && g_terrain.IsWall(pt1.r, pt1.c);
+  bool diag2 = InBounds(pt2) && g_terrain.IsWall(pt2.r, pt2.c);
 
   return diag1 || diag2;
 }
 
+bool AStar::MovementAlgo::InBounds(const Point & pt) const
+{
+  return pt.r >= 0 && pt.r < bounds && pt.c >= 0 && pt.c < bounds;
+}
+
 
 void AStar::MovementAlgo::RubberbandPath(WaypointList& list)
 {
-  using LIter = WaypointList::iterator;
   Terrain& terrain = g_terrain;
 
   //if less than 3 points no need to rubberband
   if (list.size() < 3) return;
 
-  //starting from the end of the list, check the middle node
-  LIter front = list.begin();  
-  LIter middle = list.begin(); ++middle;
-  LIter back = list.begin(); std::advance(back, 2);
+  //kept points are packed to the front of the list, front is the last one kept
+  size_t front = 0;
+  size_t middle = 1;
+  int r1, c1;
+  terrain.GetRowColumn(&list[front], &r1, &c1);
 
-  while (back != list.end())
+  for (size_t back = 2; back < list.size(); ++back)
   {
-    int r1, c1, r2, c2;
-    terrain.GetRowColumn(&(*front), &r1, &c1);
-    terrain.GetRowColumn(&(*back), &r2, &c2);
-    Point first(r1, c1); Point last(r2, c2);
+    int r2, c2;
+    terrain.GetRowColumn(&list[back], &r2, &c2);
 
-    //if no walls, remove the middle node
-    if (StraightLineCheck(first, last))
-    {
-      list.erase(middle);
-      middle = back;
-      ++back;
-    }
-    //move all 3 iterators forward
-    else
+    //if walls, keep the middle node and check from there
+    if (!StraightLineCheck(Point(r1, c1), Point(r2, c2)))
     {
-      ++front; ++middle; ++back;
+      list[++front] = list[middle];
+      terrain.GetRowColumn(&list[front], &r1, &c1);
     }
+    middle = back;
   }
+  list[++front] = list[middle];
+  list.resize(front + 1);
 }
 
 void AStar::MovementAlgo::SmoothPath(WaypointList& list)
 {
-  using LIter = WaypointList::iterator;
   //cant smooth if less than 2 points
   if (list.size() < 2) return;
 
-  LIter first = list.begin();
-  LIter last = list.end(); --last;
-  LIter p1, p2, p3, p4;
-  p1 = p2 = p3 = p4 = first;
+  //3 catmullrom points between every pair, written to the scratch buffer in one pass
+  size_t last = list.size() - 1;
+  scratch.clear();
+  scratch.reserve(last * 4 + 1);
 
-  //set p1 p2 p3 p4 based on list size
-  if (list.size() == 2)
-  {
-    p3 = std::next(p3, 1);
-    p4 = std::next(p4, 1);
-  }
-  else
+  for (size_t i = 0; i < last; ++i)
   {
-    p3 = std::next(p3, 1);
-    p4 = std::next(p4, 2);
-  }
+    //at the ends the first or last point stands in for the missing neighbour
+    const D3DXVECTOR3& p1 = list[i > 0 ? i - 1 : 0];
+    const D3DXVECTOR3& p2 = list[i];
+    const D3DXVECTOR3& p3 = list[i + 1];
+    const D3DXVECTOR3& p4 = list[i + 2 <= last ? i + 2 : last];
 
-  //loop until p3 == p4
-  while (1)
-  {
+    scratch.push_back(p2);
     D3DXVECTOR3 out;
-    for (int i = 1; i < 4; ++i)
+    for (int j = 1; j < 4; ++j)
     {
-      //use catmullrom spline
-      D3DXVec3CatmullRom(&out, &(*p1), &(*p2), &(*p3), &(*p4), i * 0.25f);
-      list.insert(p3, out);
+      D3DXVec3CatmullRom(&out, &p1, &p2, &p3, &p4, j * 0.25f);
+      scratch.push_back(out);
     }
-
-    if (p3 == p4)
-      break;
-
-    //if at the beginning dont change p1
-    if (p1 != p2) p1 = p2;
-    p2 = p3;
-    p3 = p4;
-    //if p4 at last element dont advance p4
-    if (p4 != last) ++p4;
   }
+  scratch.push_back(list[last]);
+  list.swap(scratch);
 }
 
-void AStar::MovementAlgo::SetBounds(int bounds)
+void AStar::MovementAlgo::SetBounds(int width)
 {
-  g_bounds = bounds;
+  bounds = width;
+  openlist.Resize(width);
+}
+
+void AStar::MovementAlgo::SetQueueType(QueueType type)
+{
+  if (openlist.GetQueueType() != type)
+  {
+    bool debugColors = openlist.GetDebugColors();
+    openlist = OpenList(type);
+    openlist.SetDebugColors(debugColors);
+    openlist.Resize(bounds);
+  }
 }
 
 void AStar::MovementAlgo::AddPointsForSmoothing(WaypointList & list)
 {
-  using LIter = WaypointList::iterator;
-  float maxdist = 1.5f * (1.0f / static_cast<float>(g_bounds));
+  float maxdist = 1.5f * (1.0f / static_cast<float>(bounds));
 
   if (list.size() < 2) return;
-  LIter p1, p2;
-  p1 = p2 = list.begin();
-  ++p2;
+  scratch.clear();
+  scratch.reserve(list.size() * 2);
 
-  while (p2 != list.end())
+  for (size_t i = 0; i + 1 < list.size(); ++i)
   {
-    //check distance between 2 points
-    D3DXVECTOR3 dist = *p2 - *p1;
+    const D3DXVECTOR3& p1 = list[i];
+    D3DXVECTOR3 dist = list[i + 1] - p1;
     float length = D3DXVec3Length(&dist);
-    if (length > maxdist)
-    { 
-      //if dist is greater, add points in the middle until its less
-      LIter temp = p2;
-      int added = 0;
-      while (length > maxdist)
-      {
-        //new pt is halfway between
-        D3DXVECTOR3 newpt = *p1 + (0.5f * dist);
-        list.insert(p2, newpt);
-        ++added;
-        p2 = std::next(p1, 1);
-        //check length again
-        dist = *p2 - *p1;
-        length = D3DXVec3Length(&dist); 
-      }
 
-      //move p1 to the next point to check
-      p1 = std::next(temp, -added);
-      p2 = std::next(p1, 1);
-    }
-    else
+    //halve until short enough, the pieces come out evenly spaced
+    int pieces = 1;
+    while (length > maxdist)
     {
-      //if not greater just increment point
-      ++p1;
-      ++p2; 
+      length *= 0.5f;
+      pieces *= 2;
     }
+
+    scratch.push_back(p1);
+    for (int j = 1; j < pieces; ++j)
+      scratch.push_back(p1 + (static_cast<float>(j) / pieces) * dist);
   }
+  scratch.push_back(list.back());
+  list.swap(scratch);
 }
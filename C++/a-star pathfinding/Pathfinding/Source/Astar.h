@@ -1,12 +1,12 @@
 #pragma once
 #include <array>
+#include <vector>
 #include <unordered_map>
 #include <cfloat>
+#include <cstdint>
 #include <iostream>
 #include "movement.h"
 
-#define MAX_NODES 1600 //biggest map is 40x40
-
 namespace AStar
 {
   struct Point
@@ -18,8 +18,6 @@ namespace AStar
     Point operator-(const Point& p) const;
     bool operator==(const Point& p) const;
     bool operator!=(const Point& p) const;
-    bool inBounds() const;
-    int singleIndex() const;
     //int row() const;
     //int col() const;
     friend std::ostream& operator<<(std::ostream& out, const Point& p);
@@ -36,47 +34,89 @@ namespace std
   {
     inline std::size_t operator()(const AStar::Point& p) const
     {
-      return ((std::hash<char>{}(p.r) ^ (std::hash<char>{}(p.c) << 1)) >> 1);
+      return ((std::hash<int>{}(p.r) ^ (std::hash<int>{}(p.c) << 1)) >> 1);
     }
   };
 };
 
 namespace AStar
 {
-  enum OnList 
+  enum OnList : uint8_t
   {
     None,
     Open,
     Closed
   };
 
+  //parent index of the start node
+  const uint32_t NO_PARENT = UINT32_MAX;
+
+  //one per map cell, the cell's position is its index in the node pool so it is not stored
   struct AStarNode
   {
-    AStarNode(Point p = Point(), AStarNode* p_ptr = nullptr, float f = FLT_MAX, 
-              float g = 0.f, OnList = None);
-    Point pos;
+    AStarNode(float f = FLT_MAX, float g = 0.f, uint32_t p = NO_PARENT, OnList = None);
     float fcost;
     float gcost;
-    AStarNode* parent;
+    uint32_t parent;      //index of the parent node in the pool
+    int queueIndex;       //position inside the heap array or the node's bucket
+    uint32_t generation;  //search that last touched the node, older nodes read as fresh
     OnList whichlist;
   };
 
+  //priority queue backing the open list, chosen when the OpenList is constructed
+  enum QueueType
+  {
+    BinaryHeap = 0,
+    QuaternaryHeap,
+    BucketQueue,
+    QueueTypeCount
+  };
+
   class OpenList
   {
   public:
-    OpenList();
-    AStarNode* PopCheapest();
-    AStarNode* find(const Point& pos);
-    void UpdateCost(AStarNode* node, AStarNode* p_ptr, float newf, float newg);
-    void push(const AStarNode& node);
+    OpenList(QueueType type = BinaryHeap);
+    uint32_t PopCheapest();
+    AStarNode& operator[](uint32_t index);
+    uint32_t IndexOf(const Point& pos) const;
+    Point PointOf(uint32_t index) const;
+    void UpdateCost(uint32_t index, uint32_t parent, float newf, float newg);
+    void push(const Point& pos, uint32_t parent, float f, float g);
     void clear();
+    void reset();
     bool empty() const;
+    bool WasVisited(uint32_t index) const;
+    void Resize(int width);
+    QueueType GetQueueType() const;
+    void SetDebugColors(bool enable);
+    bool GetDebugColors() const;
+
+  private:
+    //heap helpers (binary and 4-ary share the same code, only the arity differs)
+    bool Cheaper(int lhs, int rhs) const;
+    void SiftUp(int pos);
+    void SiftDown(int pos);
+    void HeapInsert(int index);
+    int HeapPop();
+
+    //bucket helpers, each bucket holds the nodes whose fcost falls in [b*width, (b+1)*width)
+    int BucketOf(float fcost) const;
+    void BucketInsert(int index);
+    void BucketRemove(int index);
+    int BucketPop();
 
-  private:   
     //variables
+    QueueType queueType;
+    int arity;
     int last;
-    std::array<AStarNode*, MAX_NODES> openList;
-    std::array<AStarNode, MAX_NODES> nodes;
+    int width;
+    std::vector<int> openList;   //heap of indices into nodes
+    std::vector<AStarNode> nodes;
+    std::vector<std::vector<int>> buckets;
+    int lowestBucket;
+    int highestBucket;
+    uint32_t generation;   //stamp of the current search
+    bool debugColors;      //paint open and closed tiles, off for searches running off the main thread
   };
 
   enum Heuristic
@@ -87,27 +127,52 @@ namespace AStar
     Manhattan
   };
 
+  //jump point searches only differ in which nodes get pushed, the open list and path format are shared
+  //hierarchical search runs on the ClusterGraph instead of the open list
+  enum Algorithm
+  {
+    AStarSearch = 0,
+    JumpPointSearch,
+    JumpPointSearchPlus,
+    HierarchicalSearch,
+    AlgorithmCount
+  };
+
   class MovementAlgo
   {
   public:
     using DirCostPair = std::pair<Point, float>;
     MovementAlgo();
-    bool PathFind(WaypointList& path);
+    bool PathFind(WaypointList& path, unsigned maxExpansions = 0);
+    void ExpandNeighbours(uint32_t index, const Point& pos);
+    void ExpandJumpPoints(uint32_t index, const Point& pos);
+    void ExpandJumpPointsPlus(uint32_t index, const Point& pos);
+    bool Jump(const Point& from, const Point& dir, Point& jumpPoint);
+    Point TravelDirection(uint32_t index, const Point& pos);
+    bool IsPrunedDirection(const Point& pos, const Point& travel, const Point& dir);
+    void AddSuccessor(uint32_t parent, const Point& pos, float stepCost);
+    bool IsWalkable(const Point& pt);
     float GetHCost(const Point& currPos, const Point& endPos);
     bool StraightLineCheck(const Point& start, const Point& end);
     bool isDiagonalsWalls(const Point& pt, const Point& dir);
+    bool InBounds(const Point& pt) const;
     void RubberbandPath(WaypointList& path);
     void AddPointsForSmoothing(WaypointList& path);
     void SmoothPath(WaypointList& path);
     void SetBounds(int bounds);
+    void SetQueueType(QueueType type);
 
     AStar::OpenList openlist;
     std::array<DirCostPair, 8> directions;
     AStar::Heuristic heur;
+    AStar::Algorithm algorithm;
     float h_weight;
     Point goal;
     Point start;
     bool isSingleStep;
+    int bounds;               //width of the map the node pool is sized for
+    unsigned nodesExpanded;   //nodes popped off the open list since the last new request
+    WaypointList scratch;     //smoothing writes here and swaps, so the buffers are reused between paths
   };
 };
 
@@ -0,0 +1,102 @@
+#include <Stdafx.h>
+
+//Add new states here
+enum StateName {
+	STATE_Listen,	//Note: the first enum is the starting state
+	STATE_Chatter
+};
+
+//Add new substates here
+enum SubstateName {
+	//empty
+};
+
+bool BenchmarkAgent::States( State_Machine_Event event, MSG_Object * msg, int state, int substate )
+{
+BeginStateMachine
+
+	//Global message responses
+
+	OnMsg( MSG_UnitTestPing )
+		//Data is the sender's index times 1000 plus its ping count
+		++m_received;
+		Mix( static_cast<unsigned int>( msg->GetIntData() ) );
+		MSG_Data data( static_cast<int>( m_index ) );
+		SendMsg( MSG_UnitTestAck, msg->GetSender(), data );
+		if( msg->GetIntData() % 13 == 0 && !m_resetting )
+		{	//Only one reset can be asked for at a time
+			m_resetting = true;
+			ResetStateMachine();
+		}
+
+	OnMsg( MSG_UnitTestAck )
+		++m_received;
+		Mix( static_cast<unsigned int>( msg->GetIntData() ) );
+
+	///////////////////////////////////////////////////////////////
+	DeclareState( STATE_Listen )
+
+		OnEnter
+			m_resetting = false;
+			Mix( STATE_Listen );
+			SetTimerState( 0.05f, MSG_UnitTestTimer );
+
+		OnUpdate
+			Decide();
+			if( ++m_updates % 8 == m_index % 8 ) {
+				Ping();
+			}
+
+		OnMsg( MSG_UnitTestTimer )
+			++m_received;
+			Mix( 1 );
+
+		OnMsg( MSG_UnitTestAck )
+			++m_received;
+			Mix( static_cast<unsigned int>( msg->GetIntData() ) );
+			if( ++m_acks % 3 == 0 ) {
+				ChangeState( STATE_Chatter );
+			}
+
+	///////////////////////////////////////////////////////////////
+	DeclareState( STATE_Chatter )
+
+		OnEnter
+			Mix( STATE_Chatter );
+			SendMsgDelayedToState( 0.1f, MSG_UnitTestDone );
+
+		OnUpdate
+			Decide();
+			Ping();
+
+		OnMsg( MSG_UnitTestDone )
+			++m_received;
+			ChangeState( STATE_Listen );
+
+EndStateMachine
+}
+
+void BenchmarkAgent::Decide( void )
+{	//Stands in for perception and planning
+	for( unsigned int i = 0; i < m_work; ++i ) {
+		m_scratch = m_scratch * 1664525u + 1013904223u;
+	}
+}
+
+void BenchmarkAgent::Ping( void )
+{
+	const std::vector<objectID> & peers = *m_peers;
+	unsigned int peer = ( m_index * 7 + m_pings * 13 + 1 ) % peers.size();
+	if( peer == m_index ) {
+		peer = ( peer + 1 ) % peers.size();
+	}
+
+	MSG_Data data( static_cast<int>( m_index * 1000 + m_pings ) );
+	SendMsg( MSG_UnitTestPing, peers[peer], data );
+	++m_pings;
+}
+
+void BenchmarkAgent::Mix( unsigned int value )
+{
+	m_digest = ( m_digest ^ value ) * 16777619u;
+}
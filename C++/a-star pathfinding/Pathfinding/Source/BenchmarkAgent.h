@@ -0,0 +1,43 @@
+#pragma once
+
+#include <statemch.h>
+
+// Stand-in agent for the phased update benchmark. Each update it spends a
+// fixed amount of work deciding, pings other agents now and then, and moves
+// between two states on the replies. It only touches its own data and talks
+// through messages, so any update that delivers the same messages in the
+// same order leaves it with the same digest.
+class BenchmarkAgent : public StateMachine
+{
+public:
+
+	BenchmarkAgent( GameObject & object, const std::vector<objectID> & peers, unsigned int index, unsigned int work )
+		: StateMachine( object ), m_peers( &peers ), m_index( index ), m_work( work ),
+		  m_digest( 2166136261u ), m_scratch( index ), m_updates( 0 ), m_pings( 0 ), m_acks( 0 ), m_received( 0 ), m_resetting( false )
+		{}
+	~BenchmarkAgent( void ) {}
+
+	// Everything it received and decided, folded together
+	inline unsigned int GetDigest( void )		{ return( m_digest ^ m_scratch ); }
+	inline unsigned int GetReceived( void )		{ return( m_received ); }
+
+private:
+
+	virtual bool States( State_Machine_Event event, MSG_Object * msg, int state, int substate );
+
+	void Decide( void );
+	void Ping( void );
+	void Mix( unsigned int value );
+
+	const std::vector<objectID> * m_peers;	//Every benchmark agent's ID, by index
+	unsigned int m_index;
+	unsigned int m_work;					//Rounds of busy work each update
+
+	unsigned int m_digest;
+	unsigned int m_scratch;
+	unsigned int m_updates;
+	unsigned int m_pings;
+	unsigned int m_acks;
+	unsigned int m_received;
+	bool m_resetting;
+};
@@ -0,0 +1,66 @@
+#include <Stdafx.h>
+
+#define DISPATCH_STATE_NAMES_8(n)	STATE_Dispatch ## n ## 0, STATE_Dispatch ## n ## 1, STATE_Dispatch ## n ## 2, STATE_Dispatch ## n ## 3, \
+									STATE_Dispatch ## n ## 4, STATE_Dispatch ## n ## 5, STATE_Dispatch ## n ## 6, STATE_Dispatch ## n ## 7,
+
+#define DISPATCH_STATE(name)		DeclareState( name ) \
+										OnMsg( MSG_UnitTestMessage ) ++m_handled; \
+										OnMsg( MSG_UnitTestMessage2 ) ++m_handled; \
+										OnMsg( MSG_UnitTestMessage3 ) ++m_handled; \
+										OnMsg( MSG_UnitTestMessage4 ) ++m_handled; \
+										OnMsg( MSG_UnitTestMessage5 ) ++m_handled; \
+										OnMsg( MSG_UnitTestMessage6 ) ++m_handled; \
+										OnMsg( MSG_UnitTestMessage7 ) ++m_handled; \
+										OnMsg( MSG_UnitTestMessage8 ) ++m_handled; \
+										OnMsg( MSG_UnitTestPing ) ++m_handled;
+
+#define DISPATCH_STATES_8(n)		DISPATCH_STATE( STATE_Dispatch ## n ## 0 ) DISPATCH_STATE( STATE_Dispatch ## n ## 1 ) \
+									DISPATCH_STATE( STATE_Dispatch ## n ## 2 ) DISPATCH_STATE( STATE_Dispatch ## n ## 3 ) \
+									DISPATCH_STATE( STATE_Dispatch ## n ## 4 ) DISPATCH_STATE( STATE_Dispatch ## n ## 5 ) \
+									DISPATCH_STATE( STATE_Dispatch ## n ## 6 ) DISPATCH_STATE( STATE_Dispatch ## n ## 7 )
+
+//Add new states here
+enum StateName {
+	STATE_Start,	//Note: the first enum is the starting state
+	DISPATCH_STATE_NAMES_8( 0 )
+	DISPATCH_STATE_NAMES_8( 1 )
+	DISPATCH_STATE_NAMES_8( 2 )
+	DISPATCH_STATE_NAMES_8( 3 )
+	DISPATCH_STATE_NAMES_8( 4 )
+	DISPATCH_STATE_NAMES_8( 5 )
+	DISPATCH_STATE_NAMES_8( 6 )
+	DISPATCH_STATE_NAMES_8( 7 )
+};
+
+//Add new substates here
+enum SubstateName {
+	//empty
+};
+
+bool BenchmarkDispatch::States( State_Machine_Event event, MSG_Object * msg, int state, int substate )
+{
+BeginStateMachine
+
+	//Global message responses
+
+	OnMsg( MSG_UnitTestAck )
+		++m_handled;
+
+	///////////////////////////////////////////////////////////////
+	DeclareState( STATE_Start )
+
+		OnEnter
+			ChangeState( STATE_Dispatch00 + m_target );
+
+	///////////////////////////////////////////////////////////////
+	DISPATCH_STATES_8( 0 )
+	DISPATCH_STATES_8( 1 )
+	DISPATCH_STATES_8( 2 )
+	DISPATCH_STATES_8( 3 )
+	DISPATCH_STATES_8( 4 )
+	DISPATCH_STATES_8( 5 )
+	DISPATCH_STATES_8( 6 )
+	DISPATCH_STATES_8( 7 )
+
+EndStateMachine
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <statemch.h>
+
+// Large state machine for the dispatch benchmark: 64 states with the same
+// nine message handlers each and one more in the global state. It moves to
+// the state it is given on entering and stays there, counting what it gets.
+class BenchmarkDispatch : public StateMachine
+{
+public:
+
+	BenchmarkDispatch( GameObject & object, int target )
+		: StateMachine( object ), m_target( target ), m_handled( 0 )
+		{}
+	~BenchmarkDispatch( void ) {}
+
+	inline unsigned int GetHandled( void )		{ return( m_handled ); }
+
+private:
+
+	virtual bool States( State_Machine_Event event, MSG_Object * msg, int state, int substate );
+
+	int m_target;					//State to settle in
+	unsigned int m_handled;
+};
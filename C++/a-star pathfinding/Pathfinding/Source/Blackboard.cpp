@@ -15,7 +15,7 @@ written consent of DigiPen Institute of Technology is prohibited.
 
 // constructor
 MovementSetting::MovementSetting()
-	: m_row(0), m_col(0), m_mapindex(0), m_heuristicWeight(1.00f), m_heuristicCalc(0),
+	: m_row(0), m_col(0), m_mapindex(0), m_heuristicWeight(1.00f), m_heuristicCalc(0), m_searchAlgorithm(0),
 	m_singleStep(true), m_smooth(false), m_rubberband(false), m_straightline(false),
 	m_extracredit(0), m_aStarUsesAnalysis(false)
 {
@@ -26,6 +26,7 @@ void MovementSetting::Set(Movement& movement)
 {
 	m_heuristicCalc = movement.GetHeuristicCalc();
 	m_heuristicWeight = movement.GetHeuristicWeight();
+	m_searchAlgorithm = movement.GetSearchAlgorithm();
 	m_singleStep = movement.GetSingleStep();
 	m_smooth = movement.GetSmoothPath();
 	m_rubberband = movement.GetRubberbandPath();
@@ -38,6 +39,7 @@ void MovementSetting::Reset(Movement& movement)
 {
 	movement.SetHeuristicCalc(m_heuristicCalc);
 	movement.SetHeuristicWeight(m_heuristicWeight);
+	movement.SetSearchAlgorithm(m_searchAlgorithm);
 	movement.SetSingleStep(m_singleStep);
 	movement.SetSmoothPath(m_smooth);
 	movement.SetRubberbandPath(m_rubberband);
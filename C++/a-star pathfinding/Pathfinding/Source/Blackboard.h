@@ -35,6 +35,7 @@ public:
 
 	float GetHeuristicWeight(void)		{ return m_heuristicWeight; }
 	int GetHeuristicCalc(void)			{ return m_heuristicCalc; }
+	int GetSearchAlgorithm(void)		{ return m_searchAlgorithm; }
 	bool GetSingleStep(void)			{ return m_singleStep; }
 	bool GetSmoothing(void)				{ return m_smooth; }
 	bool GetRubberbanding(void)			{ return m_rubberband; }
@@ -49,6 +50,7 @@ private:
 
 	float m_heuristicWeight;
 	int m_heuristicCalc;
+	int m_searchAlgorithm;
 	bool m_singleStep;
 	bool m_smooth;
 	bool m_rubberband;
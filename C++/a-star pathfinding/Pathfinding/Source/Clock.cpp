@@ -17,6 +17,7 @@ Clock::Clock(void)
 	m_startTime = timeGetTime();
 	m_stopwatchStartTimePathfinding = m_stopwatchStartTimeAnalysis = 0.0;
 	m_stopwatchValuePathfinding = m_stopwatchValueAnalysis = 0.0;
+	m_qpcfrequency = 0.0;
 }
 
 /*---------------------------------------------------------------------------*
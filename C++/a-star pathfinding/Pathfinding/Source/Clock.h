@@ -20,6 +20,7 @@ public:
 	void MarkTimeThisTick( void );
 	inline float GetElapsedTime( void )			{ return( m_timeLastTick ); }
 	inline float GetCurTime( void )				{ return( m_currentTime ); }
+	inline void SetCurTime( float time )		{ m_currentTime = time; }	//For testing, the next MarkTimeThisTick goes back to real time
 	inline double GetAbsoluteTime( void )		{ return( m_timer.GetAbsoluteTime() ); }
 	inline double GetHighestResolutionTime( void )	{ LARGE_INTEGER qwTime; QueryPerformanceCounter( &qwTime ); return((double)qwTime.QuadPart); }
 
@@ -0,0 +1,505 @@
+#include "Stdafx.h"
+#include "ClusterGraph.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <set>
+
+using namespace AStar;
+
+namespace
+{
+  const float DIAGONAL_COST = 1.41421356f;
+
+  //same step rules as MovementAlgo::directions
+  const int STEPS[8][2] = { { 1, 0 }, { -1, 0 }, { 0, -1 }, { 0, 1 }, { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 } };
+
+  float OctileDistance(const Point& a, const Point& b)
+  {
+    float rdiff = static_cast<float>(std::abs(a.r - b.r));
+    float cdiff = static_cast<float>(std::abs(a.c - b.c));
+    float min = (std::min)(rdiff, cdiff);
+    return (min * DIAGONAL_COST) + (std::max)(rdiff, cdiff) - min;
+  }
+
+  //min-heap on cost for std::push_heap / std::pop_heap
+  typedef std::greater<std::pair<float, int> > HeapOrder;
+}
+
+AStar::ClusterGraph::ClusterGraph() :
+  map(nullptr),
+  width(0),
+  clustersPerRow(0),
+  version(0),
+  localGeneration(0),
+  abstractGeneration(0)
+{
+}
+
+void AStar::ClusterGraph::Build(Map& m)
+{
+  map = &m;
+  width = m.GetWidth();
+  clustersPerRow = (width + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+  version = m.GetWallVersion();
+
+  int clusterCount = clustersPerRow * clustersPerRow;
+  nodes.clear();
+  freeNodes.clear();
+  clusterNodes.assign(clusterCount, std::vector<int>());
+  borderNodes.assign(clusterCount * BorderSideCount, std::vector<int>());
+
+  localCost.assign(CLUSTER_SIZE * CLUSTER_SIZE, 0.f);
+  localParent.assign(CLUSTER_SIZE * CLUSTER_SIZE, -1);
+  localStamp.assign(CLUSTER_SIZE * CLUSTER_SIZE, 0);
+  localGeneration = 0;
+
+  //entrances first, the intra-cluster edges connect them
+  for (int cluster = 0; cluster < clusterCount; ++cluster)
+  {
+    RebuildBorder(cluster, Bottom);
+    RebuildBorder(cluster, Right);
+  }
+  for (int cluster = 0; cluster < clusterCount; ++cluster)
+    RebuildEdges(cluster);
+}
+
+void AStar::ClusterGraph::Update(Map& m)
+{
+  std::vector<int> tiles;
+  if (&m != map || m.GetWidth() != width || !m.GetWallChanges(version, tiles))
+  {
+    Build(m);
+    return;
+  }
+  version = m.GetWallVersion();
+
+  //a changed tile can move the entrances on any side of its cluster
+  std::set<int> dirty;
+  for (size_t i = 0; i < tiles.size(); ++i)
+    dirty.insert(ClusterOf(Point(tiles[i] / width, tiles[i] % width)));
+
+  std::set<int> affected;
+  for (std::set<int>::iterator it = dirty.begin(); it != dirty.end(); ++it)
+  {
+    int cluster = *it;
+    int row = cluster / clustersPerRow;
+    int col = cluster % clustersPerRow;
+
+    RebuildBorder(cluster, Bottom);
+    RebuildBorder(cluster, Right);
+    affected.insert(cluster);
+    if (row + 1 < clustersPerRow) affected.insert(cluster + clustersPerRow);
+    if (col + 1 < clustersPerRow) affected.insert(cluster + 1);
+
+    //the borders above and to the left belong to the neighbours
+    if (row > 0)
+    {
+      RebuildBorder(cluster - clustersPerRow, Bottom);
+      affected.insert(cluster - clustersPerRow);
+    }
+    if (col > 0)
+    {
+      RebuildBorder(cluster - 1, Right);
+      affected.insert(cluster - 1);
+    }
+  }
+
+  for (std::set<int>::iterator it = affected.begin(); it != affected.end(); ++it)
+    RebuildEdges(*it);
+}
+
+bool AStar::ClusterGraph::PathFind(const Point& start, const Point& goal, WaypointList& path)
+{
+  Terrain& terrain = g_terrain;
+  std::vector<Point> abstractPath;
+
+  //if unable to find path just push start node
+  if (!FindAbstractPath(start, goal, abstractPath))
+  {
+    path.push_back(terrain.GetCoordinates(start.r, start.c));
+    return true;
+  }
+
+  //refine one abstract edge at a time, each one stays inside a single cluster
+  path.push_back(terrain.GetCoordinates(start.r, start.c));
+  for (size_t i = 1; i < abstractPath.size(); ++i)
+    RefineSegment(abstractPath[i - 1], abstractPath[i], path);
+
+  return true;
+}
+
+bool AStar::ClusterGraph::FindAbstractPath(const Point& start, const Point& goal, std::vector<Point>& abstractPath)
+{
+  if (!IsOpen(start.r, start.c) || !IsOpen(goal.r, goal.c))
+    return false;
+
+  int nodeCount = static_cast<int>(nodes.size());
+  int startId = nodeCount;
+  int goalId = nodeCount + 1;
+  int startCluster = ClusterOf(start);
+  int goalCluster = ClusterOf(goal);
+
+  if (static_cast<int>(abstractStamp.size()) < nodeCount + 2)
+  {
+    abstractCost.resize(nodeCount + 2);
+    abstractParent.resize(nodeCount + 2);
+    abstractStamp.resize(nodeCount + 2, 0);
+  }
+  goalCost.resize(nodeCount);
+
+  //stale slots read as unvisited, wipe them for real only when the stamp wraps
+  if (++abstractGeneration == 0)
+  {
+    std::fill(abstractStamp.begin(), abstractStamp.end(), 0);
+    abstractGeneration = 1;
+  }
+  abstractHeap.clear();
+
+  //connect the goal to the entrances of its cluster
+  SearchCluster(goalCluster, goal, nullptr, nullptr);
+  Point goalOrigin = ClusterOrigin(goalCluster);
+  const std::vector<int>& goalNodes = clusterNodes[goalCluster];
+  for (size_t i = 0; i < goalNodes.size(); ++i)
+  {
+    const Point& pos = nodes[goalNodes[i]].pos;
+    int local = (pos.r - goalOrigin.r) * CLUSTER_SIZE + (pos.c - goalOrigin.c);
+    goalCost[goalNodes[i]] = (localStamp[local] == localGeneration) ? localCost[local] : FLT_MAX;
+  }
+
+  //connect the start to the entrances of its cluster, and straight to the goal when they share it
+  SearchCluster(startCluster, start, nullptr, nullptr);
+  Point startOrigin = ClusterOrigin(startCluster);
+  abstractStamp[startId] = abstractGeneration;
+  abstractCost[startId] = 0.f;
+  abstractParent[startId] = -1;
+
+  auto relax = [&](int id, int parent, float cost, const Point& pos)
+  {
+    if (abstractStamp[id] == abstractGeneration && abstractCost[id] <= cost)
+      return;
+    abstractStamp[id] = abstractGeneration;
+    abstractCost[id] = cost;
+    abstractParent[id] = parent;
+    abstractHeap.push_back(std::make_pair(cost + OctileDistance(pos, goal), id));
+    std::push_heap(abstractHeap.begin(), abstractHeap.end(), HeapOrder());
+  };
+
+  if (startCluster == goalCluster)
+  {
+    int local = (goal.r - startOrigin.r) * CLUSTER_SIZE + (goal.c - startOrigin.c);
+    if (localStamp[local] == localGeneration)
+      relax(goalId, startId, localCost[local], goal);
+  }
+
+  const std::vector<int>& startNodes = clusterNodes[startCluster];
+  for (size_t i = 0; i < startNodes.size(); ++i)
+  {
+    const Point& pos = nodes[startNodes[i]].pos;
+    int local = (pos.r - startOrigin.r) * CLUSTER_SIZE + (pos.c - startOrigin.c);
+    if (localStamp[local] == localGeneration)
+      relax(startNodes[i], startId, localCost[local], pos);
+  }
+
+  //plain A* over the entrances
+  bool found = false;
+  while (!abstractHeap.empty())
+  {
+    std::pop_heap(abstractHeap.begin(), abstractHeap.end(), HeapOrder());
+    std::pair<float, int> top = abstractHeap.back();
+    abstractHeap.pop_back();
+
+    int id = top.second;
+    const Point& pos = (id == goalId) ? goal : nodes[id].pos;
+    if (top.first > abstractCost[id] + OctileDistance(pos, goal))
+      continue;
+
+    if (id == goalId)
+    {
+      found = true;
+      break;
+    }
+
+    const AbstractNode& node = nodes[id];
+    float cost = abstractCost[id];
+    relax(node.twin, id, cost + 1.f, nodes[node.twin].pos);
+    for (size_t i = 0; i < node.edges.size(); ++i)
+      relax(node.edges[i].to, id, cost + node.edges[i].cost, nodes[node.edges[i].to].pos);
+    if (node.cluster == goalCluster && goalCost[id] != FLT_MAX)
+      relax(goalId, id, cost + goalCost[id], goal);
+  }
+
+  if (!found)
+    return false;
+
+  //walk back from the goal, neighbouring nodes on the same tile collapse into one point
+  abstractPath.clear();
+  for (int id = goalId; id != -1; id = abstractParent[id])
+  {
+    Point pos = (id == goalId) ? goal : (id == startId) ? start : nodes[id].pos;
+    if (abstractPath.empty() || abstractPath.back() != pos)
+      abstractPath.push_back(pos);
+  }
+  std::reverse(abstractPath.begin(), abstractPath.end());
+  return true;
+}
+
+bool AStar::ClusterGraph::RefineSegment(const Point& from, const Point& to, WaypointList& path)
+{
+  Terrain& terrain = g_terrain;
+  if (from == to)
+    return true;
+
+  //crossing a border is a single cardinal step
+  if (std::abs(from.r - to.r) + std::abs(from.c - to.c) == 1)
+  {
+    path.push_back(terrain.GetCoordinates(to.r, to.c));
+    return true;
+  }
+
+  std::vector<Point> tiles;
+  if (SearchCluster(ClusterOf(from), from, &to, &tiles) == FLT_MAX)
+    return false;
+
+  for (size_t i = 0; i < tiles.size(); ++i)
+    path.push_back(terrain.GetCoordinates(tiles[i].r, tiles[i].c));
+  return true;
+}
+
+size_t AStar::ClusterGraph::GetMemoryUsage() const
+{
+  size_t bytes = sizeof(*this);
+  bytes += nodes.capacity() * sizeof(AbstractNode) + freeNodes.capacity() * sizeof(int);
+  for (size_t i = 0; i < nodes.size(); ++i)
+    bytes += nodes[i].edges.capacity() * sizeof(AbstractEdge);
+  for (size_t i = 0; i < clusterNodes.size(); ++i)
+    bytes += sizeof(std::vector<int>) + clusterNodes[i].capacity() * sizeof(int);
+  for (size_t i = 0; i < borderNodes.size(); ++i)
+    bytes += sizeof(std::vector<int>) + borderNodes[i].capacity() * sizeof(int);
+
+  bytes += localHeap.capacity() * sizeof(std::pair<float, int>);
+  bytes += localCost.capacity() * sizeof(float) + localParent.capacity() * sizeof(int) + localStamp.capacity() * sizeof(unsigned);
+  bytes += abstractHeap.capacity() * sizeof(std::pair<float, int>);
+  bytes += abstractCost.capacity() * sizeof(float) + abstractParent.capacity() * sizeof(int) + abstractStamp.capacity() * sizeof(unsigned);
+  bytes += goalCost.capacity() * sizeof(float);
+  return bytes;
+}
+
+size_t AStar::ClusterGraph::GetNodeCount() const
+{
+  return nodes.size() - freeNodes.size();
+}
+
+int AStar::ClusterGraph::ClusterOf(const Point& pos) const
+{
+  return (pos.r / CLUSTER_SIZE) * clustersPerRow + (pos.c / CLUSTER_SIZE);
+}
+
+Point AStar::ClusterGraph::ClusterOrigin(int cluster) const
+{
+  return Point((cluster / clustersPerRow) * CLUSTER_SIZE, (cluster % clustersPerRow) * CLUSTER_SIZE);
+}
+
+bool AStar::ClusterGraph::IsOpen(int r, int c) const
+{
+  return r >= 0 && r < width && c >= 0 && c < width && !map->IsWall(r, c);
+}
+
+void AStar::ClusterGraph::RebuildBorder(int cluster, BorderSide side)
+{
+  int border = cluster * BorderSideCount + side;
+
+  //drop the old transitions, the clusters on both sides rebuild their edges afterwards
+  std::vector<int>& old = borderNodes[border];
+  for (size_t i = 0; i < old.size(); ++i)
+    RemoveNode(old[i]);
+  old.clear();
+
+  //the last row or column of clusters has no neighbour on that side
+  Point origin = ClusterOrigin(cluster);
+  Point along = (side == Bottom) ? Point(0, 1) : Point(1, 0);
+  Point across = (side == Bottom) ? Point(1, 0) : Point(0, 1);
+  Point first = origin + Point(across.r * (CLUSTER_SIZE - 1), across.c * (CLUSTER_SIZE - 1));
+  if (first.r + across.r >= width || first.c + across.c >= width)
+    return;
+
+  int length = (std::min)(CLUSTER_SIZE, width - ((side == Bottom) ? origin.c : origin.r));
+
+  //split the border into runs of tiles open on both sides
+  int runStart = -1;
+  for (int i = 0; i <= length; ++i)
+  {
+    Point inside = first + Point(along.r * i, along.c * i);
+    bool open = i < length && IsOpen(inside.r, inside.c) && IsOpen(inside.r + across.r, inside.c + across.c);
+
+    if (open && runStart < 0)
+      runStart = i;
+    if (open || runStart < 0)
+      continue;
+
+    //short runs get one transition in the middle, long ones one at each end
+    int runEnd = i - 1;
+    if (runEnd - runStart + 1 < LONG_ENTRANCE)
+    {
+      int middle = (runStart + runEnd) / 2;
+      Point tile = first + Point(along.r * middle, along.c * middle);
+      AddTransition(border, tile, tile + across);
+    }
+    else
+    {
+      Point tileStart = first + Point(along.r * runStart, along.c * runStart);
+      Point tileEnd = first + Point(along.r * runEnd, along.c * runEnd);
+      AddTransition(border, tileStart, tileStart + across);
+      AddTransition(border, tileEnd, tileEnd + across);
+    }
+    runStart = -1;
+  }
+}
+
+void AStar::ClusterGraph::AddTransition(int border, const Point& inside, const Point& outside)
+{
+  int a = AddNode(inside);
+  int b = AddNode(outside);
+  nodes[a].twin = b;
+  nodes[b].twin = a;
+  borderNodes[border].push_back(a);
+  borderNodes[border].push_back(b);
+}
+
+int AStar::ClusterGraph::AddNode(const Point& pos)
+{
+  int id;
+  if (!freeNodes.empty())
+  {
+    id = freeNodes.back();
+    freeNodes.pop_back();
+  }
+  else
+  {
+    id = static_cast<int>(nodes.size());
+    nodes.push_back(AbstractNode());
+  }
+
+  AbstractNode& node = nodes[id];
+  node.pos = pos;
+  node.cluster = ClusterOf(pos);
+  node.twin = -1;
+  node.edges.clear();
+  clusterNodes[node.cluster].push_back(id);
+  return id;
+}
+
+void AStar::ClusterGraph::RemoveNode(int id)
+{
+  AbstractNode& node = nodes[id];
+  std::vector<int>& members = clusterNodes[node.cluster];
+  std::vector<int>::iterator it = std::find(members.begin(), members.end(), id);
+  *it = members.back();
+  members.pop_back();
+
+  node.cluster = -1;
+  node.twin = -1;
+  node.edges.clear();
+  freeNodes.push_back(id);
+}
+
+void AStar::ClusterGraph::RebuildEdges(int cluster)
+{
+  const std::vector<int>& members = clusterNodes[cluster];
+  Point origin = ClusterOrigin(cluster);
+
+  //one flood fill per entrance gives its cost to every other entrance of the cluster
+  for (size_t i = 0; i < members.size(); ++i)
+  {
+    AbstractNode& node = nodes[members[i]];
+    node.edges.clear();
+    SearchCluster(cluster, node.pos, nullptr, nullptr);
+
+    for (size_t j = 0; j < members.size(); ++j)
+    {
+      if (i == j)
+        continue;
+
+      const Point& pos = nodes[members[j]].pos;
+      int local = (pos.r - origin.r) * CLUSTER_SIZE + (pos.c - origin.c);
+      if (localStamp[local] == localGeneration)
+      {
+        AbstractEdge edge = { members[j], localCost[local] };
+        node.edges.push_back(edge);
+      }
+    }
+  }
+}
+
+float AStar::ClusterGraph::SearchCluster(int cluster, const Point& from, const Point* to, std::vector<Point>* path)
+{
+  Point origin = ClusterOrigin(cluster);
+  int rEnd = (std::min)(origin.r + CLUSTER_SIZE, width);
+  int cEnd = (std::min)(origin.c + CLUSTER_SIZE, width);
+
+  if (++localGeneration == 0)
+  {
+    std::fill(localStamp.begin(), localStamp.end(), 0);
+    localGeneration = 1;
+  }
+  localHeap.clear();
+
+  //Dijkstra over the cluster's tiles, or A* when there is a single target
+  int fromLocal = (from.r - origin.r) * CLUSTER_SIZE + (from.c - origin.c);
+  localStamp[fromLocal] = localGeneration;
+  localCost[fromLocal] = 0.f;
+  localParent[fromLocal] = -1;
+  localHeap.push_back(std::make_pair(to ? OctileDistance(from, *to) : 0.f, fromLocal));
+
+  while (!localHeap.empty())
+  {
+    std::pop_heap(localHeap.begin(), localHeap.end(), HeapOrder());
+    std::pair<float, int> top = localHeap.back();
+    localHeap.pop_back();
+
+    int current = top.second;
+    Point pos(origin.r + current / CLUSTER_SIZE, origin.c + current % CLUSTER_SIZE);
+    if (top.first > localCost[current] + (to ? OctileDistance(pos, *to) : 0.f))
+      continue;
+
+    if (to && pos == *to)
+    {
+      //parents lead back to the start, hand the tiles over start first without the start itself
+      if (path)
+      {
+        size_t first = path->size();
+        for (int tile = current; tile != fromLocal; tile = localParent[tile])
+          path->push_back(Point(origin.r + tile / CLUSTER_SIZE, origin.c + tile % CLUSTER_SIZE));
+        std::reverse(path->begin() + first, path->end());
+      }
+      return localCost[current];
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+      Point next(pos.r + STEPS[i][0], pos.c + STEPS[i][1]);
+      if (next.r < origin.r || next.r >= rEnd || next.c < origin.c || next.c >= cEnd)
+        continue;
+      if (!IsOpen(next.r, next.c))
+        continue;
+
+      //diagonals may not cut corners
+      bool diagonal = i >= 4;
+      if (diagonal && (!IsOpen(next.r, pos.c) || !IsOpen(pos.r, next.c)))
+        continue;
+
+      int local = (next.r - origin.r) * CLUSTER_SIZE + (next.c - origin.c);
+      float cost = localCost[current] + (diagonal ? DIAGONAL_COST : 1.f);
+      if (localStamp[local] == localGeneration && localCost[local] <= cost)
+        continue;
+
+      localStamp[local] = localGeneration;
+      localCost[local] = cost;
+      localParent[local] = current;
+      localHeap.push_back(std::make_pair(cost + (to ? OctileDistance(next, *to) : 0.f), local));
+      std::push_heap(localHeap.begin(), localHeap.end(), HeapOrder());
+    }
+  }
+
+  return to ? FLT_MAX : 0.f;
+}
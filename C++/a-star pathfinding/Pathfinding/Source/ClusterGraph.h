@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Astar.h"
+
+namespace AStar
+{
+  //width and height of a cluster in tiles
+  const int CLUSTER_SIZE = 16;
+
+  //runs of open border tiles at least this long get a transition at each end instead of one in the middle
+  const int LONG_ENTRANCE = 6;
+
+  struct AbstractEdge
+  {
+    int to;
+    float cost;
+  };
+
+  //a tile on a cluster border where the search can cross into the neighbouring cluster
+  struct AbstractNode
+  {
+    Point pos;
+    int cluster;
+    int twin;                           //node on the other side of the border, one step away
+    std::vector<AbstractEdge> edges;    //other nodes of the same cluster
+  };
+
+  //HPA* abstraction of the bound map: clusters of CLUSTER_SIZE^2 tiles joined at their entrances
+  class ClusterGraph
+  {
+  public:
+    ClusterGraph();
+    void Build(Map& map);
+    void Update(Map& map);
+    bool PathFind(const Point& start, const Point& goal, WaypointList& path);   //finishes in one call, no path leaves only the start
+    bool FindAbstractPath(const Point& start, const Point& goal, std::vector<Point>& abstractPath);
+    bool RefineSegment(const Point& from, const Point& to, WaypointList& path);
+    size_t GetMemoryUsage() const;
+    size_t GetNodeCount() const;
+
+  private:
+    //the tiles and transitions of one cluster border, borders are keyed by the cluster above or left of them
+    enum BorderSide
+    {
+      Bottom = 0,
+      Right,
+      BorderSideCount
+    };
+
+    int ClusterOf(const Point& pos) const;
+    Point ClusterOrigin(int cluster) const;
+    bool IsOpen(int r, int c) const;
+    void RebuildBorder(int cluster, BorderSide side);
+    void AddTransition(int border, const Point& inside, const Point& outside);
+    int AddNode(const Point& pos);
+    void RemoveNode(int node);
+    void RebuildEdges(int cluster);
+    float SearchCluster(int cluster, const Point& from, const Point* to, std::vector<Point>* path);
+
+    //graph
+    Map* map;
+    int width;
+    int clustersPerRow;
+    unsigned version;
+    std::vector<AbstractNode> nodes;
+    std::vector<int> freeNodes;
+    std::vector<std::vector<int> > clusterNodes;          //node ids inside each cluster
+    std::vector<std::vector<int> > borderNodes;           //node ids created for each border, both sides
+
+    //cluster search scratch, indexed by tile inside the cluster
+    std::vector<std::pair<float, int> > localHeap;
+    std::vector<float> localCost;
+    std::vector<int> localParent;
+    std::vector<unsigned> localStamp;
+    unsigned localGeneration;
+
+    //abstract search scratch, the last two slots are the start and the goal
+    std::vector<std::pair<float, int> > abstractHeap;
+    std::vector<float> abstractCost;
+    std::vector<int> abstractParent;
+    std::vector<unsigned> abstractStamp;
+    unsigned abstractGeneration;
+    std::vector<float> goalCost;        //cost from each node of the goal's cluster to the goal
+  };
+};
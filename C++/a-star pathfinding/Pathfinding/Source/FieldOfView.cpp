@@ -0,0 +1,178 @@
+#include <Stdafx.h>
+
+// Each quadrant sweeps rows at growing depth, its columns running across
+// them: depth row and column steps, then column row and column steps. A
+// quadrant's far diagonal is the next one's near diagonal and only the
+// near one is kept, so no tile is reported twice.
+static const int s_quadrants[4][4] =
+{
+	{ -1, 0, 0, 1 },
+	{ 0, 1, 1, 0 },
+	{ 1, 0, 0, -1 },
+	{ 0, -1, -1, 0 }
+};
+
+static inline int FloorDiv(int num, int den)
+{
+	return (num >= 0) ? num / den : -((den - 1 - num) / den);
+}
+
+// sign of num0 / den0 - num1 / den1, denominators positive
+static inline int CompareSlopes(int num0, int den0, int num1, int den1)
+{
+	int diff = num0 * den1 - num1 * den0;
+	return (diff > 0) - (diff < 0);
+}
+
+FieldOfView::FieldOfView(void)
+	: m_cone(false),
+	m_dirX(0.0f),
+	m_dirZ(0.0f),
+	m_dirLength(0.0f),
+	m_minCosine(-1.0f)
+{
+}
+
+void FieldOfView::Compute(const Map& map, int row, int col, std::vector<int>& tiles)
+{
+	m_cone = false;
+	ComputeTiles(map, row, col, tiles);
+}
+
+void FieldOfView::Compute(const Map& map, int row, int col, float dirX, float dirZ, float minCosine, std::vector<int>& tiles)
+{
+	m_cone = true;
+	m_dirX = dirX;
+	m_dirZ = dirZ;
+	m_dirLength = sqrtf(dirX * dirX + dirZ * dirZ);
+	m_minCosine = minCosine;
+	ComputeTiles(map, row, col, tiles);
+}
+
+void FieldOfView::ComputeTiles(const Map& map, int row, int col, std::vector<int>& tiles)
+{
+	tiles.clear();
+
+	int width = map.GetWidth();
+	if (row < 0 || row >= width || col < 0 || col >= width || map.IsWall(row, col))
+		return;
+
+	tiles.push_back(row * width + col);
+	for (int quadrant = 0; quadrant < 4; ++quadrant)
+		SweepQuadrant(map, row, col, quadrant, tiles);
+}
+
+// A line from the viewer to a tile at depth d and column x has slope x / d.
+// A wall at depth dw and column xw touches every line whose slope lies
+// between the lowest and highest slope of its corners, (xw -+ 1/2) over
+// (dw -+ 1/2), and so hides them from every deeper row. In its own row it
+// only hides the diagonal tile beside it, through the shared corner.
+void FieldOfView::SweepQuadrant(const Map& map, int row, int col, int quadrant, std::vector<int>& tiles)
+{
+	int width = map.GetWidth();
+	const int* q = s_quadrants[quadrant];
+
+	// A cone wider than 180 degrees leaves out a narrower, convex wedge
+	// behind the viewer. If both diagonals fall in that wedge, so does the
+	// whole quadrant. A narrower cone could fit between the diagonals.
+	if (m_cone && m_minCosine < 0.0f && !InCone(q[0] - q[2], q[1] - q[3]) && !InCone(q[0] + q[2], q[1] + q[3]))
+		return;
+
+	int maxDepth = (q[0] < 0) ? row : (q[0] > 0) ? width - 1 - row : (q[1] > 0) ? width - 1 - col : col;
+	if (maxDepth == 0)
+		return;
+
+	// walls right beside the viewer only touch the diagonals
+	int rSide = row - q[2];
+	int cSide = col - q[3];
+	bool nearOpen = rSide < 0 || rSide >= width || cSide < 0 || cSide >= width || !map.IsWall(rSide, cSide);
+	rSide = row + q[2];
+	cSide = col + q[3];
+	bool farOpen = rSide < 0 || rSide >= width || cSide < 0 || cSide >= width || !map.IsWall(rSide, cSide);
+
+	Span first = { 1, { -1, 1, nearOpen }, { 1, 1, farOpen } };
+	m_spans.clear();
+	m_spans.push_back(first);
+
+	while (!m_spans.empty())
+	{
+		Span span = m_spans.back();
+		m_spans.pop_back();
+
+		int d = span.depth;
+		int xFirst = (std::max)(FloorDiv(span.start.num * d, span.start.den) - 1, -(d + 1));
+		int xLast = (std::min)(FloorDiv(span.end.num * d, span.end.den) + 1, d + 1);
+
+		Slope open = span.start;
+		bool spanOpen = true;
+
+		for (int x = xFirst; x <= xLast; ++x)
+		{
+			int r = row + d * q[0] + x * q[2];
+			int c = col + d * q[1] + x * q[3];
+			if (r < 0 || r >= width || c < 0 || c >= width)
+				continue;
+
+			bool wall = map.IsWall(r, c);
+			if (!wall && x >= -d && x < d)
+			{
+				int startSide = CompareSlopes(span.start.num, span.start.den, x, d);
+				int endSide = CompareSlopes(x, d, span.end.num, span.end.den);
+				bool inside = (startSide < 0 || (startSide == 0 && span.start.closed)) &&
+					(endSide < 0 || (endSide == 0 && span.end.closed));
+
+				// the near diagonal is also hidden by the wall beside it
+				if (inside && x == -d && map.IsWall(r + q[2], c + q[3]))
+					inside = false;
+
+				if (inside && (!m_cone || InCone(r - row, c - col)))
+					tiles.push_back(r * width + c);
+			}
+
+			if (!wall || !spanOpen)
+				continue;
+
+			int loNum = 2 * x - 1;
+			int loDen = (loNum >= 0) ? 2 * d + 1 : 2 * d - 1;
+			int hiNum = 2 * x + 1;
+			int hiDen = (hiNum >= 0) ? 2 * d - 1 : 2 * d + 1;
+
+			int loSide = CompareSlopes(loNum, loDen, span.end.num, span.end.den);
+			int hiSide = CompareSlopes(hiNum, hiDen, open.num, open.den);
+			if (loSide > 0 || (loSide == 0 && !span.end.closed) || hiSide < 0 || (hiSide == 0 && !open.closed))
+				continue;	// misses the open slopes
+
+			int before = CompareSlopes(open.num, open.den, loNum, loDen);
+			if (before < 0 && d < maxDepth)
+			{
+				Span next = { d + 1, open, { loNum, loDen, false } };
+				m_spans.push_back(next);
+			}
+
+			open.num = hiNum;
+			open.den = hiDen;
+			open.closed = false;
+
+			int after = CompareSlopes(open.num, open.den, span.end.num, span.end.den);
+			spanOpen = after < 0;
+		}
+
+		if (spanOpen && d < maxDepth)
+		{
+			int after = CompareSlopes(open.num, open.den, span.end.num, span.end.den);
+			if (after < 0 || (after == 0 && open.closed && span.end.closed))
+			{
+				Span next = { d + 1, open, span.end };
+				m_spans.push_back(next);
+			}
+		}
+	}
+}
+
+bool FieldOfView::InCone(int dr, int dc) const
+{
+	// columns run along x and rows along z
+	float x = static_cast<float>(dc);
+	float z = static_cast<float>(dr);
+	return x * m_dirX + z * m_dirZ >= m_minCosine * sqrtf(x * x + z * z) * m_dirLength;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+class Map;
+
+// The tiles a viewer sees, as Map::IsClearPath decides it, found by
+// shadowcasting instead of walking a line to every tile. Each quadrant is
+// swept outward a row at a time over spans of still open slopes. A wall
+// cuts out every slope whose line would touch its square, corners included,
+// so only the tiles in open spans and the walls bounding them are visited.
+class FieldOfView
+{
+public:
+	FieldOfView(void);
+
+	// Fills tiles with the tiles seen from (row, col) as row * width + col,
+	// the viewer's own tile first. Nothing is seen from inside a wall.
+	void Compute(const Map& map, int row, int col, std::vector<int>& tiles);
+
+	// Keeps just the tiles within the facing cone, those whose cosine to the
+	// direction (dirX along columns, dirZ along rows) is at least minCosine.
+	// With a cone wider than 180 degrees (minCosine below 0) the quadrants
+	// wholly behind the viewer aren't swept.
+	void Compute(const Map& map, int row, int col, float dirX, float dirZ, float minCosine, std::vector<int>& tiles);
+
+private:
+	// num / den with den > 0, closed when the slope itself is open
+	struct Slope
+	{
+		int num;
+		int den;
+		bool closed;
+	};
+
+	// open slopes of a quadrant still to sweep from a row on
+	struct Span
+	{
+		int depth;
+		Slope start;
+		Slope end;
+	};
+
+	std::vector<Span> m_spans;
+
+	// facing cone of the current Compute, if it has one
+	bool m_cone;
+	float m_dirX, m_dirZ, m_dirLength;
+	float m_minCosine;
+
+	void ComputeTiles(const Map& map, int row, int col, std::vector<int>& tiles);
+	void SweepQuadrant(const Map& map, int row, int col, int quadrant, std::vector<int>& tiles);
+	bool InCone(int dr, int dc) const;
+};
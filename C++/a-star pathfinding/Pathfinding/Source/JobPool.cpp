@@ -0,0 +1,144 @@
+#include <Stdafx.h>
+#include <algorithm>
+
+JobPool::JobPool( void )
+: m_job( 0 ),
+  m_count( 0 ),
+  m_batchSize( JOB_POOL_BATCH_SIZE ),
+  m_run( 0 ),
+  m_busyWorkers( 0 ),
+  m_quit( false ),
+  m_next( 0 )
+{
+}
+
+JobPool::~JobPool( void )
+{
+	StopWorkers();
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         Run
+
+  Description:  Calls the job for every index below count, spread over the
+				workers and the calling thread.
+
+  Arguments:    count     : the number of indices
+				job       : called with the thread's worker number and an index
+				batchSize : indices a thread takes at a time
+
+  Returns:      None, once every index is done.
+ *---------------------------------------------------------------------------*/
+void JobPool::Run( unsigned int count, const Job & job, unsigned int batchSize )
+{
+	if( m_workers.empty() || count <= batchSize )
+	{	//Not worth waking anyone
+		for( unsigned int i = 0; i < count; ++i ) {
+			job( 0, i );
+		}
+		return;
+	}
+
+	m_job = &job;
+	m_count = count;
+	m_batchSize = batchSize;
+	m_next = 0;
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		++m_run;
+		m_busyWorkers = static_cast<unsigned int>( m_workers.size() );
+	}
+	m_wake.notify_all();
+
+	RunBatches( 0 );
+
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_done.wait( lock, [this] { return( m_busyWorkers == 0 ); } );
+	}
+	m_job = 0;
+}
+
+JobPool & JobPool::GetAnalysisPool( void )
+{
+	static JobPool s_pool;
+	if( s_pool.GetWorkerCount() == 0 )
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		if( cores > 1 ) {
+			s_pool.SetWorkerCount( cores - 1 );
+		}
+	}
+	return( s_pool );
+}
+
+void JobPool::SetWorkerCount( unsigned int count )
+{
+	if( count != m_workers.size() )
+	{
+		StopWorkers();
+		StartWorkers( count );
+	}
+}
+
+void JobPool::StartWorkers( unsigned int count )
+{
+	//Workers start out having seen the current run so they wait for the next one
+	for( unsigned int i = 0; i < count; ++i ) {
+		m_workers.push_back( std::thread( &JobPool::WorkerLoop, this, i + 1, m_run ) );
+	}
+}
+
+void JobPool::StopWorkers( void )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for( unsigned int i = 0; i < m_workers.size(); ++i ) {
+		m_workers[i].join();
+	}
+	m_workers.clear();
+	m_quit = false;
+}
+
+void JobPool::WorkerLoop( unsigned int worker, unsigned int seen )
+{
+	while( true )
+	{
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_wake.wait( lock, [this, seen] { return( m_quit || m_run != seen ); } );
+			if( m_quit ) {
+				return;
+			}
+			seen = m_run;
+		}
+
+		RunBatches( worker );
+
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			--m_busyWorkers;
+		}
+		m_done.notify_one();
+	}
+}
+
+void JobPool::RunBatches( unsigned int worker )
+{
+	while( true )
+	{
+		unsigned int first = m_next.fetch_add( m_batchSize );
+		if( first >= m_count ) {
+			return;
+		}
+
+		unsigned int last = (std::min)( first + m_batchSize, m_count );
+		for( unsigned int i = first; i < last; ++i ) {
+			(*m_job)( worker, i );
+		}
+	}
+}
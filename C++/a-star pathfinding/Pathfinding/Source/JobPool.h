@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Indices a thread takes from the shared counter at a time, unless Run is
+// given another batch size
+#define JOB_POOL_BATCH_SIZE 16
+
+// Worker threads that run one job over a range of indices. The thread that
+// calls Run takes indices too, as worker 0, and Run returns once every index
+// is done, so a pool without workers runs the job in place. Each thread
+// takes its batches in increasing order.
+class JobPool
+{
+public:
+
+	typedef std::function<void( unsigned int worker, unsigned int index )> Job;
+
+	JobPool( void );
+	~JobPool( void );
+
+	// Long jobs, like whole path searches, want a batch size of 1 so the
+	// threads share them out evenly
+	void Run( unsigned int count, const Job & job, unsigned int batchSize = JOB_POOL_BATCH_SIZE );
+
+	// Shared by the map and terrain analyses, one worker per spare core
+	static JobPool & GetAnalysisPool( void );
+
+	// Threads besides the one calling Run, not to be changed during a Run
+	void SetWorkerCount( unsigned int count );
+	inline unsigned int GetWorkerCount( void )		{ return( static_cast<unsigned int>( m_workers.size() ) ); }
+
+private:
+
+	void StartWorkers( unsigned int count );
+	void StopWorkers( void );
+	void WorkerLoop( unsigned int worker, unsigned int seen );
+	void RunBatches( unsigned int worker );
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	const Job* m_job;
+	unsigned int m_count;
+	unsigned int m_batchSize;
+	unsigned int m_run;					//Bumped to start a run
+	unsigned int m_busyWorkers;			//Workers still in the current run
+	bool m_quit;
+	std::atomic<unsigned int> m_next;	//First index not taken yet
+};
@@ -10,11 +10,31 @@
 
 #include <Stdafx.h>
 
+#include <climits>
+#include <utility>
+
+// Every map and every bulk wall change gets its own range of versions, so a
+// version taken from one map is never mistaken for a version of another
+static unsigned NewWallVersionRange(void)
+{
+	static unsigned s_nextRange = 0;
+	return (s_nextRange++) * (MAX_WALL_LOG_SIZE + 1) + 1;
+}
+
 Map::Map()
 	: m_width(0),
 	m_terrain(0),
 	m_terrainColor(0),
-	m_terrainInfluenceMap(0)
+	m_terrainInfluenceMap(0),
+	m_influenceTemp(0),
+	m_influenceBlock(0),
+	m_influenceStride(0),
+	m_wallMask(0),
+	m_wallMaskWords(0),
+	m_jumpDistances(0),
+	m_wallVersion(NewWallVersionRange()),
+	m_jumpDistancesVersion(0),
+	m_wallLogVersion(m_wallVersion)
 {
 }
 
@@ -22,16 +42,56 @@ Map::Map(int width)
 	: m_width(width),
 	m_terrain(0),
 	m_terrainColor(0),
-	m_terrainInfluenceMap(0)
+	m_terrainInfluenceMap(0),
+	m_influenceTemp(0),
+	m_influenceBlock(0),
+	m_influenceStride(0),
+	m_wallMask(0),
+	m_wallMaskWords(0),
+	m_jumpDistances(0),
+	m_wallVersion(NewWallVersionRange()),
+	m_jumpDistancesVersion(0),
+	m_wallLogVersion(m_wallVersion)
 {
 	InitArray(m_terrain);
 	InitArray(m_terrainColor);
-	InitArray(m_terrainInfluenceMap);
+	InitInfluenceLayers();
+	InitWallMask();
 }
 
 void Map::Serialize(const std::wstring& filename)
 {
 	m_filename = filename;
+
+	// binary maps are mapped in and copied straight into the layers
+	MappedFile file;
+	if (file.Open(filename) && file.GetSize() >= sizeof(unsigned int) &&
+		*reinterpret_cast<const unsigned int*>(file.GetData()) == MAP_FILE_MAGIC)
+	{
+		if (LoadBinary(file))
+			return;
+		file.Close();
+
+		// damaged or from another version, the text twin is loaded instead
+		// and converted again for next time
+		OutputDebugString((L"Map file is damaged or from another version: " + filename + L"\n").c_str());
+
+		std::wstring text = filename.substr(0, filename.size() - wcslen(MAP_FILE_EXTENSION)) + L".txt";
+		if (!std::ifstream(text.c_str()).good())
+		{
+			OutputDebugString((L"No text map to fall back on: " + text + L"\n").c_str());
+			return;
+		}
+
+		if (!ConvertToBinary(text, filename))
+			OutputDebugString((L"Map file could not be written again: " + filename + L"\n").c_str());
+
+		Serialize(text);
+		m_filename = filename;
+		return;
+	}
+	file.Close();
+
 	std::ifstream in(filename.c_str());
 
 	assert(in.good() && "File not found");
@@ -44,7 +104,8 @@ void Map::Serialize(const std::wstring& filename)
 	// initialize storage
 	InitArray(m_terrain);
 	InitArray(m_terrainColor);
-	InitArray(m_terrainInfluenceMap);
+	InitInfluenceLayers();
+	InitWallMask();
 
 	// read in map data
 	for (int r = 0; r < m_width; ++r)
@@ -63,13 +124,128 @@ void Map::Serialize(const std::wstring& filename)
 				assert("Invalid tile type");
 			}
 		}
+
+	BuildWallMask();
+}
+
+bool Map::LoadBinary(const MappedFile& file)
+{
+	assert(!m_width && !m_terrain && !m_terrainColor &&
+		!m_terrainInfluenceMap && "Map may already have data");
+
+	if (file.GetSize() < sizeof(MapFileHeader))
+		return false;
+
+	const unsigned char* data = file.GetData();
+	const MapFileHeader& header = *reinterpret_cast<const MapFileHeader*>(data);
+	if (header.m_magic != MAP_FILE_MAGIC || header.m_version != MAP_FILE_VERSION ||
+		header.m_width <= 0 || header.m_width > MAP_FILE_MAX_WIDTH || header.m_size != file.GetSize())
+		return false;
+
+	// sizes are worked out wide so a damaged header can't wrap them past the checks
+	unsigned long long size = header.m_size;
+	unsigned long long tiles = static_cast<unsigned long long>(header.m_width) * header.m_width;
+	unsigned long long wallBytes = header.m_width * ((header.m_width + 31ull) / 32) * sizeof(unsigned int);
+	unsigned long long jumpBytes = tiles * sizeof(JumpDistances);
+	unsigned long long visibilityBytes = tiles * ((tiles + 31) / 32) * sizeof(unsigned int);
+	if (header.m_wallOffset > size || wallBytes > size - header.m_wallOffset)
+		return false;
+	if ((header.m_layers & MAP_FILE_JUMP_DISTANCES) && (header.m_jumpOffset > size || jumpBytes > size - header.m_jumpOffset))
+		return false;
+	if ((header.m_layers & MAP_FILE_VISIBILITY) && (tiles > VISIBILITY_MAX_TILES ||
+		header.m_visibilityOffset > size || visibilityBytes > size - header.m_visibilityOffset))
+		return false;
+
+	m_width = header.m_width;
+	InitArray(m_terrain);
+	InitArray(m_terrainColor);
+	InitInfluenceLayers();
+	InitWallMask();
+
+	// the tiles are spelled out from the mask
+	memcpy(m_wallMask, data + header.m_wallOffset, static_cast<size_t>(wallBytes));
+	for (int r = 0; r < m_width; ++r)
+		for (int c = 0; c < m_width; ++c)
+			m_terrain[r][c] = IsWall(r, c) ? TILE_WALL : TILE_EMPTY;
+
+	if (header.m_layers & MAP_FILE_JUMP_DISTANCES)
+	{
+		InitArray(m_jumpDistances);
+		memcpy(m_jumpDistances[0], data + header.m_jumpOffset, static_cast<size_t>(jumpBytes));
+		m_jumpDistancesVersion = m_wallVersion;
+	}
+
+	if (header.m_layers & MAP_FILE_VISIBILITY)
+		m_visibility.Load(*this, reinterpret_cast<const unsigned int*>(data + header.m_visibilityOffset));
+
+	return true;
+}
+
+// Walls plus the jump distances and, for maps small enough to have one, the
+// visibility set, computed now if they aren't already. Returns false when
+// the file couldn't be written or the map is too wide for one.
+bool Map::SaveBinary(const std::wstring& filename)
+{
+	if (m_width > MAP_FILE_MAX_WIDTH)
+		return false;
+
+	JumpDistances** jumpDistances = GetJumpDistances();
+	const VisibilitySet* visibility = GetVisibility();
+
+	size_t tiles = static_cast<size_t>(m_width) * m_width;
+	size_t wallBytes = m_width * m_wallMaskWords * sizeof(unsigned int);
+	size_t jumpBytes = tiles * sizeof(JumpDistances);
+	size_t visibilityBytes = visibility ? visibility->GetBits().size() * sizeof(unsigned int) : 0;
+
+	MapFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.m_magic = MAP_FILE_MAGIC;
+	header.m_version = MAP_FILE_VERSION;
+	header.m_width = m_width;
+	header.m_layers = MAP_FILE_JUMP_DISTANCES | (visibility ? MAP_FILE_VISIBILITY : 0);
+	header.m_wallOffset = sizeof(MapFileHeader);
+	header.m_jumpOffset = static_cast<unsigned int>(header.m_wallOffset + wallBytes);
+	header.m_visibilityOffset = visibility ? static_cast<unsigned int>(header.m_jumpOffset + jumpBytes) : 0;
+	header.m_size = static_cast<unsigned int>(sizeof(MapFileHeader) + wallBytes + jumpBytes + visibilityBytes);
+
+	std::ofstream out(filename.c_str(), std::ios::binary);
+	if (!out.is_open())
+		return false;
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(m_wallMask), wallBytes);
+	out.write(reinterpret_cast<const char*>(jumpDistances[0]), jumpBytes);
+	if (visibility)
+		out.write(reinterpret_cast<const char*>(&visibility->GetBits()[0]), visibilityBytes);
+
+	out.close();
+	return !out.fail();
+}
+
+bool Map::ConvertToBinary(const std::wstring& textFile, const std::wstring& binaryFile)
+{
+	Map map;
+	map.Serialize(textFile);
+	bool saved = map.SaveBinary(binaryFile);
+	map.Destroy();
+
+	return saved;
 }
 
 void Map::Destroy()
 {
 	DestroyArray(m_terrain);
 	DestroyArray(m_terrainColor);
-	DestroyArray(m_terrainInfluenceMap);
+	DestroyInfluenceLayers();
+
+	delete[] m_wallMask;
+	m_wallMask = 0;
+	m_wallMaskWords = 0;
+
+	if (m_jumpDistances)
+		DestroyArray(m_jumpDistances);
+
+	m_visibility.Clear();
 }
 
 int Map::GetWidth() const
@@ -92,6 +268,81 @@ float** Map::GetInfluenceMap() const
 	return m_terrainInfluenceMap;
 }
 
+float** Map::GetInfluenceTemp() const
+{
+	return m_influenceTemp;
+}
+
+int Map::GetInfluenceStride() const
+{
+	return m_influenceStride;
+}
+
+// The temp layer becomes the influence map, row pointers held elsewhere must be fetched again
+void Map::SwapInfluenceLayers(void)
+{
+	std::swap(m_terrainInfluenceMap, m_influenceTemp);
+}
+
+// JPS+ distances, rebuilt on first use after the walls change
+JumpDistances** Map::GetJumpDistances()
+{
+	if (m_jumpDistancesVersion != m_wallVersion)
+		ComputeJumpDistances();
+
+	return m_jumpDistances;
+}
+
+// Which tiles see each other, patched or rebuilt on first use after the
+// walls change. Null for maps too large to keep one.
+const VisibilitySet* Map::GetVisibility()
+{
+	if (m_visibility.GetVersion() != m_wallVersion && !m_visibility.Update(*this))
+		return 0;
+
+	return &m_visibility;
+}
+
+unsigned Map::GetWallVersion() const
+{
+	return m_wallVersion;
+}
+
+// Tiles (row * width + col) changed since version. Returns false when the
+// log no longer reaches back that far and the caller has to rebuild.
+bool Map::GetWallChanges(unsigned version, std::vector<int> &tiles) const
+{
+	if (version < m_wallLogVersion || version > m_wallVersion)
+		return false;
+
+	for (unsigned i = version - m_wallLogVersion; i < m_wallLog.size(); ++i)
+		tiles.push_back(m_wallLog[i]);
+
+	return true;
+}
+
+// Any number of walls changed at once, everybody rebuilds
+void Map::WallsChanged(void)
+{
+	BuildWallMask();
+
+	m_wallVersion = NewWallVersionRange();
+	m_wallLog.clear();
+	m_wallLogVersion = m_wallVersion;
+}
+
+void Map::LogWallChange(int row, int col)
+{
+	if (m_wallLog.size() >= MAX_WALL_LOG_SIZE)
+	{
+		WallsChanged();
+		return;
+	}
+
+	++m_wallVersion;
+	m_wallLog.push_back(row * m_width + col);
+}
+
 void Map::PlaceWall(int &row, int &col)
 {
 	if (row < 0 || row >= m_width)
@@ -104,6 +355,8 @@ void Map::PlaceWall(int &row, int &col)
 		return;
 
 	curTile = Tile::TILE_WALL;
+	SetWallBit(row, col, true);
+	LogWallChange(row, col);
 }
 
 void Map::RemoveWall(int &row, int &col)
@@ -116,11 +369,22 @@ void Map::RemoveWall(int &row, int &col)
 	Tile &curTile = m_terrain[row][col];
 	m_terrainColor[row][col] = DEBUG_COLOR_WHITE;
 
+	if (curTile == Tile::TILE_WALL)
+		LogWallChange(row, col);
+
 	curTile = Tile::TILE_EMPTY;
+	SetWallBit(row, col, false);
 }
 
 void Map::SaveMap(void)
 {
+	if (m_filename.size() > wcslen(MAP_FILE_EXTENSION) &&
+		m_filename.compare(m_filename.size() - wcslen(MAP_FILE_EXTENSION), std::wstring::npos, MAP_FILE_EXTENSION) == 0)
+	{
+		SaveBinary(m_filename);
+		return;
+	}
+
 	std::ofstream out(m_filename.c_str());
 
 	if (out.is_open() == false)
@@ -131,6 +395,12 @@ void Map::SaveMap(void)
 		out.open(m_filename.c_str());
 	}
 
+	WriteText(out);
+	out.close();
+}
+
+void Map::WriteText(std::ostream& out) const
+{
 	// width is stored first
 	out << m_width << std::endl << std::endl;
 
@@ -146,6 +416,220 @@ void Map::SaveMap(void)
 		}
 		out << std::endl;
 	}
+}
 
-	out.close();
+void Map::InitInfluenceLayers(void)
+{
+	assert(m_width > 0 && "Invalid width for map");
+	assert(!m_influenceBlock && "Map data may already be initialized!");
+
+	// a zero tile either side of the row, rounded up to whole 16-byte groups
+	m_influenceStride = (INFLUENCE_ROW_OFFSET + m_width + 1 + 3) & ~3;
+	int layerSize = (m_width + 2) * m_influenceStride;
+
+	m_influenceBlock = static_cast<float*>(_mm_malloc(2 * layerSize * sizeof(float), 16));
+	memset(m_influenceBlock, 0, 2 * layerSize * sizeof(float));
+
+	m_terrainInfluenceMap = new float*[m_width];
+	m_influenceTemp = new float*[m_width];
+	for (int r = 0; r < m_width; ++r)
+	{
+		m_terrainInfluenceMap[r] = m_influenceBlock + (r + 1) * m_influenceStride + INFLUENCE_ROW_OFFSET;
+		m_influenceTemp[r] = m_terrainInfluenceMap[r] + layerSize;
+	}
+}
+
+void Map::DestroyInfluenceLayers(void)
+{
+	delete[] m_terrainInfluenceMap;
+	delete[] m_influenceTemp;
+	_mm_free(m_influenceBlock);
+
+	m_terrainInfluenceMap = 0;
+	m_influenceTemp = 0;
+	m_influenceBlock = 0;
+	m_influenceStride = 0;
+}
+
+const unsigned int* Map::GetWallMask() const
+{
+	return m_wallMask;
+}
+
+int Map::GetWallMaskWords() const
+{
+	return m_wallMaskWords;
+}
+
+void Map::InitWallMask(void)
+{
+	assert(!m_wallMask && "Map data may already be initialized!");
+
+	m_wallMaskWords = (m_width + 31) / 32;
+	m_wallMask = new unsigned int[m_width * m_wallMaskWords]();
+}
+
+// Walls read back from the tiles after they were written directly
+void Map::BuildWallMask(void)
+{
+	if (!m_wallMask)
+		return;
+
+	memset(m_wallMask, 0, m_width * m_wallMaskWords * sizeof(unsigned int));
+
+	for (int r = 0; r < m_width; ++r)
+		for (int c = 0; c < m_width; ++c)
+			if (m_terrain[r][c] == TILE_WALL)
+				m_wallMask[r * m_wallMaskWords + (c >> 5)] |= 1u << (c & 31);
+}
+
+void Map::SetWallBit(int row, int col, bool wall)
+{
+	unsigned int& word = m_wallMask[row * m_wallMaskWords + (col >> 5)];
+	if (wall)
+		word |= 1u << (col & 31);
+	else
+		word &= ~(1u << (col & 31));
+}
+
+bool Map::IsOpen(int row, int col) const
+{
+	return row >= 0 && row < m_width && col >= 0 && col < m_width && !IsWall(row, col);
+}
+
+bool Map::IsClearPath(int r0, int c0, int r1, int c1) const
+{
+	// Two grid squares (r0,c0) and (r1,c1) are visible to each other 
+	// if a line between their centerpoints doesn't intersect the four 
+	// boundary lines of every walled grid square. A diagonal line passing
+	// exactly through a corner counts as touching both squares beside it.
+	//
+	// Supercover walk: only the squares the line enters are tested, in the
+	// order it enters them, instead of intersecting it with every wall.
+
+	int dr = abs(r1 - r0);
+	int dc = abs(c1 - c0);
+	int stepR = (r1 > r0) ? 1 : -1;
+	int stepC = (c1 > c0) ? 1 : -1;
+
+	int r = r0;
+	int c = c0;
+	if (IsWall(r, c))
+		return false;
+
+	// ir and ic count the row and column boundaries crossed so far. The next
+	// column boundary is at (1 + 2*ic) / (2*dc) along the line and the next row
+	// boundary at (1 + 2*ir) / (2*dr), compared here without the division.
+	for (int ir = 0, ic = 0; ir < dr || ic < dc; )
+	{
+		int decision = (1 + 2 * ic) * dr - (1 + 2 * ir) * dc;
+
+		if (decision == 0)
+		{
+			// through a corner, both squares beside it are touched
+			if (IsWall(r + stepR, c) || IsWall(r, c + stepC))
+				return false;
+
+			r += stepR;
+			c += stepC;
+			++ir;
+			++ic;
+		}
+		else if (decision < 0)
+		{
+			c += stepC;
+			++ic;
+		}
+		else
+		{
+			r += stepR;
+			++ir;
+		}
+
+		if (IsWall(r, c))
+			return false;
+	}
+
+	return true;
+}
+
+// A tile entered while travelling straight along (dr, dc) is a jump point when
+// one of its sides opens up next to a wall the traveller just passed.
+bool Map::IsPrimaryJumpPoint(int row, int col, int dr, int dc) const
+{
+	if (dr == 0)
+		return (IsOpen(row - 1, col) && !IsOpen(row - 1, col - dc)) ||
+			(IsOpen(row + 1, col) && !IsOpen(row + 1, col - dc));
+
+	return (IsOpen(row, col - 1) && !IsOpen(row - dr, col - 1)) ||
+		(IsOpen(row, col + 1) && !IsOpen(row - dr, col + 1));
+}
+
+// Sweep each direction once, every tile reuses the distance of the tile it steps onto.
+// Diagonal moves may not cut corners, matching the A* neighbour rules.
+void Map::ComputeJumpDistances(void)
+{
+	static const int dirs[JUMP_COUNT][2] =
+	{
+		{ 1, 0 }, { -1, 0 }, { 0, -1 }, { 0, 1 },
+		{ 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 }
+	};
+
+	assert(m_width <= SHRT_MAX && "Map too wide for JPS+ distances");
+
+	if (!m_jumpDistances)
+		InitArray(m_jumpDistances);
+
+	// straight directions first, the diagonal sweeps read them
+	for (int d = 0; d < JUMP_COUNT; ++d)
+	{
+		int dr = dirs[d][0];
+		int dc = dirs[d][1];
+		bool diagonal = dr != 0 && dc != 0;
+
+		// visit the tile a step ahead before the tile behind it
+		int rFirst = (dr > 0) ? m_width - 1 : 0;
+		int rStep = (dr > 0) ? -1 : 1;
+		int cFirst = (dc > 0) ? m_width - 1 : 0;
+		int cStep = (dc > 0) ? -1 : 1;
+
+		for (int r = rFirst; r >= 0 && r < m_width; r += rStep)
+		{
+			for (int c = cFirst; c >= 0 && c < m_width; c += cStep)
+			{
+				short &dist = m_jumpDistances[r][c].m_dist[d];
+				int rNext = r + dr;
+				int cNext = c + dc;
+
+				if (!IsOpen(r, c) || !IsOpen(rNext, cNext) ||
+					(diagonal && (!IsOpen(rNext, c) || !IsOpen(r, cNext))))
+				{
+					dist = 0;
+					continue;
+				}
+
+				short next = m_jumpDistances[rNext][cNext].m_dist[d];
+				bool jumpPoint;
+				if (diagonal)
+				{
+					// a diagonal stops where either straight component reaches a jump point
+					int vertical = (dr > 0) ? JUMP_UP : JUMP_DOWN;
+					int horizontal = (dc > 0) ? JUMP_RIGHT : JUMP_LEFT;
+					jumpPoint = m_jumpDistances[rNext][cNext].m_dist[vertical] > 0 ||
+						m_jumpDistances[rNext][cNext].m_dist[horizontal] > 0;
+				}
+				else
+					jumpPoint = IsPrimaryJumpPoint(rNext, cNext, dr, dc);
+
+				if (jumpPoint)
+					dist = 1;
+				else if (next > 0)
+					dist = next + 1;
+				else
+					dist = next - 1;
+			}
+		}
+	}
+
+	m_jumpDistancesVersion = m_wallVersion;
 }
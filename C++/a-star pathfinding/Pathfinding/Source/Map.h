@@ -12,6 +12,25 @@
 
 #include "debugdrawing.h"
 
+#include <xmmintrin.h>
+
+// Wall edits remembered tile by tile before consumers have to rebuild from scratch
+#define MAX_WALL_LOG_SIZE 1024
+
+// Floats ahead of each influence row, keeps the rows 16-byte aligned with a zero tile to their left
+#define INFLUENCE_ROW_OFFSET 4
+
+// Map layers start on a cache line
+#define MAP_LAYER_ALIGNMENT 64
+
+// Binary map files, "DPMP" in the first four bytes
+#define MAP_FILE_MAGIC 0x504D5044
+#define MAP_FILE_VERSION 1
+#define MAP_FILE_EXTENSION L".map"
+
+// Widest map a binary file may hold, keeps every layer's size well within 32 bits
+#define MAP_FILE_MAX_WIDTH 4096
+
 enum Tile
 {
 	TILE_WALL = -1,
@@ -19,6 +38,49 @@ enum Tile
 	TILE_WALL_INVISIBLE,
 };
 
+// Directions of the JPS+ jump distances, same order as AStar::MovementAlgo::directions
+enum JumpDirection
+{
+	JUMP_UP,
+	JUMP_DOWN,
+	JUMP_LEFT,
+	JUMP_RIGHT,
+	JUMP_UP_RIGHT,
+	JUMP_DOWN_RIGHT,
+	JUMP_UP_LEFT,
+	JUMP_DOWN_LEFT,
+	JUMP_COUNT
+};
+
+// JPS+ distances for one tile. Positive is the number of steps to the next
+// jump point, zero or negative is the number of free steps before a wall.
+struct JumpDistances
+{
+	short m_dist[JUMP_COUNT];
+};
+
+// Optional layers a binary map file carries, computed for the walls it was saved with
+enum MapFileLayer
+{
+	MAP_FILE_JUMP_DISTANCES = 1 << 0,
+	MAP_FILE_VISIBILITY = 1 << 1,
+};
+
+// Start of a binary map file. The layers follow as they sit in memory: the
+// wall mask, then any of the JumpDistances rows and the visibility set's
+// bits. Offsets are in bytes from the start of the file.
+struct MapFileHeader
+{
+	unsigned int m_magic;
+	unsigned int m_version;
+	int m_width;
+	unsigned int m_layers;			// MapFileLayer flags
+	unsigned int m_wallOffset;
+	unsigned int m_jumpOffset;
+	unsigned int m_visibilityOffset;
+	unsigned int m_size;			// whole file
+};
+
 class Map {
 private:
 	int m_width;
@@ -27,6 +89,40 @@ private:
 	Tile** m_terrain;
 	DebugDrawingColor** m_terrainColor;
 	float** m_terrainInfluenceMap;
+	float** m_influenceTemp;		// layer propagation writes into, then swaps in
+
+	// both influence layers in one block, each padded with a row of zeros above
+	// and below and a zero tile either side so stencils need no bounds checks
+	float* m_influenceBlock;
+	int m_influenceStride;			// floats from one row to the next
+
+	// one bit per tile, set for TILE_WALL, each row padded to whole words
+	unsigned int* m_wallMask;
+	int m_wallMaskWords;			// words per row
+
+	JumpDistances** m_jumpDistances;
+	unsigned m_wallVersion;
+	unsigned m_jumpDistancesVersion;
+
+	VisibilitySet m_visibility;
+
+	// tiles changed by wall edits, oldest first, m_wallLogVersion is the version before the first one
+	std::vector<int> m_wallLog;
+	unsigned m_wallLogVersion;
+
+	void LogWallChange(int row, int col);
+
+	bool LoadBinary(const MappedFile& file);
+
+	void InitInfluenceLayers(void);
+	void DestroyInfluenceLayers(void);
+	void InitWallMask(void);
+	void BuildWallMask(void);
+	void SetWallBit(int row, int col, bool wall);
+
+	bool IsOpen(int row, int col) const;
+	bool IsPrimaryJumpPoint(int row, int col, int dr, int dc) const;
+	void ComputeJumpDistances(void);
 
 	template <typename T>
 	void InitArray(T**& t)
@@ -34,19 +130,21 @@ private:
 		assert(m_width > 0 && "Invalid width for map");
 		assert(!t && "Map data may already be initialized!");
 
+		// the rows are back to back in one block, t[r] points at row r
 		t = new T*[m_width];
-		for (int i = 0; i < m_width; ++i)
-		{
-			t[i] = new T[m_width];
-			memset(t[i], 0, sizeof(T)*m_width);
-		}
+		t[0] = static_cast<T*>(_mm_malloc(sizeof(T)*m_width*m_width, MAP_LAYER_ALIGNMENT));
+		memset(t[0], 0, sizeof(T)*m_width*m_width);
+		for (int i = 1; i < m_width; ++i)
+			t[i] = t[0] + i * m_width;
 	}
 
 	template <typename T>
 	void DestroyArray(T**& t)
 	{
-		for (int i = 0; i < m_width; ++i)
-			delete[] t[i];
+		if (!t)
+			return;
+
+		_mm_free(t[0]);
 		delete[] t;
 
 		t = 0;
@@ -56,12 +154,30 @@ public:
 	Map(int);
 
 	void Serialize(const std::wstring&);
+	bool SaveBinary(const std::wstring& filename);
+	void WriteText(std::ostream& out) const;
+	static bool ConvertToBinary(const std::wstring& textFile, const std::wstring& binaryFile);
 	void Destroy();
 
 	int GetWidth() const;
 	Tile** GetTerrain() const;
 	DebugDrawingColor** GetTerrainColor() const;
 	float** GetInfluenceMap() const;
+	float** GetInfluenceTemp() const;
+	int GetInfluenceStride() const;
+	void SwapInfluenceLayers(void);
+	JumpDistances** GetJumpDistances();
+	const VisibilitySet* GetVisibility();
+
+	inline bool IsWall(int row, int col) const	{ return ((m_wallMask[row * m_wallMaskWords + (col >> 5)] >> (col & 31)) & 1) != 0; }
+	const unsigned int* GetWallMask() const;
+	int GetWallMaskWords() const;
+
+	bool IsClearPath(int r0, int c0, int r1, int c1) const;
+
+	unsigned GetWallVersion() const;
+	bool GetWallChanges(unsigned version, std::vector<int> &tiles) const;
+	void WallsChanged(void);
 
 	void PlaceWall(int &row, int &col);
 	void RemoveWall(int &row, int &col);
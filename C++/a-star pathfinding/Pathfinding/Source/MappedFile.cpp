@@ -0,0 +1,63 @@
+#include <Stdafx.h>
+
+MappedFile::MappedFile(void)
+	: m_data(0),
+	m_size(0),
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(0)
+{
+}
+
+MappedFile::~MappedFile(void)
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::wstring& filename)
+{
+	Close();
+
+	m_file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingW(m_file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!m_mapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_data)
+	{
+		Close();
+		return false;
+	}
+
+	m_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::Close(void)
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+
+	m_data = 0;
+	m_size = 0;
+	m_mapping = 0;
+	m_file = INVALID_HANDLE_VALUE;
+}
+
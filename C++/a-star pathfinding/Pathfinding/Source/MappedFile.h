@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+// A whole file mapped read-only into memory. The data stays valid until
+// Close or the object goes away, and pages are read in as they are touched.
+class MappedFile
+{
+public:
+	MappedFile(void);
+	~MappedFile(void);
+
+	// Returns false when the file can't be opened or is empty
+	bool Open(const std::wstring& filename);
+	void Close(void);
+
+	inline const unsigned char* GetData(void) const	{ return m_data; }
+	inline size_t GetSize(void) const					{ return m_size; }
+
+private:
+	const unsigned char* m_data;
+	size_t m_size;
+
+	HANDLE m_file;
+	HANDLE m_mapping;
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
@@ -50,6 +50,7 @@ World*					g_pWorld = NULL;		// World object
 bool					g_frontCam = false;		// Default set to front camera
 float					g_heuristicWeight = 1.0f;// Default heuristic weight for A*
 int						g_heuristicCalc = 0;	// Default heuristic calc for A*
+int						g_searchAlgorithm = 0;	// Default search is plain A*
 bool					g_smoothing = false;	//Default smoothing
 bool					g_rubberbanding = false;//Default rubberbanding
 bool					g_straightline = false;	//Default straight line optimization
@@ -113,6 +114,7 @@ D3DXVECTOR3				g_click3D;
 #define	IDC_SAMPLETESTFLAG		44
 #define	IDC_SAMPLETESTPRE		45
 #define	IDC_SAMPLETESTNEXT		46
+#define IDC_TOGGLESEARCHALGORITHM	47
 
 //--------------------------------------------------------------------------------------
 // Forward declarations
@@ -257,6 +259,7 @@ void InitApp()
 	//g_SampleUI.AddButton(IDC_TOGGLECAM, L"Toggle Camera", 45, iY += 26, 120, 24);
 	g_SampleUI.AddButton(IDC_TOGGLEHEURISTICWEIGHT, L"Toggle Weight", 45, iY += 26, 120, 24);
 	g_SampleUI.AddButton(IDC_TOGGLEHEURISTIC, L"Toggle Heuristic", 45, iY += 26, 120, 24);
+	g_SampleUI.AddButton(IDC_TOGGLESEARCHALGORITHM, L"Toggle Algorithm", 45, iY += 26, 120, 24);
 	g_SampleUI.AddButton(IDC_TOGGLESMOOTHING, L"Toggle Smoothing", 45, iY += 26, 120, 24);
 	g_SampleUI.AddButton(IDC_TOGGLERUBBERBANDING, L"Toggle Rubberbanding", 45, iY += 26, 120, 24);
 	g_SampleUI.AddButton(IDC_TOGGLESTRAIGHTLINE, L"Toggle Straight Line", 45, iY += 26, 120, 24);
@@ -840,6 +843,14 @@ void RenderText()
 	else if (g_heuristicCalc == 2) { txtHelper.DrawFormattedTextLine(L"Heuristic Calc:           Chebyshev"); }
 	else { txtHelper.DrawFormattedTextLine(L"Heuristic Calc:           Manhattan"); }
 
+	// Print out Search Algorithm
+	txtHelper.SetForegroundColor(D3DXCOLOR(0.0f, 0.0f, 0.0f, 1.0f));
+	txtHelper.SetInsertionPos(5, y += 10);
+	if (g_searchAlgorithm == 1) { txtHelper.DrawFormattedTextLine(L"Search Algorithm:        JPS"); }
+	else if (g_searchAlgorithm == 2) { txtHelper.DrawFormattedTextLine(L"Search Algorithm:        JPS+"); }
+	else if (g_searchAlgorithm == 3) { txtHelper.DrawFormattedTextLine(L"Search Algorithm:        HPA*"); }
+	else { txtHelper.DrawFormattedTextLine(L"Search Algorithm:        A*"); }
+
 	// Print out Smoothing
 	txtHelper.SetForegroundColor(D3DXCOLOR(0.0f, 0.0f, 0.0f, 1.0f));
 	txtHelper.SetInsertionPos(5, y += 10);
@@ -880,6 +891,11 @@ void RenderText()
 	txtHelper.SetInsertionPos(5, y += 10);
 	txtHelper.DrawFormattedTextLine(L"Pathfinding Time:     %.2f", g_clock.GetStopwatchPathfinding());
 
+	// Print out delayed messages and the heap allocations made for them
+	txtHelper.SetForegroundColor(D3DXCOLOR(0.0f, 0.0f, 0.0f, 1.0f));
+	txtHelper.SetInsertionPos(5, y += 10);
+	txtHelper.DrawFormattedTextLine(L"Messages:                  %u pending, %u allocs", g_msgroute.GetDelayedMessageCount(), g_msgroute.GetAllocationCount());
+
 	// Print out Tiny's Position
 	txtHelper.SetForegroundColor(D3DXCOLOR(0.0f, 0.0f, 0.0f, 1.0f));
 	txtHelper.SetInsertionPos(5, y += 10);
@@ -898,11 +914,10 @@ void RenderText()
 
 	// Print out states
 	txtHelper.SetForegroundColor(D3DXCOLOR(1.0f, 0.0f, 0.0f, 1.0f));
-	dbCompositionList list;
-	g_database.ComposeList(list, OBJECT_Ignore_Type);
+	const dbCompositionList& list = g_database.GetObjectsOfType(OBJECT_Ignore_Type);
 	int starttext = y += 20;
 	int count = 0;
-	dbCompositionList::iterator i;
+	dbCompositionList::const_iterator i;
 	for (i = list.begin(); i != list.end(); ++i)
 	{
 		StateMachine* pStateMachine = (*i)->GetStateMachineManager()->GetStateMachine(STATE_MACHINE_QUEUE_0);
@@ -1402,6 +1417,13 @@ void CALLBACK KeyboardProc(UINT nChar, bool bKeyDown, bool bAltDown, void* pUser
 				break;
 			}
 
+		case VK_F7:
+			if (bAltDown)
+			{
+				g_database.SendMsgFromSystem(MSG_RunBenchmarks);
+				break;
+			}
+
 		case VK_F11:
 			if (bAltDown)
 			{
@@ -1487,6 +1509,14 @@ void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl* pControl, vo
 		g_database.SendMsgFromSystem(MSG_SetHeuristicCalc, MSG_Data(g_heuristicCalc));
 		break;
 
+	case IDC_TOGGLESEARCHALGORITHM:
+		if (g_searchAlgorithm == 0)			{ g_searchAlgorithm = 1; }
+		else if (g_searchAlgorithm == 1)		{ g_searchAlgorithm = 2; }
+		else if (g_searchAlgorithm == 2)		{ g_searchAlgorithm = 3; }
+		else									{ g_searchAlgorithm = 0; }
+		g_database.SendMsgFromSystem(MSG_SetSearchAlgorithm, MSG_Data(g_searchAlgorithm));
+		break;
+
 	case IDC_TOGGLESMOOTHING:
 		g_smoothing = !g_smoothing;
 		g_database.SendMsgFromSystem(MSG_SetSmoothing, MSG_Data(g_smoothing));
@@ -0,0 +1,210 @@
+#include "Stdafx.h"
+#include "PathCache.h"
+#include <algorithm>
+
+using namespace AStar;
+
+AStar::PathCacheStats::PathCacheStats() :
+  lookups(0),
+  hits(0),
+  subpathHits(0),
+  misses(0),
+  invalidations(0),
+  evictions(0)
+{
+}
+
+AStar::PathCache::PathCache(size_t count) :
+  capacity((std::max)(count, static_cast<size_t>(1))),
+  map(nullptr),
+  version(0),
+  width(0)
+{
+}
+
+bool AStar::PathCache::Lookup(const Point& start, const Point& goal, Heuristic heur, float weight, WaypointList& path)
+{
+  ++stats.lookups;
+  if (!IsCurrent())
+  {
+    ++stats.misses;
+    return false;
+  }
+
+  uint32_t startIndex = start.r * width + start.c;
+  uint32_t goalIndex = goal.r * width + goal.c;
+
+  //same route asked for again
+  std::unordered_map<uint64_t, EntryIter>::iterator route = byRoute.find((static_cast<uint64_t>(startIndex) << 32) | goalIndex);
+  if (route != byRoute.end() && route->second->heur == heur && route->second->weight == weight)
+  {
+    entries.splice(entries.begin(), entries, route->second);
+    Emit(*route->second, 0, path);
+    ++stats.hits;
+    return true;
+  }
+
+  //a route to the same goal passing through the start, the rest of an optimal path is optimal too,
+  //but only admissible searches are optimal: weighted ones and manhattan with diagonal moves aren't
+  if (weight > 1.0f || heur == Manhattan)
+  {
+    ++stats.misses;
+    return false;
+  }
+
+  std::pair<std::unordered_multimap<uint32_t, EntryIter>::iterator, std::unordered_multimap<uint32_t, EntryIter>::iterator> range = byGoal.equal_range(goalIndex);
+  for (std::unordered_multimap<uint32_t, EntryIter>::iterator it = range.first; it != range.second; ++it)
+  {
+    const Entry& entry = *it->second;
+    if (entry.heur != heur || entry.weight != weight)
+      continue;
+
+    std::vector<uint32_t>::const_iterator found = std::find(entry.tiles.begin(), entry.tiles.end(), startIndex);
+    if (found == entry.tiles.end())
+      continue;
+
+    entries.splice(entries.begin(), entries, it->second);
+    Emit(entry, found - entry.tiles.begin(), path);
+    ++stats.subpathHits;
+    return true;
+  }
+
+  ++stats.misses;
+  return false;
+}
+
+void AStar::PathCache::Store(const Point& start, const Point& goal, Heuristic heur, float weight, const WaypointList& path)
+{
+  IsCurrent();
+
+  Terrain& terrain = g_terrain;
+  uint32_t startIndex = start.r * width + start.c;
+  uint32_t goalIndex = goal.r * width + goal.c;
+  uint64_t key = (static_cast<uint64_t>(startIndex) << 32) | goalIndex;
+
+  std::unordered_map<uint64_t, EntryIter>::iterator route = byRoute.find(key);
+  if (route != byRoute.end())
+  {
+    //settings changed, the new result replaces the old one
+    entries.splice(entries.begin(), entries, route->second);
+  }
+  else
+  {
+    if (entries.size() >= capacity)
+      Evict();
+
+    entries.push_front(Entry());
+    entries.front().key = key;
+    byRoute[key] = entries.begin();
+    byGoal.insert(std::make_pair(goalIndex, entries.begin()));
+  }
+
+  Entry& entry = entries.front();
+  entry.heur = heur;
+  entry.weight = weight;
+  entry.tiles.clear();
+
+  //a lone start waypoint is a failed search, remembered as an empty route
+  if (path.size() < 2)
+    return;
+
+  entry.tiles.reserve(path.size());
+  for (WaypointList::const_iterator it = path.begin(); it != path.end(); ++it)
+  {
+    D3DXVECTOR3 pos = *it;
+    int r, c;
+    terrain.GetRowColumn(&pos, &r, &c);
+    entry.tiles.push_back(r * width + c);
+  }
+}
+
+void AStar::PathCache::Clear()
+{
+  entries.clear();
+  byRoute.clear();
+  byGoal.clear();
+}
+
+void AStar::PathCache::SetCapacity(size_t count)
+{
+  capacity = (std::max)(count, static_cast<size_t>(1));
+  while (entries.size() > capacity)
+    Evict();
+}
+
+size_t AStar::PathCache::GetSize() const
+{
+  return entries.size();
+}
+
+size_t AStar::PathCache::GetMemoryUsage() const
+{
+  //list nodes carry two links, hash nodes a link and the cached hash on top of the pair
+  size_t bytes = sizeof(*this);
+  for (std::list<Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+    bytes += sizeof(Entry) + 2 * sizeof(void*) + it->tiles.capacity() * sizeof(uint32_t);
+  bytes += byRoute.size() * (sizeof(std::pair<uint64_t, EntryIter>) + 2 * sizeof(void*)) + byRoute.bucket_count() * sizeof(void*);
+  bytes += byGoal.size() * (sizeof(std::pair<uint32_t, EntryIter>) + 2 * sizeof(void*)) + byGoal.bucket_count() * sizeof(void*);
+  return bytes;
+}
+
+const PathCacheStats& AStar::PathCache::GetStats() const
+{
+  return stats;
+}
+
+void AStar::PathCache::ResetStats()
+{
+  stats = PathCacheStats();
+}
+
+bool AStar::PathCache::IsCurrent()
+{
+  //any wall edit can open a shorter route or block a cached one, so everything goes
+  Map* current = g_terrain.GetMap();
+  if (current == map && current->GetWallVersion() == version)
+    return true;
+
+  if (!entries.empty())
+    ++stats.invalidations;
+  Clear();
+  map = current;
+  version = current->GetWallVersion();
+  width = current->GetWidth();
+  return false;
+}
+
+void AStar::PathCache::Emit(const Entry& entry, size_t first, WaypointList& path) const
+{
+  Terrain& terrain = g_terrain;
+
+  //unreachable goals answer like a failed search, with just the start
+  if (entry.tiles.empty())
+  {
+    uint32_t start = static_cast<uint32_t>(entry.key >> 32);
+    path.push_back(terrain.GetCoordinates(start / width, start % width));
+    return;
+  }
+
+  for (size_t i = first; i < entry.tiles.size(); ++i)
+    path.push_back(terrain.GetCoordinates(entry.tiles[i] / width, entry.tiles[i] % width));
+}
+
+void AStar::PathCache::Evict()
+{
+  EntryIter last = --entries.end();
+  uint32_t goalIndex = static_cast<uint32_t>(last->key & 0xFFFFFFFF);
+
+  std::pair<std::unordered_multimap<uint32_t, EntryIter>::iterator, std::unordered_multimap<uint32_t, EntryIter>::iterator> range = byGoal.equal_range(goalIndex);
+  for (std::unordered_multimap<uint32_t, EntryIter>::iterator it = range.first; it != range.second; ++it)
+  {
+    if (it->second == last)
+    {
+      byGoal.erase(it);
+      break;
+    }
+  }
+  byRoute.erase(last->key);
+  entries.erase(last);
+  ++stats.evictions;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "Astar.h"
+
+namespace AStar
+{
+  //routes remembered before the least recently used one is dropped
+  const size_t PATH_CACHE_SIZE = 256;
+
+  struct PathCacheStats
+  {
+    PathCacheStats();
+    unsigned lookups;
+    unsigned hits;              //same start and goal
+    unsigned subpathHits;       //start found on a cached route to the same goal, admissible searches only
+    unsigned misses;
+    unsigned invalidations;     //times the walls changed and the cache was emptied
+    unsigned evictions;
+  };
+
+  //raw search results keyed on start and goal cell, valid for one wall version of one map
+  class PathCache
+  {
+  public:
+    PathCache(size_t capacity = PATH_CACHE_SIZE);
+    bool Lookup(const Point& start, const Point& goal, Heuristic heur, float weight, WaypointList& path);
+    void Store(const Point& start, const Point& goal, Heuristic heur, float weight, const WaypointList& path);
+    void Clear();
+    void SetCapacity(size_t count);
+    size_t GetSize() const;
+    size_t GetMemoryUsage() const;
+    const PathCacheStats& GetStats() const;
+    void ResetStats();
+
+  private:
+    struct Entry
+    {
+      uint64_t key;
+      Heuristic heur;
+      float weight;
+      std::vector<uint32_t> tiles;    //start to goal, empty when the goal cannot be reached
+    };
+    typedef std::list<Entry>::iterator EntryIter;
+
+    bool IsCurrent();
+    void Emit(const Entry& entry, size_t first, WaypointList& path) const;
+    void Evict();
+
+    std::list<Entry> entries;                               //most recently used first
+    std::unordered_map<uint64_t, EntryIter> byRoute;
+    std::unordered_multimap<uint32_t, EntryIter> byGoal;
+    size_t capacity;
+
+    const Map* map;             //walls the entries were found on
+    unsigned version;
+    int width;
+    PathCacheStats stats;
+  };
+};
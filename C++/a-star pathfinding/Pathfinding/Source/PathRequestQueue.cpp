@@ -0,0 +1,159 @@
+#include "Stdafx.h"
+#include "PathRequestQueue.h"
+#include "ClusterGraph.h"
+#include <algorithm>
+
+using namespace AStar;
+
+AStar::PathRequest::PathRequest(const Point& s, const Point& g, Heuristic h, float w, Algorithm a) :
+  start(s), goal(g), heur(h), weight(w), algorithm(a)
+{
+}
+
+AStar::PathRequestQueue::PathRequestQueue() :
+  nextTicket(NO_TICKET + 1),
+  nodesExpanded(0)
+{
+  //the main thread searches too, so one core is already taken
+  unsigned cores = std::thread::hardware_concurrency();
+  SetWorkerCount(cores > 1 ? cores - 1 : 0);
+}
+
+PathTicket AStar::PathRequestQueue::Submit(const PathRequest& request)
+{
+  Job job;
+  job.ticket = nextTicket++;
+  job.request = request;
+  pending.push_back(job);
+
+  //skip the null ticket when the counter wraps
+  if (nextTicket == NO_TICKET)
+    ++nextTicket;
+  return job.ticket;
+}
+
+bool AStar::PathRequestQueue::Collect(PathTicket ticket, WaypointList& path)
+{
+  std::unordered_map<PathTicket, WaypointList>::iterator it = results.find(ticket);
+  if (it == results.end())
+    return false;
+
+  if (path.empty())
+    path.swap(it->second);
+  else
+    path.insert(path.end(), it->second.begin(), it->second.end());
+  results.erase(it);
+  return true;
+}
+
+void AStar::PathRequestQueue::Cancel(PathTicket ticket)
+{
+  if (ticket == NO_TICKET)
+    return;
+
+  //a request is either still waiting for Update or its result was never collected
+  for (std::vector<Job>::iterator it = pending.begin(); it != pending.end(); ++it)
+  {
+    if (it->ticket == ticket)
+    {
+      pending.erase(it);
+      return;
+    }
+  }
+  results.erase(ticket);
+}
+
+void AStar::PathRequestQueue::Update()
+{
+  if (pending.empty())
+    return;
+
+  Terrain& terrain = g_terrain;
+  running.swap(pending);
+
+  //data shared by the searches is built up front, during the batch it is only read
+  bool hierarchical = false;
+  for (size_t i = 0; i < running.size(); ++i)
+  {
+    if (running[i].request.algorithm == JumpPointSearchPlus)
+      terrain.GetJumpDistances();
+    else if (running[i].request.algorithm == HierarchicalSearch)
+      hierarchical = true;
+  }
+  if (hierarchical)
+    g_cluster_graph.Update(*terrain.GetMap());
+
+  //stale nodes are reset by the generation stamp, the pools only change size with the map
+  for (size_t i = 0; i < searches.size(); ++i)
+  {
+    if (searches[i]->bounds != terrain.GetWidth())
+      searches[i]->SetBounds(terrain.GetWidth());
+    searches[i]->nodesExpanded = 0;
+  }
+
+  //the cluster graph has a single set of scratch buffers, so its requests stay on this thread
+  if (hierarchical)
+  {
+    for (size_t i = 0; i < running.size(); ++i)
+    {
+      if (running[i].request.algorithm == HierarchicalSearch)
+        g_cluster_graph.PathFind(running[i].request.start, running[i].request.goal, running[i].path);
+    }
+  }
+
+  //a search is long enough for the threads to take requests one at a time
+  pool.Run(static_cast<unsigned>(running.size()), [this](unsigned worker, unsigned index) { RunJob(*searches[worker], running[index]); }, 1);
+
+  nodesExpanded = 0;
+  for (size_t i = 0; i < searches.size(); ++i)
+    nodesExpanded += searches[i]->nodesExpanded;
+
+  for (size_t i = 0; i < running.size(); ++i)
+    results[running[i].ticket].swap(running[i].path);
+  running.clear();
+}
+
+void AStar::PathRequestQueue::SetWorkerCount(unsigned count)
+{
+  //every thread gets its own node pool and open list, none of them paint the terrain
+  while (searches.size() < count + 1)
+  {
+    searches.push_back(std::unique_ptr<MovementAlgo>(new MovementAlgo()));
+    searches.back()->openlist.SetDebugColors(false);
+  }
+  searches.resize(count + 1);
+
+  pool.SetWorkerCount(count);
+}
+
+unsigned AStar::PathRequestQueue::GetWorkerCount() const
+{
+  return static_cast<unsigned>(searches.size() - 1);
+}
+
+size_t AStar::PathRequestQueue::GetPendingCount() const
+{
+  return pending.size();
+}
+
+unsigned AStar::PathRequestQueue::GetNodesExpanded() const
+{
+  return nodesExpanded;
+}
+
+void AStar::PathRequestQueue::RunJob(MovementAlgo& search, Job& job)
+{
+  if (job.request.algorithm == HierarchicalSearch)
+    return;
+
+  search.openlist.clear();
+  search.start = job.request.start;
+  search.goal = job.request.goal;
+  search.heur = job.request.heur;
+  search.h_weight = job.request.weight;
+  search.algorithm = job.request.algorithm;
+  search.isSingleStep = false;
+
+  search.openlist.push(search.start, NO_PARENT, search.GetHCost(search.start, search.goal) * search.h_weight, 0.f);
+  search.PathFind(job.path);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Astar.h"
+#include "JobPool.h"
+
+namespace AStar
+{
+  //handle for a submitted request, never zero
+  typedef unsigned PathTicket;
+  const PathTicket NO_TICKET = 0;
+
+  struct PathRequest
+  {
+    PathRequest(const Point& s = Point(), const Point& g = Point(), Heuristic h = Octile, float w = 1.f, Algorithm a = AStarSearch);
+    Point start;
+    Point goal;
+    Heuristic heur;
+    float weight;
+    Algorithm algorithm;
+  };
+
+  //collects path requests during a frame and searches them all on a worker pool at the start of the next one
+  //Submit, Collect, Cancel and Update belong to the main thread, walls must not change while Update runs
+  class PathRequestQueue
+  {
+  public:
+    PathRequestQueue();
+    PathTicket Submit(const PathRequest& request);
+    bool Collect(PathTicket ticket, WaypointList& path);
+    void Cancel(PathTicket ticket);
+    void Update();
+    void SetWorkerCount(unsigned count);
+    unsigned GetWorkerCount() const;
+    size_t GetPendingCount() const;
+    unsigned GetNodesExpanded() const;
+
+  private:
+    struct Job
+    {
+      PathTicket ticket;
+      PathRequest request;
+      WaypointList path;
+    };
+
+    void RunJob(MovementAlgo& search, Job& job);
+
+    //requests
+    PathTicket nextTicket;
+    std::vector<Job> pending;                             //submitted since the last Update
+    std::vector<Job> running;                             //the batch being searched
+    std::unordered_map<PathTicket, WaypointList> results;
+    unsigned nodesExpanded;                               //over the last batch
+
+    //one search per pool thread, searches[0] belongs to the main thread which also takes jobs
+    JobPool pool;
+    std::vector<std::unique_ptr<MovementAlgo> > searches;
+  };
+};
@@ -12,6 +12,13 @@
 #include <Stdafx.h>
 
 #include <algorithm>
+#include <map>
+#include <set>
+#include <Astar.h>
+#include <ClusterGraph.h>
+#include <PathRequestQueue.h>
+#include <SearchScheduler.h>
+#include <PathCache.h>
 
 struct Point2D
 {
@@ -58,6 +65,155 @@ static void AddOutcomeToFileStream(PathfindingOutcome &outcome, std::ofstream &o
 
 static void SavePathfindingOutcomes(const char *filename, PathFindingOutcomeArray &outcomes);
 
+static void GenerateBenchmarkMap(Map &map, Random &random, int wall_percent);
+
+// corner to corner A* paths on the bound map with at least min_waypoints points
+static unsigned FindLongPaths(Random &random, int count, unsigned min_waypoints, std::vector<WaypointList> &paths);
+
+// rubberbanding as it was before the supercover line check, kept as the benchmark baseline
+static bool IsRectangleClear(int r0, int c0, int r1, int c1);
+static void RubberbandWithRectangleCheck(WaypointList &path);
+
+// object lookup as it was before the slot map, kept as the benchmark baseline
+static GameObject *FindInList(std::list<GameObject*> &objects, objectID id);
+
+// broadcast as it was before the per-type lists, kept as the benchmark baseline
+static void BroadcastWithComposeList(MSG_Object &msg, unsigned int type);
+
+// delayed messages as they were kept before the timing wheel, kept as the benchmark baseline
+struct CompareDelayedMsg
+{
+	bool operator()(MSG_Object *lhs, MSG_Object *rhs) const;
+};
+typedef std::set<MSG_Object*, CompareDelayedMsg> DelayedMsgSet;
+static void PurgeScopedFromSet(DelayedMsgSet &messages, objectID receiver);
+
+// frames of fresh benchmark agents updated serially or in phases, returns a digest of how every agent ended up
+static unsigned RunPhasedUpdateFrames(int agents, bool phased, double &frame_time, unsigned &received);
+
+// closest wall as specified before the distance transform, every wall and side checked, kept as the benchmark baseline
+static int SquaredDistanceByScan(int width, const std::vector<int> &walls, int r, int c);
+
+// influence propagation and normalizing done tile by tile over separately allocated rows, kept as the benchmark baseline
+static void PropagateByRows(float **source, float **target, Tile **terrain, int width, float decay, float growing, bool negative);
+static void NormalizeByRows(float **rows, int width, bool negative);
+
+// wall lookups on tile rows allocated one by one, as the map layers were before the wall mask, kept as the benchmark baseline
+static int CountOpenNeighborsByRows(Tile **rows, int width, int r, int c);
+static bool IsClearPathByRows(Tile **rows, int r0, int c0, int r1, int c1);
+
+static const char *QueueTypeNames[AStar::QueueTypeCount] =
+{
+	"BinaryHeap",
+	"4-aryHeap",
+	"BucketQueue",
+};
+
+static const int ScalingBenchmarkWidths[] = { 40, 128, 256, 512, 1024, 2048, 4096 };
+static const int ScalingBenchmarkQueries = 8;
+
+static const int NodeResetBenchmarkWidth = 1024;
+static const int NodeResetBenchmarkQueries = 2000;
+
+static const char *AlgorithmNames[AStar::AlgorithmCount] =
+{
+	"A*",
+	"JPS",
+	"JPS+",
+	"HPA*",
+};
+
+static const int JumpPointBenchmarkWidth = 512;
+static const int JumpPointBenchmarkQueries = 20;
+
+static const int HierarchicalBenchmarkWidth = 1024;
+static const int HierarchicalBenchmarkQueries = 20;
+static const int HierarchicalBenchmarkEdits = 200;
+
+static const int PathRequestBenchmarkWidth = 256;
+static const int PathRequestBenchmarkAgents = 1000;
+static const int PathRequestBenchmarkFrames = 5;
+
+static const int TimeSlicingBenchmarkWidth = 512;
+static const int TimeSlicingBenchmarkBursts = 10;
+static const int TimeSlicingBenchmarkBurstSize = 20;
+static const int TimeSlicingBenchmarkBurstFrames = 5;
+static const double TimeSlicingBenchmarkBudget = 2000.0;
+static const unsigned TimeSlicingBenchmarkSlice = 256;
+
+static const int PathCacheBenchmarkWidth = 256;
+static const int PathCacheBenchmarkRoutes = 50;
+static const int PathCacheBenchmarkQueries = 2000;
+static const int PathCacheBenchmarkEditEvery = 500;
+
+static const int RubberbandBenchmarkWidth = 512;
+static const int RubberbandBenchmarkPaths = 20;
+static const unsigned RubberbandBenchmarkMinWaypoints = 200;
+
+static const int PostProcessBenchmarkWidth = 512;
+static const int PostProcessBenchmarkPaths = 20;
+static const int PostProcessBenchmarkRepeats = 10;
+
+static const int DatabaseBenchmarkObjects = 10000;
+static const int DatabaseBenchmarkMessages = 100000;
+static const int DatabaseBenchmarkListMessages = 10000;
+
+static const int BroadcastBenchmarkObjects = 10000;
+static const int BroadcastBenchmarkEnemyEvery = 10;
+static const int BroadcastBenchmarkMessages = 1000;
+
+static const int SpatialHashBenchmarkAgents[] = { 250, 1000, 4000, 16000 };
+static const int SpatialHashBenchmarkQueries = 2000;
+static const float SpatialHashBenchmarkRadius = 0.05f;
+
+static const int TimerBenchmarkTimers = 10000;
+static const int TimerBenchmarkFrames = 600;
+static const int TimerBenchmarkStateChanges = 50;
+static const float TimerBenchmarkFrameTime = 1.0f / 60.0f;
+
+static const int DebugLogBenchmarkEvents = 1000000;
+static const unsigned DebugLogBenchmarkHistory = 200;
+
+static const int PhasedUpdateBenchmarkAgents[] = { 1000, 4000, 16000 };
+static const unsigned PhasedUpdateBenchmarkWorkers[] = { 0, 1, 3, 7 };
+static const int PhasedUpdateBenchmarkFrames = 60;
+static const unsigned PhasedUpdateBenchmarkWork = 500;
+static const float PhasedUpdateBenchmarkFrameTime = 1.0f / 60.0f;
+
+static const int DispatchBenchmarkEvents = 1000000;
+static const int DispatchBenchmarkStates[] = { 0, 63 };
+static const MSG_Name DispatchBenchmarkMsgs[] = { MSG_UnitTestMessage, MSG_UnitTestPing, MSG_UnitTestAck, MSG_UnitTestBroken };
+
+static const int OpennessBenchmarkWidths[] = { 128, 256, 512 };
+static const int OpennessBenchmarkScanTiles = 1024;
+static const int OpennessBenchmarkBuilds = 10;
+static const int OpennessBenchmarkEdits = 200;
+
+static const int VisibilityBenchmarkWidths[] = { 32, 48, 64 };
+static const int VisibilityBenchmarkWalkTiles = 256;
+static const int VisibilityBenchmarkEdits = 50;
+
+static const int PropagationBenchmarkWidths[] = { 256, 512, 1024, 2048 };
+static const int PropagationBenchmarkPasses = 8;
+static const int PropagationBenchmarkSources = 32;
+static const float PropagationBenchmarkDecay = 0.1f;
+static const float PropagationBenchmarkGrowing = 0.5f;
+
+static const int LayoutBenchmarkWidths[] = { 128, 512, 2048 };
+static const int LayoutBenchmarkScans = 4;
+static const int LayoutBenchmarkLines = 100000;
+
+static const int MapLoadBenchmarkWidths[] = { 64, 256, 1024, 2048 };
+static const int MapLoadBenchmarkLoads = 3;
+
+// visibility sets only cover maps of up to VISIBILITY_MAX_TILES tiles
+static const int ReanalysisBenchmarkTypes[] = { TerrainAnalysis_OpennessClosestWall, TerrainAnalysis_Visibility };
+static const int ReanalysisBenchmarkWidths[] = { 1024, 64 };
+static const int ReanalysisBenchmarkEdits = 20;
+
+static const int FieldOfViewBenchmarkWidths[] = { 128, 256, 512 };
+static const int FieldOfViewBenchmarkViewers = 8;
+
 void PathfindingTests::PrepareTest(Agent &agent, MovementSetting &movement_data,
 	int heuristic, float weight, bool setpos)
 {
@@ -288,6 +444,347 @@ void SavePathfindingOutcomes(const char *filename, PathFindingOutcomeArray &outc
 	out.close();
 }
 
+// scatter walls over an empty map, the same seed always gives the same map
+void GenerateBenchmarkMap(Map &map, Random &random, int wall_percent)
+{
+	int width = map.GetWidth();
+
+	for (int r = 0; r < width; ++r)
+	{
+		for (int c = 0; c < width; ++c)
+		{
+			if (random.RangeInt(0, 99) < wall_percent)
+				map.PlaceWall(r, c);
+		}
+	}
+}
+
+unsigned FindLongPaths(Random &random, int count, unsigned min_waypoints, std::vector<WaypointList> &paths)
+{
+	AStar::MovementAlgo &algo = g_movement_algo;
+	int width = g_terrain.GetWidth();
+
+	algo.SetBounds(width);
+	algo.heur = AStar::Octile;
+	algo.h_weight = 1.0f;
+	algo.isSingleStep = false;
+	algo.algorithm = AStar::AStarSearch;
+
+	unsigned total_waypoints = 0;
+	int corner = width / 4;
+	while (static_cast<int>(paths.size()) < count)
+	{
+		AStar::Point start(random.RangeInt(0, corner - 1), random.RangeInt(0, corner - 1));
+		AStar::Point goal(random.RangeInt(width - corner, width - 1), random.RangeInt(width - corner, width - 1));
+		if (g_terrain.IsWall(start.r, start.c) || g_terrain.IsWall(goal.r, goal.c))
+			continue;
+
+		WaypointList path;
+		algo.openlist.clear();
+		algo.start = start;
+		algo.goal = goal;
+		algo.openlist.push(start, AStar::NO_PARENT, algo.GetHCost(start, goal), 0.f);
+		algo.PathFind(path);
+
+		if (path.size() < min_waypoints)
+			continue;
+
+		total_waypoints += static_cast<unsigned>(path.size());
+		paths.push_back(path);
+	}
+	return total_waypoints;
+}
+
+GameObject *FindInList(std::list<GameObject*> &objects, objectID id)
+{
+	for (std::list<GameObject*>::iterator i = objects.begin(); i != objects.end(); ++i)
+	{
+		if ((*i)->GetID() == id)
+			return *i;
+	}
+	return 0;
+}
+
+void BroadcastWithComposeList(MSG_Object &msg, unsigned int type)
+{
+	dbCompositionList list;
+	g_database.ComposeList(list, type);
+
+	for (dbCompositionList::iterator i = list.begin(); i != list.end(); ++i)
+	{
+		if (msg.GetSender() != (*i)->GetID() && (*i)->GetStateMachineManager())
+			(*i)->GetStateMachineManager()->SendMsg(msg);
+	}
+}
+
+bool CompareDelayedMsg::operator()(MSG_Object *lhs, MSG_Object *rhs) const
+{
+	if (Near(lhs->GetDeliveryTime(), rhs->GetDeliveryTime()))
+	{
+		if (lhs->GetSender() == rhs->GetSender())
+			return lhs->GetReceiver() < rhs->GetReceiver();
+		return lhs->GetSender() < rhs->GetSender();
+	}
+	return lhs->GetDeliveryTime() < rhs->GetDeliveryTime();
+}
+
+void PurgeScopedFromSet(DelayedMsgSet &messages, objectID receiver)
+{
+	// every delayed message is looked at
+	DelayedMsgSet::iterator i = messages.begin();
+	while (i != messages.end())
+	{
+		if ((*i)->GetReceiver() == receiver && (*i)->GetScopeRule() != SCOPE_TO_STATE_MACHINE)
+		{
+			delete *i;
+			i = messages.erase(i);
+		}
+		else
+			++i;
+	}
+}
+
+
+unsigned RunPhasedUpdateFrames(int agents, bool phased, double &frame_time, unsigned &received)
+{
+	std::vector<GameObject*> objects;
+	std::vector<objectID> peers;
+	for (int i = 0; i < agents; ++i)
+	{
+		GameObject *object = new GameObject(g_database.GetNewObjectID(), OBJECT_NPC, "Benchmark");
+		object->CreateStateMachineManager();
+		g_database.Store(*object);
+		objects.push_back(object);
+		peers.push_back(object->GetID());
+	}
+
+	std::vector<BenchmarkAgent*> machines;
+	for (int i = 0; i < agents; ++i)
+	{
+		machines.push_back(new BenchmarkAgent(*objects[i], peers, i, PhasedUpdateBenchmarkWork));
+		objects[i]->GetStateMachineManager()->PushStateMachine(*machines[i], STATE_MACHINE_QUEUE_0, true);
+	}
+
+	// simulated frames, so delayed messages come due the same way in every run
+	float start = g_clock.GetCurTime();
+	g_clock.ClearStopwatchPathfinding();
+	for (int frame = 1; frame <= PhasedUpdateBenchmarkFrames; ++frame)
+	{
+		g_clock.SetCurTime(start + frame * PhasedUpdateBenchmarkFrameTime);
+		g_clock.StartStopwatchPathfinding();
+
+		if (phased)
+			g_database.UpdatePhased(objects);
+		else
+		{
+			for (unsigned i = 0; i < objects.size(); ++i)
+				objects[i]->Update();
+		}
+		g_msgroute.DeliverDelayedMessages();
+
+		g_clock.StopStopwatchPathfinding();
+	}
+	frame_time = g_clock.GetStopwatchPathfindingTime() / PhasedUpdateBenchmarkFrames;
+	g_clock.SetCurTime(start);
+
+	unsigned digest = 2166136261u;
+	received = 0;
+	for (int i = 0; i < agents; ++i)
+	{
+		digest = (digest ^ machines[i]->GetDigest()) * 16777619u;
+		received += machines[i]->GetReceived();
+	}
+
+	for (int i = agents - 1; i >= 0; --i)
+	{
+		g_database.Remove(objects[i]->GetID());
+		delete objects[i];
+	}
+	return digest;
+}
+
+int SquaredDistanceByScan(int width, const std::vector<int> &walls, int r, int c)
+{
+	// the sides are walls just outside the map
+	int side = (std::min)((std::min)(r + 1, width - r), (std::min)(c + 1, width - c));
+	int best = side * side;
+
+	for (size_t i = 0; i < walls.size(); ++i)
+	{
+		int dr = walls[i] / width - r;
+		int dc = walls[i] % width - c;
+		if (dr * dr + dc * dc < best)
+			best = dr * dr + dc * dc;
+	}
+	return best;
+}
+
+void PropagateByRows(float **source, float **target, Tile **terrain, int width, float decay, float growing, bool negative)
+{
+	float orthogonal = expf(-decay);
+	float diagonal = expf(-decay * sqrtf(2.0f));
+
+	for (int r = 0; r < width; ++r)
+	{
+		for (int c = 0; c < width; ++c)
+		{
+			if (terrain[r][c] == TILE_WALL)
+			{
+				target[r][c] = 0.0f;
+				continue;
+			}
+
+			float best = 0.0f;
+			for (int dr = -1; dr <= 1; ++dr)
+			{
+				for (int dc = -1; dc <= 1; ++dc)
+				{
+					int rn = r + dr;
+					int cn = c + dc;
+					if ((dr == 0 && dc == 0) || rn < 0 || rn >= width || cn < 0 || cn >= width || terrain[rn][cn] == TILE_WALL)
+						continue;
+
+					float decayed = source[rn][cn] * ((dr != 0 && dc != 0) ? diagonal : orthogonal);
+					if (!negative)
+						best = (std::max)(best, decayed);
+					else if (fabsf(decayed) > fabsf(best))
+						best = decayed;
+				}
+			}
+
+			float current = negative ? source[r][c] : (std::max)(source[r][c], 0.0f);
+			target[r][c] = (1.0f - growing) * current + growing * best;
+		}
+	}
+}
+
+void NormalizeByRows(float **rows, int width, bool negative)
+{
+	float high = 0.0f;
+	float low = 0.0f;
+	for (int r = 0; r < width; ++r)
+	{
+		for (int c = 0; c < width; ++c)
+		{
+			high = (std::max)(high, rows[r][c]);
+			low = (std::min)(low, rows[r][c]);
+		}
+	}
+
+	float positive_scale = (high > 0.0f) ? 1.0f / high : 1.0f;
+	float negative_scale = (negative && low < 0.0f) ? -1.0f / low : 0.0f;
+	for (int r = 0; r < width; ++r)
+	{
+		for (int c = 0; c < width; ++c)
+			rows[r][c] *= (rows[r][c] > 0.0f) ? positive_scale : negative_scale;
+	}
+}
+
+int CountOpenNeighborsByRows(Tile **rows, int width, int r, int c)
+{
+	int count = 0;
+	for (int dr = -1; dr <= 1; ++dr)
+	{
+		for (int dc = -1; dc <= 1; ++dc)
+		{
+			int rn = r + dr;
+			int cn = c + dc;
+			if ((dr == 0 && dc == 0) || rn < 0 || rn >= width || cn < 0 || cn >= width || rows[rn][cn] == TILE_WALL)
+				continue;
+
+			// no cutting corners
+			if (dr != 0 && dc != 0 && (rows[rn][c] == TILE_WALL || rows[r][cn] == TILE_WALL))
+				continue;
+
+			++count;
+		}
+	}
+	return count;
+}
+
+bool IsClearPathByRows(Tile **rows, int r0, int c0, int r1, int c1)
+{
+	int dr = abs(r1 - r0);
+	int dc = abs(c1 - c0);
+	int stepR = (r1 > r0) ? 1 : -1;
+	int stepC = (c1 > c0) ? 1 : -1;
+
+	int r = r0;
+	int c = c0;
+	if (rows[r][c] == TILE_WALL)
+		return false;
+
+	for (int ir = 0, ic = 0; ir < dr || ic < dc; )
+	{
+		int decision = (1 + 2 * ic) * dr - (1 + 2 * ir) * dc;
+
+		if (decision == 0)
+		{
+			if (rows[r + stepR][c] == TILE_WALL || rows[r][c + stepC] == TILE_WALL)
+				return false;
+
+			r += stepR;
+			c += stepC;
+			++ir;
+			++ic;
+		}
+		else if (decision < 0)
+		{
+			c += stepC;
+			++ic;
+		}
+		else
+		{
+			r += stepR;
+			++ir;
+		}
+
+		if (rows[r][c] == TILE_WALL)
+			return false;
+	}
+
+	return true;
+}
+
+bool IsRectangleClear(int r0, int c0, int r1, int c1)
+{
+	// every cell of the bounding rectangle, O(w*h) per check
+	int r_step = (r1 >= r0) ? 1 : -1;
+	int c_step = (c1 >= c0) ? 1 : -1;
+
+	for (int r = r0; r != r1 + r_step; r += r_step)
+	{
+		for (int c = c0; c != c1 + c_step; c += c_step)
+		{
+			if (g_terrain.IsWall(r, c))
+				return false;
+		}
+	}
+	return true;
+}
+
+void RubberbandWithRectangleCheck(WaypointList &path)
+{
+	if (path.size() < 3)
+		return;
+
+	size_t front = 0;
+	size_t middle = 1;
+
+	for (size_t back = 2; back < path.size(); ++back)
+	{
+		int r0, c0, r1, c1;
+		g_terrain.GetRowColumn(&path[front], &r0, &c0);
+		g_terrain.GetRowColumn(&path[back], &r1, &c1);
+
+		if (!IsRectangleClear(r0, c0, r1, c1))
+			path[++front] = path[middle];
+		middle = back;
+	}
+	path[++front] = path[middle];
+	path.resize(front + 1);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -640,3 +1137,2191 @@ void PathfindingTests::GetSampleTestResult(const char *filename, Agent &agent, b
 	}
 
 }
+
+void PathfindingTests::RunBenchmarks(Agent &agent)
+{
+	RunOpenListBenchmark("Samples\\sample.txt", "BenchmarkOpenList.txt", agent);
+	RunGridScalingBenchmark("BenchmarkGridScaling.txt", agent);
+	RunNodeResetBenchmark("BenchmarkNodeReset.txt");
+	RunJumpPointBenchmark("Samples\\sample.txt", "BenchmarkJumpPoint.txt", agent);
+	RunHierarchicalBenchmark("BenchmarkHierarchical.txt");
+	RunPathRequestBenchmark("BenchmarkPathRequests.txt");
+	RunTimeSlicingBenchmark("BenchmarkTimeSlicing.txt");
+	RunPathCacheBenchmark("BenchmarkPathCache.txt");
+	RunRubberbandBenchmark("BenchmarkRubberband.txt");
+	RunPostProcessBenchmark("BenchmarkPostProcess.txt");
+	RunDatabaseBenchmark("BenchmarkDatabase.txt");
+	RunBroadcastBenchmark("BenchmarkBroadcast.txt");
+	RunSpatialHashBenchmark("BenchmarkSpatialHash.txt");
+	RunTimerBenchmark("BenchmarkTimers.txt");
+	RunDebugLogBenchmark("BenchmarkDebugLog.txt");
+	RunPhasedUpdateBenchmark("BenchmarkPhasedUpdate.txt");
+	RunDispatchBenchmark("BenchmarkDispatch.txt");
+	RunOpennessBenchmark("BenchmarkOpenness.txt");
+	RunVisibilityBenchmark("BenchmarkVisibility.txt");
+	RunPropagationBenchmark("BenchmarkPropagation.txt");
+	RunMapLayoutBenchmark("BenchmarkMapLayout.txt");
+	RunMapLoadBenchmark("BenchmarkMapLoad.txt");
+	RunReanalysisBenchmark("BenchmarkReanalysis.txt");
+	RunFieldOfViewBenchmark("BenchmarkFieldOfView.txt");
+}
+
+// run the sample queries once per queue type and report expansion throughput
+void PathfindingTests::RunOpenListBenchmark(const char *filename, const char *out_filename, Agent &agent)
+{
+	MovementSetting movement_setting;
+	AStar::QueueType queue_type = g_movement_algo.openlist.GetQueueType();
+
+	PrepareTest(agent, movement_setting, 1, 1.01f, false);
+
+	PathFindingOutcomeArray outcomes;
+	LoadTestData(filename, outcomes);
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Open list benchmark: " << outcomes.size() << " queries from " << filename << std::endl << std::endl;
+	out << "Queue		Map	Expanded	Time (ms)	Nodes/sec" << std::endl;
+
+	for (int type = 0; type < AStar::QueueTypeCount; ++type)
+	{
+		g_movement_algo.SetQueueType(static_cast<AStar::QueueType>(type));
+
+		// expanded nodes and time (ms) per map index
+		std::map<int, std::pair<unsigned, double> > results;
+
+		for (PathFindingOutcomeArray::iterator it = outcomes.begin(); it != outcomes.end(); ++it)
+		{
+			PathfindingOutcome outcome_data;
+
+			outcome_data.m_mapindex = it->m_mapindex;
+			g_terrain.UpdateMap(it->m_mapindex);
+			RunPathfindingTest(it->m_rStart, it->m_cStart, it->m_rGoal, it->m_cGoal, agent, outcome_data);
+
+			std::pair<unsigned, double> &result = results[it->m_mapindex];
+			result.first += g_movement_algo.nodesExpanded;
+			result.second += g_clock.GetStopwatchPathfindingTime();
+		}
+
+		unsigned total_expanded = 0;
+		double total_time = 0.0;
+
+		for (std::map<int, std::pair<unsigned, double> >::iterator it = results.begin(); it != results.end(); ++it)
+		{
+			double nodes_per_sec = (it->second.second > 0.0) ? it->second.first / (it->second.second / 1000.0) : 0.0;
+			out << QueueTypeNames[type] << "\t" << it->first << "\t" << it->second.first << "\t\t"
+				<< it->second.second << "\t\t" << nodes_per_sec << std::endl;
+
+			total_expanded += it->second.first;
+			total_time += it->second.second;
+		}
+
+		double nodes_per_sec = (total_time > 0.0) ? total_expanded / (total_time / 1000.0) : 0.0;
+		out << QueueTypeNames[type] << "\tall\t" << total_expanded << "\t\t"
+			<< total_time << "\t\t" << nodes_per_sec << std::endl << std::endl;
+	}
+
+	out.close();
+
+	g_movement_algo.SetQueueType(queue_type);
+	FinishTest(agent, movement_setting, false);
+}
+
+// corner to corner queries on generated maps of increasing size
+void PathfindingTests::RunGridScalingBenchmark(const char *out_filename, Agent &agent)
+{
+	MovementSetting movement_setting;
+
+	PrepareTest(agent, movement_setting, 1, 1.01f, false);
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Grid scaling benchmark: " << ScalingBenchmarkQueries << " queries per map, 20% walls" << std::endl << std::endl;
+	out << "Width	Cells		Found	Expanded	Time (ms)	Nodes/sec	Pool (MB)" << std::endl;
+
+	for (unsigned i = 0; i < sizeof(ScalingBenchmarkWidths) / sizeof(ScalingBenchmarkWidths[0]); ++i)
+	{
+		int width = ScalingBenchmarkWidths[i];
+		Random random(width);
+		Map map(width);
+
+		GenerateBenchmarkMap(map, random, 20);
+		g_terrain.BindMap(map);
+
+		unsigned found = 0;
+		unsigned total_expanded = 0;
+		double total_time = 0.0;
+		int corner = (std::max)(width / 10, 1);
+
+		for (int query = 0; query < ScalingBenchmarkQueries; ++query)
+		{
+			// start near the top left corner and search to the bottom right one
+			int rstart = random.RangeInt(0, corner - 1);
+			int cstart = random.RangeInt(0, corner - 1);
+			int rgoal = random.RangeInt(width - corner, width - 1);
+			int cgoal = random.RangeInt(width - corner, width - 1);
+			map.RemoveWall(rstart, cstart);
+			map.RemoveWall(rgoal, cgoal);
+
+			PathfindingOutcome outcome_data;
+			RunPathfindingTest(rstart, cstart, rgoal, cgoal, agent, outcome_data);
+
+			found += outcome_data.m_success;
+			total_expanded += g_movement_algo.nodesExpanded;
+			total_time += g_clock.GetStopwatchPathfindingTime();
+		}
+
+		double nodes_per_sec = (total_time > 0.0) ? total_expanded / (total_time / 1000.0) : 0.0;
+		double pool_mb = (static_cast<double>(width) * width * (sizeof(AStar::AStarNode) + sizeof(int))) / (1024.0 * 1024.0);
+		out << width << "\t" << width * width << "\t\t" << found << "\t" << total_expanded << "\t\t"
+			<< total_time << "\t\t" << nodes_per_sec << "\t\t" << pool_mb << std::endl;
+
+		map.Destroy();
+	}
+
+	out.close();
+
+	// back to the loaded map, the node pool is resized on the next request
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+	FinishTest(agent, movement_setting, false);
+}
+
+// the same short queries timed with the old full wipe of the node pool and with the generation stamp
+void PathfindingTests::RunNodeResetBenchmark(const char *out_filename)
+{
+	AStar::MovementAlgo &algo = g_movement_algo;
+	Random random(NodeResetBenchmarkWidth);
+	Map map(NodeResetBenchmarkWidth);
+
+	GenerateBenchmarkMap(map, random, 20);
+	g_terrain.BindMap(map);
+	algo.SetBounds(NodeResetBenchmarkWidth);
+	algo.heur = AStar::Octile;
+	algo.h_weight = 1.01f;
+	algo.isSingleStep = false;
+
+	// goals a few tiles away from the start
+	std::vector<std::pair<AStar::Point, AStar::Point> > queries;
+	while (static_cast<int>(queries.size()) < NodeResetBenchmarkQueries)
+	{
+		AStar::Point start(random.RangeInt(0, NodeResetBenchmarkWidth - 1), random.RangeInt(0, NodeResetBenchmarkWidth - 1));
+		AStar::Point goal(start.r + random.RangeInt(-4, 4), start.c + random.RangeInt(-4, 4));
+		if (!algo.InBounds(goal) || g_terrain.IsWall(start.r, start.c) || g_terrain.IsWall(goal.r, goal.c))
+			continue;
+
+		queries.push_back(std::make_pair(start, goal));
+	}
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Node reset benchmark: " << NodeResetBenchmarkQueries << " short queries on a "
+		<< NodeResetBenchmarkWidth << "x" << NodeResetBenchmarkWidth << " map" << std::endl << std::endl;
+	out << "Reset		Expanded	Time (ms)	Per query (us)" << std::endl;
+
+	double per_query[2];
+	for (int lazy = 0; lazy < 2; ++lazy)
+	{
+		unsigned total_expanded = 0;
+		double total_time = 0.0;
+
+		for (unsigned i = 0; i < queries.size(); ++i)
+		{
+			WaypointList path;
+
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+
+			if (lazy)
+				algo.openlist.clear();
+			else
+				algo.openlist.reset();
+
+			algo.start = queries[i].first;
+			algo.goal = queries[i].second;
+			algo.nodesExpanded = 0;
+			algo.openlist.push(algo.start, AStar::NO_PARENT, algo.GetHCost(algo.start, algo.goal) * algo.h_weight, 0.f);
+			algo.PathFind(path);
+
+			g_clock.StopStopwatchPathfinding();
+
+			total_expanded += algo.nodesExpanded;
+			total_time += g_clock.GetStopwatchPathfindingTime();
+		}
+
+		per_query[lazy] = total_time * 1000.0 / queries.size();
+		out << (lazy ? "Generation" : "Full wipe") << "\t" << total_expanded << "\t\t"
+			<< total_time << "\t\t" << per_query[lazy] << std::endl;
+	}
+
+	if (per_query[1] > 0.0)
+		out << std::endl << "Speedup: " << per_query[0] / per_query[1] << "x" << std::endl;
+
+	out.close();
+
+	map.Destroy();
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+}
+
+// every algorithm must reproduce the sample outcomes, the generated map shows how expansions scale
+void PathfindingTests::RunJumpPointBenchmark(const char *filename, const char *out_filename, Agent &agent)
+{
+	MovementSetting movement_setting;
+	Movement& movement = agent.m_owner->GetMovement();
+
+	// octile with weight 1 is admissible and consistent, so every algorithm returns an optimal path
+	PrepareTest(agent, movement_setting, 1, 1.0f, false);
+
+	PathFindingOutcomeArray outcomes;
+	LoadTestData(filename, outcomes);
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Jump point benchmark: " << outcomes.size() << " queries from " << filename << std::endl << std::endl;
+	out << "Algorithm	Mismatches	Expanded	Time (ms)" << std::endl;
+
+	for (int algorithm = 0; algorithm <= AStar::JumpPointSearchPlus; ++algorithm)
+	{
+		movement.SetSearchAlgorithm(algorithm);
+
+		unsigned mismatches = 0;
+		unsigned total_expanded = 0;
+		double total_time = 0.0;
+
+		for (PathFindingOutcomeArray::iterator it = outcomes.begin(); it != outcomes.end(); ++it)
+		{
+			PathfindingOutcome outcome_data;
+
+			outcome_data.m_mapindex = it->m_mapindex;
+			g_terrain.UpdateMap(it->m_mapindex);
+			RunPathfindingTest(it->m_rStart, it->m_cStart, it->m_rGoal, it->m_cGoal, agent, outcome_data);
+
+			if (outcome_data != *it)
+				++mismatches;
+
+			total_expanded += g_movement_algo.nodesExpanded;
+			total_time += g_clock.GetStopwatchPathfindingTime();
+		}
+
+		out << AlgorithmNames[algorithm] << "\t\t" << mismatches << "\t\t" << total_expanded << "\t\t" << total_time << std::endl;
+	}
+
+	// corner to corner on a bigger map, path lengths must agree with A*
+	Random random(JumpPointBenchmarkWidth);
+	Map map(JumpPointBenchmarkWidth);
+
+	GenerateBenchmarkMap(map, random, 20);
+	g_terrain.BindMap(map);
+
+	std::vector<PathfindingOutcome> queries(JumpPointBenchmarkQueries);
+	int corner = JumpPointBenchmarkWidth / 10;
+	for (unsigned i = 0; i < queries.size(); ++i)
+	{
+		queries[i].m_rStart = random.RangeInt(0, corner - 1);
+		queries[i].m_cStart = random.RangeInt(0, corner - 1);
+		queries[i].m_rGoal = random.RangeInt(JumpPointBenchmarkWidth - corner, JumpPointBenchmarkWidth - 1);
+		queries[i].m_cGoal = random.RangeInt(JumpPointBenchmarkWidth - corner, JumpPointBenchmarkWidth - 1);
+		map.RemoveWall(queries[i].m_rStart, queries[i].m_cStart);
+		map.RemoveWall(queries[i].m_rGoal, queries[i].m_cGoal);
+	}
+
+	out << std::endl << JumpPointBenchmarkQueries << " queries on a generated " << JumpPointBenchmarkWidth << "x"
+		<< JumpPointBenchmarkWidth << " map" << std::endl << std::endl;
+	out << "Algorithm	Mismatches	Expanded	Time (ms)" << std::endl;
+
+	std::vector<int> astar_dist(queries.size());
+	for (int algorithm = 0; algorithm <= AStar::JumpPointSearchPlus; ++algorithm)
+	{
+		movement.SetSearchAlgorithm(algorithm);
+
+		unsigned mismatches = 0;
+		unsigned total_expanded = 0;
+		double total_time = 0.0;
+
+		for (unsigned i = 0; i < queries.size(); ++i)
+		{
+			PathfindingOutcome outcome_data;
+			RunPathfindingTest(queries[i].m_rStart, queries[i].m_cStart, queries[i].m_rGoal, queries[i].m_cGoal, agent, outcome_data);
+
+			if (algorithm == AStar::AStarSearch)
+				astar_dist[i] = outcome_data.m_dist;
+			else if (outcome_data.m_dist != astar_dist[i])
+				++mismatches;
+
+			total_expanded += g_movement_algo.nodesExpanded;
+			total_time += g_clock.GetStopwatchPathfindingTime();
+		}
+
+		out << AlgorithmNames[algorithm] << "\t\t" << mismatches << "\t\t" << total_expanded << "\t\t" << total_time << std::endl;
+	}
+
+	out.close();
+
+	map.Destroy();
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+	FinishTest(agent, movement_setting, false);
+}
+
+// flat A* against the cluster graph on corner to corner routes, then the cost of keeping the graph current
+void PathfindingTests::RunHierarchicalBenchmark(const char *out_filename)
+{
+	AStar::MovementAlgo &algo = g_movement_algo;
+	AStar::ClusterGraph &graph = g_cluster_graph;
+	Random random(HierarchicalBenchmarkWidth);
+	Map map(HierarchicalBenchmarkWidth);
+
+	GenerateBenchmarkMap(map, random, 20);
+	g_terrain.BindMap(map);
+	algo.SetBounds(HierarchicalBenchmarkWidth);
+	algo.heur = AStar::Octile;
+	algo.h_weight = 1.0f;
+	algo.isSingleStep = false;
+	algo.algorithm = AStar::AStarSearch;
+
+	std::vector<std::pair<AStar::Point, AStar::Point> > queries(HierarchicalBenchmarkQueries);
+	int corner = HierarchicalBenchmarkWidth / 10;
+	for (unsigned i = 0; i < queries.size(); ++i)
+	{
+		queries[i].first = AStar::Point(random.RangeInt(0, corner - 1), random.RangeInt(0, corner - 1));
+		queries[i].second = AStar::Point(random.RangeInt(HierarchicalBenchmarkWidth - corner, HierarchicalBenchmarkWidth - 1),
+			random.RangeInt(HierarchicalBenchmarkWidth - corner, HierarchicalBenchmarkWidth - 1));
+		map.RemoveWall(queries[i].first.r, queries[i].first.c);
+		map.RemoveWall(queries[i].second.r, queries[i].second.c);
+	}
+
+	g_clock.UpdateQPCFrequency();
+
+	g_clock.ClearStopwatchPathfinding();
+	g_clock.StartStopwatchPathfinding();
+	graph.Build(map);
+	g_clock.StopStopwatchPathfinding();
+	double build_time = g_clock.GetStopwatchPathfindingTime();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Hierarchical benchmark: " << HierarchicalBenchmarkQueries << " long queries on a "
+		<< HierarchicalBenchmarkWidth << "x" << HierarchicalBenchmarkWidth << " map, "
+		<< AStar::CLUSTER_SIZE << "x" << AStar::CLUSTER_SIZE << " clusters" << std::endl << std::endl;
+	out << "Search		Found		Length		Time (ms)	Per query (ms)" << std::endl;
+
+	double per_query[2];
+	double length[2];
+	for (int hierarchical = 0; hierarchical < 2; ++hierarchical)
+	{
+		unsigned found = 0;
+		double total_length = 0.0;
+		double total_time = 0.0;
+
+		for (unsigned i = 0; i < queries.size(); ++i)
+		{
+			WaypointList path;
+
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+
+			if (hierarchical)
+			{
+				graph.PathFind(queries[i].first, queries[i].second, path);
+			}
+			else
+			{
+				algo.openlist.clear();
+				algo.start = queries[i].first;
+				algo.goal = queries[i].second;
+				algo.nodesExpanded = 0;
+				algo.openlist.push(algo.start, AStar::NO_PARENT, algo.GetHCost(algo.start, algo.goal), 0.f);
+				algo.PathFind(path);
+			}
+
+			g_clock.StopStopwatchPathfinding();
+			total_time += g_clock.GetStopwatchPathfindingTime();
+
+			// a lone start waypoint means no path
+			if (path.size() < 2)
+				continue;
+
+			++found;
+			WaypointList::iterator prev = path.begin();
+			for (WaypointList::iterator it = path.begin() + 1; it != path.end(); prev = it++)
+			{
+				D3DXVECTOR3 step = *it - *prev;
+				total_length += D3DXVec3Length(&step);
+			}
+		}
+
+		length[hierarchical] = total_length;
+		per_query[hierarchical] = total_time / queries.size();
+		out << (hierarchical ? "HPA*" : "A*") << "\t\t" << found << "\t\t" << total_length << "\t\t"
+			<< total_time << "\t\t" << per_query[hierarchical] << std::endl;
+	}
+
+	if (per_query[1] > 0.0)
+		out << std::endl << "Speedup: " << per_query[0] / per_query[1] << "x" << std::endl;
+	if (length[0] > 0.0)
+		out << "Path length ratio: " << length[1] / length[0] << std::endl;
+
+	// the flat search keeps a node and a heap slot for every tile
+	size_t flat_memory = static_cast<size_t>(HierarchicalBenchmarkWidth) * HierarchicalBenchmarkWidth
+		* (sizeof(AStar::AStarNode) + sizeof(int));
+	out << std::endl << "Memory		Bytes" << std::endl;
+	out << "A* nodes	" << flat_memory << std::endl;
+	out << "Cluster graph	" << graph.GetMemoryUsage() << " (" << graph.GetNodeCount() << " nodes)" << std::endl;
+
+	// single wall edits only rebuild the clusters around them
+	double update_time = 0.0;
+	for (int i = 0; i < HierarchicalBenchmarkEdits; ++i)
+	{
+		int r = random.RangeInt(0, HierarchicalBenchmarkWidth - 1);
+		int c = random.RangeInt(0, HierarchicalBenchmarkWidth - 1);
+		if (g_terrain.IsWall(r, c))
+			map.RemoveWall(r, c);
+		else
+			map.PlaceWall(r, c);
+
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		graph.Update(map);
+		g_clock.StopStopwatchPathfinding();
+		update_time += g_clock.GetStopwatchPathfindingTime();
+	}
+
+	out << std::endl << "Upkeep		Time (ms)" << std::endl;
+	out << "Full build	" << build_time << std::endl;
+	out << "Wall edit	" << update_time / HierarchicalBenchmarkEdits << std::endl;
+
+	out.close();
+
+	// the next request sees a different map and rebuilds the graph
+	map.Destroy();
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+}
+
+// every agent asks for a path in the same frame, the queue searches them with 0 up to one worker per spare core
+void PathfindingTests::RunPathRequestBenchmark(const char *out_filename)
+{
+	AStar::PathRequestQueue &queue = g_path_requests;
+	unsigned default_workers = queue.GetWorkerCount();
+	unsigned cores = std::thread::hardware_concurrency();
+	unsigned max_workers = cores > 1 ? cores - 1 : 0;
+
+	Random random(PathRequestBenchmarkWidth);
+	Map map(PathRequestBenchmarkWidth);
+
+	GenerateBenchmarkMap(map, random, 20);
+	g_terrain.BindMap(map);
+
+	std::vector<AStar::PathRequest> requests;
+	while (static_cast<int>(requests.size()) < PathRequestBenchmarkAgents)
+	{
+		AStar::Point start(random.RangeInt(0, PathRequestBenchmarkWidth - 1), random.RangeInt(0, PathRequestBenchmarkWidth - 1));
+		AStar::Point goal(random.RangeInt(0, PathRequestBenchmarkWidth - 1), random.RangeInt(0, PathRequestBenchmarkWidth - 1));
+		if (g_terrain.IsWall(start.r, start.c) || g_terrain.IsWall(goal.r, goal.c))
+			continue;
+
+		requests.push_back(AStar::PathRequest(start, goal, AStar::Octile, 1.0f, AStar::AStarSearch));
+	}
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Path request benchmark: " << PathRequestBenchmarkAgents << " agents on a "
+		<< PathRequestBenchmarkWidth << "x" << PathRequestBenchmarkWidth << " map, " << cores << " cores" << std::endl << std::endl;
+	out << "Workers		Mismatches	Frame (ms)	Paths/s		Speedup" << std::endl;
+
+	// the main thread always searches, so 0 workers is the serial baseline
+	std::vector<size_t> serial_sizes(requests.size());
+	double serial_frame = 0.0;
+	for (unsigned workers = 0; workers <= max_workers; ++workers)
+	{
+		queue.SetWorkerCount(workers);
+
+		unsigned mismatches = 0;
+		double total_time = 0.0;
+		for (int frame = 0; frame < PathRequestBenchmarkFrames; ++frame)
+		{
+			std::vector<AStar::PathTicket> tickets(requests.size());
+			for (unsigned i = 0; i < requests.size(); ++i)
+				tickets[i] = queue.Submit(requests[i]);
+
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+			queue.Update();
+			g_clock.StopStopwatchPathfinding();
+			total_time += g_clock.GetStopwatchPathfindingTime();
+
+			// every worker count must hand back the same paths
+			for (unsigned i = 0; i < tickets.size(); ++i)
+			{
+				WaypointList path;
+				queue.Collect(tickets[i], path);
+
+				if (workers == 0 && frame == 0)
+					serial_sizes[i] = path.size();
+				else if (path.size() != serial_sizes[i])
+					++mismatches;
+			}
+		}
+
+		double frame_time = total_time / PathRequestBenchmarkFrames;
+		if (workers == 0)
+			serial_frame = frame_time;
+
+		out << workers << "\t\t" << mismatches << "\t\t" << frame_time << "\t\t"
+			<< (frame_time > 0.0 ? PathRequestBenchmarkAgents * 1000.0 / frame_time : 0.0) << "\t\t"
+			<< (frame_time > 0.0 ? serial_frame / frame_time : 0.0) << std::endl;
+	}
+
+	out.close();
+
+	queue.SetWorkerCount(default_workers);
+	map.Destroy();
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+}
+
+// the same bursts of requests with no budget and with a 2ms budget, spikes are frames over twice the budget
+void PathfindingTests::RunTimeSlicingBenchmark(const char *out_filename)
+{
+	AStar::SearchScheduler &scheduler = g_search_scheduler;
+	Random random(TimeSlicingBenchmarkWidth);
+	Map map(TimeSlicingBenchmarkWidth);
+
+	GenerateBenchmarkMap(map, random, 20);
+	g_terrain.BindMap(map);
+
+	// routes across most of the map so a single search is worth slicing
+	std::vector<AStar::PathRequest> requests;
+	int corner = TimeSlicingBenchmarkWidth / 4;
+	while (static_cast<int>(requests.size()) < TimeSlicingBenchmarkBursts * TimeSlicingBenchmarkBurstSize)
+	{
+		AStar::Point start(random.RangeInt(0, corner - 1), random.RangeInt(0, corner - 1));
+		AStar::Point goal(random.RangeInt(TimeSlicingBenchmarkWidth - corner, TimeSlicingBenchmarkWidth - 1),
+			random.RangeInt(TimeSlicingBenchmarkWidth - corner, TimeSlicingBenchmarkWidth - 1));
+		if (g_terrain.IsWall(start.r, start.c) || g_terrain.IsWall(goal.r, goal.c))
+			continue;
+
+		requests.push_back(AStar::PathRequest(start, goal, AStar::Octile, 1.0f, AStar::AStarSearch));
+	}
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Time slicing benchmark: " << TimeSlicingBenchmarkBursts << " bursts of " << TimeSlicingBenchmarkBurstSize
+		<< " requests on a " << TimeSlicingBenchmarkWidth << "x" << TimeSlicingBenchmarkWidth << " map, budget "
+		<< TimeSlicingBenchmarkBudget << "us, " << TimeSlicingBenchmarkSlice << " expansions per slice" << std::endl << std::endl;
+	out << "Mode		Mismatches	Frames		Spikes		Max frame (ms)	Mean frame (ms)	Mean latency	Max latency" << std::endl;
+
+	std::vector<size_t> unsliced_sizes(requests.size());
+	for (int sliced = 0; sliced < 2; ++sliced)
+	{
+		scheduler.SetFrameBudget(sliced ? TimeSlicingBenchmarkBudget : 0.0, TimeSlicingBenchmarkSlice);
+		scheduler.ResetStats();
+
+		std::vector<AStar::PathTicket> tickets(requests.size(), AStar::NO_TICKET);
+		unsigned submitted = 0;
+		unsigned collected = 0;
+		unsigned mismatches = 0;
+		unsigned spikes = 0;
+		double max_frame = 0.0;
+		double total_time = 0.0;
+		unsigned frames = 0;
+
+		while (collected < requests.size())
+		{
+			// a burst lands every few frames, like a squad being ordered around
+			if (frames % TimeSlicingBenchmarkBurstFrames == 0 && submitted < requests.size())
+			{
+				for (int i = 0; i < TimeSlicingBenchmarkBurstSize; ++i, ++submitted)
+					tickets[submitted] = scheduler.Submit(requests[submitted]);
+			}
+
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+			scheduler.Update();
+			g_clock.StopStopwatchPathfinding();
+
+			double frame_time = g_clock.GetStopwatchPathfindingTime();
+			total_time += frame_time;
+			max_frame = (std::max)(max_frame, frame_time);
+			if (frame_time * 1000.0 > TimeSlicingBenchmarkBudget * 2.0)
+				++spikes;
+			++frames;
+
+			for (unsigned i = 0; i < submitted; ++i)
+			{
+				WaypointList path;
+				if (tickets[i] == AStar::NO_TICKET || !scheduler.Collect(tickets[i], path))
+					continue;
+
+				tickets[i] = AStar::NO_TICKET;
+				++collected;
+				if (!sliced)
+					unsliced_sizes[i] = path.size();
+				else if (path.size() != unsliced_sizes[i])
+					++mismatches;
+			}
+		}
+
+		const AStar::SchedulerStats &stats = scheduler.GetStats();
+		out << (sliced ? "Sliced" : "Unsliced") << "\t" << mismatches << "\t\t" << frames << "\t\t" << spikes << "\t\t"
+			<< max_frame << "\t\t" << total_time / frames << "\t\t"
+			<< static_cast<double>(stats.totalLatency) / (std::max)(stats.completed, 1u) << "\t\t" << stats.maxLatency << std::endl;
+	}
+
+	out.close();
+
+	scheduler.SetFrameBudget(TimeSlicingBenchmarkBudget, TimeSlicingBenchmarkSlice);
+	scheduler.ResetStats();
+	map.Destroy();
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+}
+
+// agents walk a fixed set of routes, sometimes asking from partway along one, with a wall edit every few hundred requests
+void PathfindingTests::RunPathCacheBenchmark(const char *out_filename)
+{
+	AStar::MovementAlgo &algo = g_movement_algo;
+	AStar::PathCache &cache = g_path_cache;
+	Random random(PathCacheBenchmarkWidth);
+	Map map(PathCacheBenchmarkWidth);
+
+	GenerateBenchmarkMap(map, random, 20);
+	g_terrain.BindMap(map);
+	algo.SetBounds(PathCacheBenchmarkWidth);
+	algo.heur = AStar::Octile;
+	algo.h_weight = 1.0f;
+	algo.isSingleStep = false;
+	algo.algorithm = AStar::AStarSearch;
+
+	std::vector<std::pair<AStar::Point, AStar::Point> > routes;
+	while (static_cast<int>(routes.size()) < PathCacheBenchmarkRoutes)
+	{
+		AStar::Point start(random.RangeInt(0, PathCacheBenchmarkWidth - 1), random.RangeInt(0, PathCacheBenchmarkWidth - 1));
+		AStar::Point goal(random.RangeInt(0, PathCacheBenchmarkWidth - 1), random.RangeInt(0, PathCacheBenchmarkWidth - 1));
+		if (g_terrain.IsWall(start.r, start.c) || g_terrain.IsWall(goal.r, goal.c))
+			continue;
+
+		routes.push_back(std::make_pair(start, goal));
+	}
+
+	// the same request stream for both runs: route, and how far along it the agent already is
+	std::vector<std::pair<int, int> > stream(PathCacheBenchmarkQueries);
+	for (unsigned i = 0; i < stream.size(); ++i)
+		stream[i] = std::make_pair(random.RangeInt(0, PathCacheBenchmarkRoutes - 1), random.RangeInt(0, 3) == 0 ? random.RangeInt(1, 50) : 0);
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Path cache benchmark: " << PathCacheBenchmarkQueries << " requests over " << PathCacheBenchmarkRoutes
+		<< " routes on a " << PathCacheBenchmarkWidth << "x" << PathCacheBenchmarkWidth << " map, a wall edit every "
+		<< PathCacheBenchmarkEditEvery << " requests" << std::endl << std::endl;
+	out << "Cache		Mismatches	Time (ms)	Per query (us)" << std::endl;
+
+	// partway starts are read off the last full route found without the cache
+	std::vector<WaypointList> full_routes(routes.size());
+	std::vector<AStar::Point> starts(stream.size());
+	std::vector<size_t> uncached_sizes(stream.size());
+	double per_query[2];
+	for (int use_cache = 0; use_cache < 2; ++use_cache)
+	{
+		unsigned mismatches = 0;
+		double total_time = 0.0;
+
+		cache.Clear();
+		cache.ResetStats();
+
+		for (unsigned i = 0; i < stream.size(); ++i)
+		{
+			// toggle the same tiles in both runs
+			if (i > 0 && i % PathCacheBenchmarkEditEvery == 0)
+			{
+				int r = (i * 7919) % PathCacheBenchmarkWidth;
+				int c = (i * 104729) % PathCacheBenchmarkWidth;
+				if (g_terrain.IsWall(r, c))
+					map.RemoveWall(r, c);
+				else
+					map.PlaceWall(r, c);
+			}
+
+			AStar::Point goal = routes[stream[i].first].second;
+			if (!use_cache)
+			{
+				starts[i] = routes[stream[i].first].first;
+				if (stream[i].second && !full_routes[stream[i].first].empty())
+				{
+					WaypointList &route = full_routes[stream[i].first];
+					WaypointList::iterator it = route.begin();
+					std::advance(it, (std::min)(static_cast<size_t>(stream[i].second), route.size() - 1));
+					g_terrain.GetRowColumn(&(*it), &starts[i].r, &starts[i].c);
+				}
+			}
+			AStar::Point start = starts[i];
+
+			WaypointList path;
+
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+
+			if (!use_cache || !cache.Lookup(start, goal, algo.heur, algo.h_weight, path))
+			{
+				algo.openlist.clear();
+				algo.start = start;
+				algo.goal = goal;
+				algo.openlist.push(start, AStar::NO_PARENT, algo.GetHCost(start, goal), 0.f);
+				algo.PathFind(path);
+
+				if (use_cache)
+					cache.Store(start, goal, algo.heur, algo.h_weight, path);
+			}
+
+			g_clock.StopStopwatchPathfinding();
+			total_time += g_clock.GetStopwatchPathfindingTime();
+
+			if (!use_cache)
+			{
+				uncached_sizes[i] = path.size();
+				if (!stream[i].second)
+					full_routes[stream[i].first] = path;
+			}
+			else if (path.size() != uncached_sizes[i])
+			{
+				++mismatches;
+			}
+		}
+
+		// put the toggled tiles back so the second run sees the same walls
+		for (unsigned i = PathCacheBenchmarkEditEvery; i < stream.size(); i += PathCacheBenchmarkEditEvery)
+		{
+			int r = (i * 7919) % PathCacheBenchmarkWidth;
+			int c = (i * 104729) % PathCacheBenchmarkWidth;
+			if (g_terrain.IsWall(r, c))
+				map.RemoveWall(r, c);
+			else
+				map.PlaceWall(r, c);
+		}
+
+		per_query[use_cache] = total_time * 1000.0 / stream.size();
+		out << (use_cache ? "On" : "Off") << "\t\t" << mismatches << "\t\t" << total_time << "\t\t" << per_query[use_cache] << std::endl;
+	}
+
+	const AStar::PathCacheStats &stats = cache.GetStats();
+	out << std::endl << "Hits: " << stats.hits << ", subpath hits: " << stats.subpathHits << ", misses: " << stats.misses
+		<< ", hit rate: " << 100.0 * (stats.hits + stats.subpathHits) / (std::max)(stats.lookups, 1u) << "%" << std::endl;
+	out << "Invalidations: " << stats.invalidations << ", evictions: " << stats.evictions << std::endl;
+	out << "Memory: " << cache.GetMemoryUsage() << " bytes for " << cache.GetSize() << " routes" << std::endl;
+	if (per_query[1] > 0.0)
+		out << "Speedup: " << per_query[0] / per_query[1] << "x" << std::endl;
+
+	out.close();
+
+	cache.Clear();
+	cache.ResetStats();
+	map.Destroy();
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+}
+
+// long A* paths on an open map rubberbanded both ways, the rectangle check also keeps more waypoints
+void PathfindingTests::RunRubberbandBenchmark(const char *out_filename)
+{
+	AStar::MovementAlgo &algo = g_movement_algo;
+	Random random(RubberbandBenchmarkWidth);
+	Map map(RubberbandBenchmarkWidth);
+
+	GenerateBenchmarkMap(map, random, 10);
+	g_terrain.BindMap(map);
+
+	// only paths long enough to be worth rubberbanding
+	std::vector<WaypointList> paths;
+	unsigned total_waypoints = FindLongPaths(random, RubberbandBenchmarkPaths, RubberbandBenchmarkMinWaypoints, paths);
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Rubberband benchmark: " << RubberbandBenchmarkPaths << " paths, "
+		<< total_waypoints / RubberbandBenchmarkPaths << " waypoints on average, on a "
+		<< RubberbandBenchmarkWidth << "x" << RubberbandBenchmarkWidth << " map" << std::endl << std::endl;
+	out << "Line check	Waypoints left	Time (ms)	Per path (ms)" << std::endl;
+
+	double per_path[2];
+	for (int supercover = 0; supercover < 2; ++supercover)
+	{
+		unsigned waypoints_left = 0;
+		double total_time = 0.0;
+
+		for (unsigned i = 0; i < paths.size(); ++i)
+		{
+			WaypointList path = paths[i];
+
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+
+			if (supercover)
+				algo.RubberbandPath(path);
+			else
+				RubberbandWithRectangleCheck(path);
+
+			g_clock.StopStopwatchPathfinding();
+			total_time += g_clock.GetStopwatchPathfindingTime();
+			waypoints_left += static_cast<unsigned>(path.size());
+		}
+
+		per_path[supercover] = total_time / paths.size();
+		out << (supercover ? "Supercover" : "Rectangle") << "\t" << waypoints_left << "\t\t"
+			<< total_time << "\t\t" << per_path[supercover] << std::endl;
+	}
+
+	if (per_path[1] > 0.0)
+		out << std::endl << "Speedup: " << per_path[0] / per_path[1] << "x" << std::endl;
+
+	out.close();
+
+	map.Destroy();
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+}
+
+// every repeat starts from a fresh copy of each path, into the same list so its storage is reused as in Movement
+void PathfindingTests::RunPostProcessBenchmark(const char *out_filename)
+{
+	AStar::MovementAlgo &algo = g_movement_algo;
+	Random random(PostProcessBenchmarkWidth);
+	Map map(PostProcessBenchmarkWidth);
+
+	GenerateBenchmarkMap(map, random, 10);
+	g_terrain.BindMap(map);
+
+	std::vector<WaypointList> paths;
+	unsigned total_waypoints = FindLongPaths(random, PostProcessBenchmarkPaths, RubberbandBenchmarkMinWaypoints, paths);
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Path post-processing benchmark: " << PostProcessBenchmarkPaths << " paths, "
+		<< total_waypoints / PostProcessBenchmarkPaths << " waypoints on average, on a "
+		<< PostProcessBenchmarkWidth << "x" << PostProcessBenchmarkWidth << " map" << std::endl << std::endl;
+	out << "Stage		Waypoints out	Time per path (ms)	Allocations per path" << std::endl;
+
+	static const char *stage_names[] = { "Rubberband", "Add points", "Smooth" };
+	static const int stage_count = sizeof(stage_names) / sizeof(stage_names[0]);
+
+	double time[stage_count] = {};
+	unsigned allocations[stage_count] = {};
+	unsigned waypoints_out[stage_count] = {};
+
+	WaypointList path;
+	for (int repeat = 0; repeat < PostProcessBenchmarkRepeats; ++repeat)
+	{
+		for (unsigned i = 0; i < paths.size(); ++i)
+		{
+			path = paths[i];
+
+			for (int stage = 0; stage < stage_count; ++stage)
+			{
+				WaypointList::ResetAllocationCount();
+				g_clock.ClearStopwatchPathfinding();
+				g_clock.StartStopwatchPathfinding();
+
+				if (stage == 0)
+					algo.RubberbandPath(path);
+				else if (stage == 1)
+					algo.AddPointsForSmoothing(path);
+				else
+					algo.SmoothPath(path);
+
+				g_clock.StopStopwatchPathfinding();
+				time[stage] += g_clock.GetStopwatchPathfindingTime();
+				allocations[stage] += WaypointList::GetAllocationCount();
+				if (repeat == 0)
+					waypoints_out[stage] += static_cast<unsigned>(path.size());
+			}
+		}
+	}
+
+	int runs = PostProcessBenchmarkPaths * PostProcessBenchmarkRepeats;
+	for (int stage = 0; stage < stage_count; ++stage)
+	{
+		out << stage_names[stage] << "\t" << waypoints_out[stage] / PostProcessBenchmarkPaths << "\t\t"
+			<< time[stage] / runs << "\t\t\t" << static_cast<double>(allocations[stage]) / runs << std::endl;
+	}
+
+	out.close();
+
+	map.Destroy();
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+}
+
+// the objects only get an empty state machine manager, so routing cost is mostly the receiver lookup
+void PathfindingTests::RunDatabaseBenchmark(const char *out_filename)
+{
+	Random random(DatabaseBenchmarkObjects);
+
+	std::vector<GameObject*> objects;
+	std::list<GameObject*> object_list;
+	for (int i = 0; i < DatabaseBenchmarkObjects; ++i)
+	{
+		char name[GAME_OBJECT_MAX_NAME_SIZE];
+		sprintf_s(name, "Benchmark%d", i);
+
+		GameObject *object = new GameObject(g_database.GetNewObjectID(), OBJECT_Ignore_Type, name);
+		object->CreateStateMachineManager();
+		g_database.Store(*object);
+		objects.push_back(object);
+		object_list.push_back(object);
+	}
+
+	std::vector<objectID> receivers(DatabaseBenchmarkMessages);
+	std::vector<std::string> names(DatabaseBenchmarkMessages);
+	for (int i = 0; i < DatabaseBenchmarkMessages; ++i)
+	{
+		GameObject *object = objects[random.RangeInt(0, DatabaseBenchmarkObjects - 1)];
+		receivers[i] = object->GetID();
+		names[i] = object->GetName();
+	}
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Database benchmark: " << DatabaseBenchmarkMessages << " messages to random receivers among "
+		<< DatabaseBenchmarkObjects << " objects" << std::endl << std::endl;
+	out << "Lookup			Messages	Time (ms)	Per message (us)" << std::endl;
+
+	// routed through the message system, which finds each receiver in the database
+	MSG_Data data;
+	g_clock.ClearStopwatchPathfinding();
+	g_clock.StartStopwatchPathfinding();
+	for (int i = 0; i < DatabaseBenchmarkMessages; ++i)
+		g_msgroute.SendMsg(0.0f, MSG_NULL, receivers[i], SYSTEM_OBJECT_ID, SCOPE_TO_STATE_MACHINE, 0, STATE_MACHINE_QUEUE_0, data, false, false);
+	g_clock.StopStopwatchPathfinding();
+	double time = g_clock.GetStopwatchPathfindingTime();
+	out << "Routed, slot map	" << DatabaseBenchmarkMessages << "\t\t" << time << "\t\t" << time * 1000.0 / DatabaseBenchmarkMessages << std::endl;
+
+	// the old linear scan is slow enough that a slice of the messages is plenty
+	unsigned found = 0;
+	g_clock.ClearStopwatchPathfinding();
+	g_clock.StartStopwatchPathfinding();
+	for (int i = 0; i < DatabaseBenchmarkListMessages; ++i)
+		found += FindInList(object_list, receivers[i]) != 0;
+	g_clock.StopStopwatchPathfinding();
+	time = g_clock.GetStopwatchPathfindingTime();
+	out << "Find, list scan		" << DatabaseBenchmarkListMessages << "\t\t" << time << "\t\t" << time * 1000.0 / DatabaseBenchmarkListMessages << std::endl;
+
+	g_clock.ClearStopwatchPathfinding();
+	g_clock.StartStopwatchPathfinding();
+	for (int i = 0; i < DatabaseBenchmarkMessages; ++i)
+		found += g_database.Find(receivers[i]) != 0;
+	g_clock.StopStopwatchPathfinding();
+	time = g_clock.GetStopwatchPathfindingTime();
+	out << "Find, slot map		" << DatabaseBenchmarkMessages << "\t\t" << time << "\t\t" << time * 1000.0 / DatabaseBenchmarkMessages << std::endl;
+
+	g_clock.ClearStopwatchPathfinding();
+	g_clock.StartStopwatchPathfinding();
+	for (int i = 0; i < DatabaseBenchmarkMessages; ++i)
+		found += g_database.GetIDByName(&names[i][0]) != INVALID_OBJECT_ID;
+	g_clock.StopStopwatchPathfinding();
+	time = g_clock.GetStopwatchPathfindingTime();
+	out << "GetIDByName, index	" << DatabaseBenchmarkMessages << "\t\t" << time << "\t\t" << time * 1000.0 / DatabaseBenchmarkMessages << std::endl;
+
+	// removed last to first so each removal is at the end of the database
+	for (int i = DatabaseBenchmarkObjects - 1; i >= 0; --i)
+	{
+		g_database.Remove(objects[i]->GetID());
+		delete objects[i];
+	}
+
+	// a new object in a reused slot must not answer to the old IDs
+	GameObject *reused = new GameObject(g_database.GetNewObjectID(), OBJECT_Ignore_Type, "Benchmark");
+	g_database.Store(*reused);
+	unsigned stale = 0;
+	for (int i = 0; i < DatabaseBenchmarkMessages; ++i)
+		stale += g_database.Find(receivers[i]) != 0;
+	g_database.Remove(reused->GetID());
+	delete reused;
+
+	out << std::endl << "Found " << found << " of " << 2 * DatabaseBenchmarkMessages + DatabaseBenchmarkListMessages
+		<< ", stale IDs found after removal: " << stale << std::endl;
+
+	out.close();
+}
+
+// one object in BroadcastBenchmarkEnemyEvery is an enemy, every broadcast goes to the enemies
+void PathfindingTests::RunBroadcastBenchmark(const char *out_filename)
+{
+	std::vector<GameObject*> objects;
+	for (int i = 0; i < BroadcastBenchmarkObjects; ++i)
+	{
+		unsigned int type = (i % BroadcastBenchmarkEnemyEvery == 0) ? OBJECT_Enemy : OBJECT_NPC;
+		GameObject *object = new GameObject(g_database.GetNewObjectID(), type, "Benchmark");
+		object->CreateStateMachineManager();
+		g_database.Store(*object);
+		objects.push_back(object);
+	}
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Broadcast benchmark: " << BroadcastBenchmarkMessages << " broadcasts to "
+		<< g_database.GetObjectsOfType(OBJECT_Enemy).size() << " enemies among "
+		<< BroadcastBenchmarkObjects << " objects" << std::endl << std::endl;
+	out << "Receivers from		Time (ms)	Per broadcast (us)" << std::endl;
+
+	MSG_Data data;
+	MSG_Object msg(0.0f, MSG_NULL, SYSTEM_OBJECT_ID, INVALID_OBJECT_ID, SCOPE_TO_STATE_MACHINE, 0, STATE_MACHINE_QUEUE_ALL, data, false, false);
+
+	double per_broadcast[2];
+	for (int view = 0; view < 2; ++view)
+	{
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+
+		for (int i = 0; i < BroadcastBenchmarkMessages; ++i)
+		{
+			if (view)
+				g_msgroute.SendMsgBroadcast(msg, OBJECT_Enemy);
+			else
+				BroadcastWithComposeList(msg, OBJECT_Enemy);
+		}
+
+		g_clock.StopStopwatchPathfinding();
+		double time = g_clock.GetStopwatchPathfindingTime();
+		per_broadcast[view] = time * 1000.0 / BroadcastBenchmarkMessages;
+		out << (view ? "Per-type list" : "ComposeList") << "\t\t" << time << "\t\t" << per_broadcast[view] << std::endl;
+	}
+
+	if (per_broadcast[1] > 0.0)
+		out << std::endl << "Speedup: " << per_broadcast[0] / per_broadcast[1] << "x" << std::endl;
+
+	out.close();
+
+	for (int i = BroadcastBenchmarkObjects - 1; i >= 0; --i)
+	{
+		g_database.Remove(objects[i]->GetID());
+		delete objects[i];
+	}
+}
+
+// agents scattered over the whole map, the same radius and nearest queries at each density
+void PathfindingTests::RunSpatialHashBenchmark(const char *out_filename)
+{
+	const int densities = sizeof(SpatialHashBenchmarkAgents) / sizeof(SpatialHashBenchmarkAgents[0]);
+	const float radius_squared = SpatialHashBenchmarkRadius * SpatialHashBenchmarkRadius;
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Spatial hash benchmark: " << SpatialHashBenchmarkQueries << " queries of radius "
+		<< SpatialHashBenchmarkRadius << " on a " << SPATIAL_HASH_CELLS << "x" << SPATIAL_HASH_CELLS << " grid" << std::endl << std::endl;
+	out << "Agents	Found	Mismatches	Scan (us)	Grid (us)	Nearest (us)	Speedup" << std::endl;
+
+	for (int d = 0; d < densities; ++d)
+	{
+		int agents = SpatialHashBenchmarkAgents[d];
+		Random random(agents);
+
+		std::vector<GameObject*> objects;
+		for (int i = 0; i < agents; ++i)
+		{
+			D3DXVECTOR3 pos(random.RangeFloat(0.0f, 1.0f), 0.0f, random.RangeFloat(0.0f, 1.0f));
+			GameObject *object = new GameObject(g_database.GetNewObjectID(), OBJECT_NPC, "Benchmark");
+			object->CreateBody(100, pos);
+			object->CreateStateMachineManager();
+			g_database.Store(*object);
+			objects.push_back(object);
+		}
+
+		std::vector<D3DXVECTOR3> centers(SpatialHashBenchmarkQueries);
+		for (int i = 0; i < SpatialHashBenchmarkQueries; ++i)
+			centers[i] = D3DXVECTOR3(random.RangeFloat(0.0f, 1.0f), 0.0f, random.RangeFloat(0.0f, 1.0f));
+
+		// every object of the type checked, as SendMsgRadius used to
+		std::vector<unsigned> scan_counts(SpatialHashBenchmarkQueries, 0);
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int i = 0; i < SpatialHashBenchmarkQueries; ++i)
+		{
+			const dbCompositionList &list = g_database.GetObjectsOfType(OBJECT_NPC);
+			for (unsigned j = 0, count = list.size(); j < count; ++j)
+			{
+				D3DXVECTOR3 diff = list[j]->GetBody().GetPos() - centers[i];
+				if (D3DXVec3Dot(&diff, &diff) <= radius_squared)
+					++scan_counts[i];
+			}
+		}
+		g_clock.StopStopwatchPathfinding();
+		double scan_time = g_clock.GetStopwatchPathfindingTime();
+
+		unsigned found = 0, mismatches = 0;
+		dbCompositionList list;
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int i = 0; i < SpatialHashBenchmarkQueries; ++i)
+		{
+			list.clear();
+			g_database.ComposeListInRadius(list, centers[i], SpatialHashBenchmarkRadius, OBJECT_NPC);
+			found += list.size();
+			mismatches += list.size() != scan_counts[i];
+		}
+		g_clock.StopStopwatchPathfinding();
+		double grid_time = g_clock.GetStopwatchPathfindingTime();
+
+		unsigned nearest = 0;
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int i = 0; i < SpatialHashBenchmarkQueries; ++i)
+			nearest += g_database.FindNearest(centers[i], SpatialHashBenchmarkRadius, OBJECT_NPC) != 0;
+		g_clock.StopStopwatchPathfinding();
+		double nearest_time = g_clock.GetStopwatchPathfindingTime();
+
+		// a query with anything in range has a nearest object, and only then
+		for (int i = 0; i < SpatialHashBenchmarkQueries; ++i)
+			nearest -= scan_counts[i] > 0;
+		mismatches += nearest;
+
+		out << agents << "\t" << found << "\t" << mismatches << "\t\t"
+			<< scan_time * 1000.0 / SpatialHashBenchmarkQueries << "\t\t"
+			<< grid_time * 1000.0 / SpatialHashBenchmarkQueries << "\t\t"
+			<< nearest_time * 1000.0 / SpatialHashBenchmarkQueries << "\t\t";
+		if (grid_time > 0.0)
+			out << scan_time / grid_time << "x";
+		out << std::endl;
+
+		for (int i = agents - 1; i >= 0; --i)
+		{
+			g_database.Remove(objects[i]->GetID());
+			delete objects[i];
+		}
+	}
+
+	out.close();
+}
+
+// the messages behind OnPeriodicTimeInState on every agent: each delivery arms the next one,
+// and a few agents change state every frame, purging their scoped timers and arming a new one
+void PathfindingTests::RunTimerBenchmark(const char *out_filename)
+{
+	Random random(TimerBenchmarkTimers);
+
+	// agents are only receivers here, the benchmark times the delayed message store and not routing
+	std::vector<float> periods(TimerBenchmarkTimers);
+	for (int i = 0; i < TimerBenchmarkTimers; ++i)
+		periods[i] = random.RangeFloat(0.1f, 2.0f);
+
+	std::vector<int> state_changes(TimerBenchmarkFrames * TimerBenchmarkStateChanges);
+	for (unsigned i = 0; i < state_changes.size(); ++i)
+		state_changes[i] = random.RangeInt(0, TimerBenchmarkTimers - 1);
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Timer benchmark: " << TimerBenchmarkTimers << " periodic timers over " << TimerBenchmarkFrames
+		<< " frames, " << TimerBenchmarkStateChanges << " state changes a frame" << std::endl << std::endl;
+	out << "Store			Deliveries	Time (ms)	Per frame (us)" << std::endl;
+
+	MSG_Data data(0);
+	unsigned deliveries[2];
+	double per_frame[2];
+	for (int wheel = 0; wheel < 2; ++wheel)
+	{
+		TimingWheel timers;
+		DelayedMsgSet messages;
+		deliveries[wheel] = 0;
+
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+
+		for (int i = 0; i < TimerBenchmarkTimers; ++i)
+		{
+			objectID id = SYSTEM_OBJECT_ID + 1 + i;
+			MSG_Object msg(periods[i], MSG_GENERIC_TIMER, id, id, SCOPE_TO_STATE, 0, STATE_MACHINE_QUEUE_0, data, false, false);
+			if (wheel)
+				timers.Schedule(msg);
+			else
+				messages.insert(new MSG_Object(msg));
+		}
+
+		for (int frame = 1; frame <= TimerBenchmarkFrames; ++frame)
+		{
+			float now = frame * TimerBenchmarkFrameTime;
+
+			MSG_Object msg;
+			while (true)
+			{
+				if (wheel)
+				{
+					if (!timers.PopDue(now, msg))
+						break;
+				}
+				else
+				{
+					if (messages.empty() || (*messages.begin())->GetDeliveryTime() > now)
+						break;
+					msg = **messages.begin();
+					delete *messages.begin();
+					messages.erase(messages.begin());
+				}
+
+				++deliveries[wheel];
+				int agent = msg.GetReceiver() - SYSTEM_OBJECT_ID - 1;
+				msg.SetDeliveryTime(now + periods[agent]);
+				if (wheel)
+					timers.Schedule(msg);
+				else
+					messages.insert(new MSG_Object(msg));
+			}
+
+			for (int i = 0; i < TimerBenchmarkStateChanges; ++i)
+			{
+				int agent = state_changes[(frame - 1) * TimerBenchmarkStateChanges + i];
+				objectID id = SYSTEM_OBJECT_ID + 1 + agent;
+				MSG_Object msg(now + periods[agent], MSG_GENERIC_TIMER, id, id, SCOPE_TO_STATE, 0, STATE_MACHINE_QUEUE_0, data, false, false);
+				if (wheel)
+				{
+					TimerHandle handle = timers.GetFirst(id);
+					while (handle != INVALID_TIMER_HANDLE)
+					{
+						TimerHandle next = timers.GetNext(handle);
+						timers.Cancel(handle);
+						handle = next;
+					}
+					timers.Schedule(msg);
+				}
+				else
+				{
+					PurgeScopedFromSet(messages, id);
+					messages.insert(new MSG_Object(msg));
+				}
+			}
+		}
+
+		g_clock.StopStopwatchPathfinding();
+		double time = g_clock.GetStopwatchPathfindingTime();
+		per_frame[wheel] = time * 1000.0 / TimerBenchmarkFrames;
+		out << (wheel ? "Timing wheel		" : "std::set, new/delete	") << deliveries[wheel] << "\t\t" << time << "\t\t" << per_frame[wheel] << std::endl;
+
+		for (DelayedMsgSet::iterator i = messages.begin(); i != messages.end(); ++i)
+			delete *i;
+	}
+
+	if (per_frame[1] > 0.0)
+		out << std::endl << "Speedup: " << per_frame[0] / per_frame[1] << "x" << std::endl;
+	if (deliveries[0] != deliveries[1])
+		out << "Delivery counts differ" << std::endl;
+
+	out.close();
+}
+
+void PathfindingTests::RunDebugLogBenchmark(const char *out_filename)
+{
+	// the entry the log used to keep, names copied in and one heap allocation per event
+	struct StringLogEntry
+	{
+		objectID owner;
+		float timestamp;
+		bool handled;
+		char statename[64];
+		char substatename[64];
+		char eventmsgname[64];
+	};
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Debug log benchmark: " << DebugLogBenchmarkEvents << " handled state machine events" << std::endl << std::endl;
+	out << "Log				Time (ms)	Per event (ns)" << std::endl;
+
+	MSG_Data data(0);
+	MSG_Object msg(0.0f, MSG_GENERIC_TIMER, SYSTEM_OBJECT_ID, SYSTEM_OBJECT_ID, SCOPE_TO_STATE, 0, STATE_MACHINE_QUEUE_0, data, false, false);
+
+	double per_event[2];
+	for (int ring = 0; ring < 2; ++ring)
+	{
+		DebugLog *log = new DebugLog();
+		std::list<StringLogEntry*> entries;
+
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+
+		for (int i = 0; i < DebugLogBenchmarkEvents; ++i)
+		{
+			if (ring)
+			{
+				log->LogStateMachineEvent(SYSTEM_OBJECT_ID, &msg, "STATE_Idle", "", "MSG_GENERIC_TIMER", true);
+				continue;
+			}
+
+			if (strcmp(MessageNameText[msg.GetName()], "MSG_CHANGE_STATE_DELAYED") == 0 ||
+				strcmp(MessageNameText[msg.GetName()], "MSG_CHANGE_SUBSTATE_DELAYED") == 0)
+				continue;
+
+			StringLogEntry *entry = new StringLogEntry;
+			entry->owner = SYSTEM_OBJECT_ID;
+			entry->timestamp = g_clock.GetCurTime();
+			entry->handled = true;
+			strcpy(entry->statename, "STATE_Idle");
+			strcpy(entry->substatename, "");
+			strcpy(entry->eventmsgname, "MSG_GENERIC_TIMER");
+			entries.push_back(entry);
+			if (entries.size() > DebugLogBenchmarkHistory)
+			{
+				delete entries.front();
+				entries.pop_front();
+			}
+		}
+
+		g_clock.StopStopwatchPathfinding();
+		double time = g_clock.GetStopwatchPathfindingTime();
+		per_event[ring] = time * 1000000.0 / DebugLogBenchmarkEvents;
+		out << (ring ? "Binary ring			" : "Strings, new/delete	") << time << "\t\t" << per_event[ring] << std::endl;
+
+		for (std::list<StringLogEntry*>::iterator i = entries.begin(); i != entries.end(); ++i)
+			delete *i;
+		delete log;
+	}
+
+	if (per_event[1] > 0.0)
+		out << std::endl << "Speedup: " << per_event[0] / per_event[1] << "x" << std::endl;
+
+	out.close();
+}
+
+void PathfindingTests::RunPhasedUpdateBenchmark(const char *out_filename)
+{
+	const int sizes = sizeof(PhasedUpdateBenchmarkAgents) / sizeof(PhasedUpdateBenchmarkAgents[0]);
+	const int configs = sizeof(PhasedUpdateBenchmarkWorkers) / sizeof(PhasedUpdateBenchmarkWorkers[0]);
+
+	// every due message goes out each frame, otherwise the runs would differ by timing
+	float load_balancing = g_msgroute.GetLoadBalancingConstraint();
+	g_msgroute.SetLoadBalancingConstraint(1000.0f);
+	bool was_phased = g_database.IsPhasedUpdate();
+	unsigned was_workers = g_database.GetUpdateWorkerCount();
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Phased update benchmark: " << PhasedUpdateBenchmarkFrames << " frames, "
+		<< PhasedUpdateBenchmarkWork << " rounds of work per agent update" << std::endl << std::endl;
+	out << "Agents	Update			Messages	Per frame (ms)	Speedup	Replay" << std::endl;
+
+	for (int size = 0; size < sizes; ++size)
+	{
+		int agents = PhasedUpdateBenchmarkAgents[size];
+
+		double serial_time;
+		unsigned serial_received;
+		unsigned serial_digest = RunPhasedUpdateFrames(agents, false, serial_time, serial_received);
+		out << agents << "\tSerial\t\t\t" << serial_received << "\t\t" << serial_time << std::endl;
+
+		for (int config = 0; config < configs; ++config)
+		{
+			unsigned workers = PhasedUpdateBenchmarkWorkers[config];
+			g_database.SetPhasedUpdate(true, workers);
+
+			double time;
+			unsigned received;
+			unsigned digest = RunPhasedUpdateFrames(agents, true, time, received);
+			out << agents << "\tPhased, " << workers + 1 << " threads\t" << received << "\t\t" << time << "\t\t"
+				<< (time > 0.0 ? serial_time / time : 0.0) << "x\t"
+				<< (digest == serial_digest ? "matches serial" : "DIFFERS from serial") << std::endl;
+		}
+	}
+
+	out.close();
+
+	g_database.SetPhasedUpdate(was_phased, was_workers);
+	g_msgroute.SetLoadBalancingConstraint(load_balancing);
+}
+
+void PathfindingTests::RunDispatchBenchmark(const char *out_filename)
+{
+	const int targets = sizeof(DispatchBenchmarkStates) / sizeof(DispatchBenchmarkStates[0]);
+	const int names = sizeof(DispatchBenchmarkMsgs) / sizeof(DispatchBenchmarkMsgs[0]);
+	bool was_skipping = StateMachine::IsSkipUnregisteredMsgs();
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "State machine dispatch benchmark: " << DispatchBenchmarkEvents << " messages per row, 64 states of 9 handlers" << std::endl;
+	out << "(times include the debug log entry each scope writes)" << std::endl << std::endl;
+	out << "State	Message					Every scope (ns)	Registered only (ns)	Speedup" << std::endl;
+
+	for (int target = 0; target < targets; ++target)
+	{
+		GameObject *object = new GameObject(g_database.GetNewObjectID(), OBJECT_NPC, "Dispatch");
+		object->CreateStateMachineManager();
+		g_database.Store(*object);
+		BenchmarkDispatch *machine = new BenchmarkDispatch(*object, DispatchBenchmarkStates[target]);
+		object->GetStateMachineManager()->PushStateMachine(*machine, STATE_MACHINE_QUEUE_0, true);
+
+		for (int name = 0; name < names; ++name)
+		{
+			MSG_Data data(0);
+			MSG_Object msg(0.0f, DispatchBenchmarkMsgs[name], SYSTEM_OBJECT_ID, object->GetID(), SCOPE_TO_STATE_MACHINE, 0, STATE_MACHINE_QUEUE_0, data, false, false);
+
+			double per_event[2];
+			for (int skip = 0; skip < 2; ++skip)
+			{
+				StateMachine::SetSkipUnregisteredMsgs(skip != 0);
+
+				g_clock.ClearStopwatchPathfinding();
+				g_clock.StartStopwatchPathfinding();
+
+				for (int i = 0; i < DispatchBenchmarkEvents; ++i)
+					machine->Process(EVENT_Message, &msg);
+
+				g_clock.StopStopwatchPathfinding();
+				per_event[skip] = g_clock.GetStopwatchPathfindingTime() * 1000000.0 / DispatchBenchmarkEvents;
+			}
+
+			out << DispatchBenchmarkStates[target] + 1 << "\t" << MessageNameText[DispatchBenchmarkMsgs[name]] << "\t\t"
+				<< per_event[0] << "\t\t\t" << per_event[1] << "\t\t\t"
+				<< (per_event[1] > 0.0 ? per_event[0] / per_event[1] : 0.0) << "x" << std::endl;
+		}
+
+		g_database.Remove(object->GetID());
+		delete object;
+	}
+
+	out.close();
+
+	StateMachine::SetSkipUnregisteredMsgs(was_skipping);
+}
+
+void PathfindingTests::RunOpennessBenchmark(const char *out_filename)
+{
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Openness benchmark: closest wall for every tile, 20% walls" << std::endl;
+	out << "(the scan is timed on " << OpennessBenchmarkScanTiles << " tiles and scaled up to the whole map)" << std::endl << std::endl;
+	out << "Width	Walls	Scan (ms)	Transform (ms)	Speedup	Wall edit (ms)	Check" << std::endl;
+
+	for (unsigned i = 0; i < sizeof(OpennessBenchmarkWidths) / sizeof(OpennessBenchmarkWidths[0]); ++i)
+	{
+		int width = OpennessBenchmarkWidths[i];
+		int cells = width * width;
+		Random random(width);
+		Map map(width);
+
+		GenerateBenchmarkMap(map, random, 20);
+
+		std::vector<int> walls;
+		Tile **terrain = map.GetTerrain();
+		for (int r = 0; r < width; ++r)
+		{
+			for (int c = 0; c < width; ++c)
+			{
+				if (terrain[r][c] == TILE_WALL)
+					walls.push_back(r * width + c);
+			}
+		}
+
+		WallDistance distance;
+
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int build = 0; build < OpennessBenchmarkBuilds; ++build)
+			distance.Build(map);
+		g_clock.StopStopwatchPathfinding();
+		double transform_time = g_clock.GetStopwatchPathfindingTime() / OpennessBenchmarkBuilds;
+
+		// tiles spread evenly over the map
+		std::vector<int> scanned(OpennessBenchmarkScanTiles);
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int tile = 0; tile < OpennessBenchmarkScanTiles; ++tile)
+		{
+			int index = static_cast<int>(static_cast<long long>(tile) * cells / OpennessBenchmarkScanTiles);
+			scanned[tile] = SquaredDistanceByScan(width, walls, index / width, index % width);
+		}
+		g_clock.StopStopwatchPathfinding();
+		double scan_time = g_clock.GetStopwatchPathfindingTime() * cells / OpennessBenchmarkScanTiles;
+
+		bool matches = true;
+		for (int tile = 0; tile < OpennessBenchmarkScanTiles; ++tile)
+		{
+			int index = static_cast<int>(static_cast<long long>(tile) * cells / OpennessBenchmarkScanTiles);
+			if (terrain[index / width][index % width] != TILE_WALL && scanned[tile] != distance.GetSquaredDistance(index / width, index % width))
+				matches = false;
+		}
+
+		// single wall edits, each patched in before the next
+		double edit_time = 0.0;
+		for (int edit = 0; edit < OpennessBenchmarkEdits; ++edit)
+		{
+			int r = random.RangeInt(0, width - 1);
+			int c = random.RangeInt(0, width - 1);
+			if (terrain[r][c] == TILE_WALL)
+				map.RemoveWall(r, c);
+			else
+				map.PlaceWall(r, c);
+
+			std::vector<int> rows;
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+			distance.Update(map, rows);
+			g_clock.StopStopwatchPathfinding();
+			edit_time += g_clock.GetStopwatchPathfindingTime();
+		}
+
+		WallDistance rebuilt;
+		rebuilt.Build(map);
+		for (int r = 0; r < width; ++r)
+		{
+			for (int c = 0; c < width; ++c)
+			{
+				if (rebuilt.GetSquaredDistance(r, c) != distance.GetSquaredDistance(r, c))
+					matches = false;
+			}
+		}
+
+		out << width << "\t" << walls.size() << "\t" << scan_time << "\t\t" << transform_time << "\t\t"
+			<< (transform_time > 0.0 ? scan_time / transform_time : 0.0) << "x\t" << edit_time / OpennessBenchmarkEdits << "\t\t"
+			<< (matches ? "matches scan and rebuild" : "DIFFERS") << std::endl;
+
+		map.Destroy();
+	}
+
+	out.close();
+}
+
+void PathfindingTests::RunVisibilityBenchmark(const char *out_filename)
+{
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Visibility benchmark: tiles seen from every tile, 20% walls" << std::endl;
+	out << "(the walk is timed on " << VisibilityBenchmarkWalkTiles << " tiles and scaled up to the whole map)" << std::endl << std::endl;
+	out << "Width	Walk (ms)	Build (ms)	Count (ms)	Speedup	Wall edit (ms)	Check" << std::endl;
+
+	for (unsigned i = 0; i < sizeof(VisibilityBenchmarkWidths) / sizeof(VisibilityBenchmarkWidths[0]); ++i)
+	{
+		int width = VisibilityBenchmarkWidths[i];
+		int cells = width * width;
+		Random random(width);
+		Map map(width);
+
+		GenerateBenchmarkMap(map, random, 20);
+		Tile **terrain = map.GetTerrain();
+
+		VisibilitySet visibility;
+
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		visibility.Build(map);
+		g_clock.StopStopwatchPathfinding();
+		double build_time = g_clock.GetStopwatchPathfindingTime();
+
+		std::vector<int> counted(cells);
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int tile = 0; tile < cells; ++tile)
+			counted[tile] = visibility.CountVisible(tile / width, tile % width);
+		g_clock.StopStopwatchPathfinding();
+		double count_time = g_clock.GetStopwatchPathfindingTime();
+
+		// tiles spread evenly over the map, every line from them walked
+		std::vector<int> walked(VisibilityBenchmarkWalkTiles);
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int tile = 0; tile < VisibilityBenchmarkWalkTiles; ++tile)
+		{
+			int index = tile * cells / VisibilityBenchmarkWalkTiles;
+			walked[tile] = 0;
+			for (int other = 0; other < cells; ++other)
+			{
+				if (other != index && map.IsClearPath(index / width, index % width, other / width, other % width))
+					++walked[tile];
+			}
+		}
+		g_clock.StopStopwatchPathfinding();
+		double walk_time = g_clock.GetStopwatchPathfindingTime() * cells / VisibilityBenchmarkWalkTiles;
+
+		bool matches = true;
+		for (int tile = 0; tile < VisibilityBenchmarkWalkTiles; ++tile)
+		{
+			if (walked[tile] != counted[tile * cells / VisibilityBenchmarkWalkTiles])
+				matches = false;
+		}
+
+		// single wall edits, each patched in before the next
+		double edit_time = 0.0;
+		for (int edit = 0; edit < VisibilityBenchmarkEdits; ++edit)
+		{
+			int r = random.RangeInt(0, width - 1);
+			int c = random.RangeInt(0, width - 1);
+			if (terrain[r][c] == TILE_WALL)
+				map.RemoveWall(r, c);
+			else
+				map.PlaceWall(r, c);
+
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+			visibility.Update(map);
+			g_clock.StopStopwatchPathfinding();
+			edit_time += g_clock.GetStopwatchPathfindingTime();
+		}
+
+		VisibilitySet rebuilt;
+		rebuilt.Build(map);
+		for (int tile = 0; tile < cells; ++tile)
+		{
+			for (int other = 0; other < cells; ++other)
+			{
+				if (other != tile && rebuilt.IsVisible(tile / width, tile % width, other / width, other % width) !=
+					visibility.IsVisible(tile / width, tile % width, other / width, other % width))
+					matches = false;
+			}
+		}
+
+		out << width << "\t" << walk_time << "\t\t" << build_time << "\t\t" << count_time << "\t\t"
+			<< (count_time > 0.0 ? walk_time / count_time : 0.0) << "x\t" << edit_time / VisibilityBenchmarkEdits << "\t\t"
+			<< (matches ? "matches walk and rebuild" : "DIFFERS") << std::endl;
+
+		map.Destroy();
+	}
+
+	out.close();
+}
+
+void PathfindingTests::RunPropagationBenchmark(const char *out_filename)
+{
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Propagation benchmark: " << PropagationBenchmarkPasses << " normalized passes of positive and negative influence, 20% walls" << std::endl << std::endl;
+	out << "Width	Rows (Mtiles/s)	Layers (Mtiles/s)	Speedup	Check" << std::endl;
+
+	for (unsigned i = 0; i < sizeof(PropagationBenchmarkWidths) / sizeof(PropagationBenchmarkWidths[0]); ++i)
+	{
+		int width = PropagationBenchmarkWidths[i];
+		Random random(width);
+		Map map(width);
+
+		GenerateBenchmarkMap(map, random, 20);
+		Tile **terrain = map.GetTerrain();
+
+		float **rows = new float*[width];
+		float **rows_temp = new float*[width];
+		for (int r = 0; r < width; ++r)
+		{
+			rows[r] = new float[width]();
+			rows_temp[r] = new float[width]();
+		}
+
+		// sources of either sign on open tiles, the same in both
+		g_terrain.BindMap(map);
+		for (int source = 0; source < PropagationBenchmarkSources; ++source)
+		{
+			int r = random.RangeInt(0, width - 1);
+			int c = random.RangeInt(0, width - 1);
+			if (terrain[r][c] == TILE_WALL)
+				continue;
+
+			float value = (source & 1) ? -1.0f : 1.0f;
+			rows[r][c] = value;
+			g_terrain.SetInfluenceMapValue(r, c, value);
+		}
+
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int pass = 0; pass < PropagationBenchmarkPasses; ++pass)
+		{
+			PropagateByRows(rows, rows_temp, terrain, width, PropagationBenchmarkDecay, PropagationBenchmarkGrowing, true);
+			std::swap(rows, rows_temp);
+			NormalizeByRows(rows, width, true);
+		}
+		g_clock.StopStopwatchPathfinding();
+		double rows_time = g_clock.GetStopwatchPathfindingTime();
+
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int pass = 0; pass < PropagationBenchmarkPasses; ++pass)
+		{
+			g_terrain.Propagation(PropagationBenchmarkDecay, PropagationBenchmarkGrowing, true);
+			g_terrain.NormalizeOccupancyMap(true);
+		}
+		g_clock.StopStopwatchPathfinding();
+		double layers_time = g_clock.GetStopwatchPathfindingTime();
+
+		bool matches = true;
+		for (int r = 0; r < width; ++r)
+		{
+			for (int c = 0; c < width; ++c)
+			{
+				if (rows[r][c] != g_terrain.GetInfluenceMapValue(r, c))
+					matches = false;
+			}
+		}
+
+		// tiles per millisecond are thousands per second
+		double tiles = static_cast<double>(width) * width * PropagationBenchmarkPasses;
+		double rows_rate = (rows_time > 0.0) ? tiles / rows_time / 1000.0 : 0.0;
+		double layers_rate = (layers_time > 0.0) ? tiles / layers_time / 1000.0 : 0.0;
+
+		out << width << "\t" << rows_rate << "\t\t" << layers_rate << "\t\t"
+			<< (rows_rate > 0.0 ? layers_rate / rows_rate : 0.0) << "x\t"
+			<< (matches ? "matches rows" : "DIFFERS") << std::endl;
+
+		for (int r = 0; r < width; ++r)
+		{
+			delete[] rows[r];
+			delete[] rows_temp[r];
+		}
+		delete[] rows;
+		delete[] rows_temp;
+		map.Destroy();
+	}
+
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+
+	out.close();
+}
+
+void PathfindingTests::RunMapLayoutBenchmark(const char *out_filename)
+{
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Map layout benchmark: " << LayoutBenchmarkScans << " scans of every tile's neighbors as A* expands them and "
+		<< LayoutBenchmarkLines << " lines of sight, 20% walls" << std::endl << std::endl;
+	out << "Width	Neighbors: rows (ms)	mask (ms)	Lines: rows (ms)	mask (ms)	Check" << std::endl;
+
+	for (unsigned i = 0; i < sizeof(LayoutBenchmarkWidths) / sizeof(LayoutBenchmarkWidths[0]); ++i)
+	{
+		int width = LayoutBenchmarkWidths[i];
+		Random random(width);
+		Map map(width);
+
+		GenerateBenchmarkMap(map, random, 20);
+		g_terrain.BindMap(map);
+
+		Tile **terrain = map.GetTerrain();
+		Tile **rows = new Tile*[width];
+		for (int r = 0; r < width; ++r)
+		{
+			rows[r] = new Tile[width];
+			memcpy(rows[r], terrain[r], width * sizeof(Tile));
+		}
+
+		std::vector<int> lines(4 * LayoutBenchmarkLines);
+		for (size_t line = 0; line < lines.size(); ++line)
+			lines[line] = random.RangeInt(0, width - 1);
+
+		unsigned rows_neighbors = 0;
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int scan = 0; scan < LayoutBenchmarkScans; ++scan)
+		{
+			for (int r = 0; r < width; ++r)
+			{
+				for (int c = 0; c < width; ++c)
+				{
+					if (rows[r][c] != TILE_WALL)
+						rows_neighbors += CountOpenNeighborsByRows(rows, width, r, c);
+				}
+			}
+		}
+		g_clock.StopStopwatchPathfinding();
+		double rows_neighbor_time = g_clock.GetStopwatchPathfindingTime();
+
+		// through a reference, as the A* expansion looks the walls up
+		Terrain &bound_terrain = g_terrain;
+		unsigned mask_neighbors = 0;
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int scan = 0; scan < LayoutBenchmarkScans; ++scan)
+		{
+			for (int r = 0; r < width; ++r)
+			{
+				for (int c = 0; c < width; ++c)
+				{
+					if (bound_terrain.IsWall(r, c))
+						continue;
+
+					for (int dr = -1; dr <= 1; ++dr)
+					{
+						for (int dc = -1; dc <= 1; ++dc)
+						{
+							int rn = r + dr;
+							int cn = c + dc;
+							if ((dr == 0 && dc == 0) || rn < 0 || rn >= width || cn < 0 || cn >= width || bound_terrain.IsWall(rn, cn))
+								continue;
+
+							if (dr != 0 && dc != 0 && (bound_terrain.IsWall(rn, c) || bound_terrain.IsWall(r, cn)))
+								continue;
+
+							++mask_neighbors;
+						}
+					}
+				}
+			}
+		}
+		g_clock.StopStopwatchPathfinding();
+		double mask_neighbor_time = g_clock.GetStopwatchPathfindingTime();
+
+		unsigned rows_clear = 0;
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int line = 0; line < LayoutBenchmarkLines; ++line)
+			rows_clear += IsClearPathByRows(rows, lines[4 * line], lines[4 * line + 1], lines[4 * line + 2], lines[4 * line + 3]);
+		g_clock.StopStopwatchPathfinding();
+		double rows_line_time = g_clock.GetStopwatchPathfindingTime();
+
+		unsigned mask_clear = 0;
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int line = 0; line < LayoutBenchmarkLines; ++line)
+			mask_clear += map.IsClearPath(lines[4 * line], lines[4 * line + 1], lines[4 * line + 2], lines[4 * line + 3]);
+		g_clock.StopStopwatchPathfinding();
+		double mask_line_time = g_clock.GetStopwatchPathfindingTime();
+
+		bool matches = (rows_neighbors == mask_neighbors && rows_clear == mask_clear);
+
+		out << width << "\t" << rows_neighbor_time << "\t\t\t" << mask_neighbor_time << "\t\t"
+			<< rows_line_time << "\t\t\t" << mask_line_time << "\t\t"
+			<< (matches ? "same neighbors and lines" : "DIFFERS") << std::endl;
+
+		for (int r = 0; r < width; ++r)
+			delete[] rows[r];
+		delete[] rows;
+		map.Destroy();
+	}
+
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+
+	out.close();
+}
+
+void PathfindingTests::RunMapLoadBenchmark(const char *out_filename)
+{
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Map load benchmark: text parsed then JPS+ and visibility computed, against the binary file mapped in, 20% walls" << std::endl;
+	out << "(visibility only on maps of up to " << VISIBILITY_MAX_TILES << " tiles, times are the average of " << MapLoadBenchmarkLoads << " loads)" << std::endl << std::endl;
+	out << "Width	Text (ms)	Text + layers (ms)	Binary (ms)	Speedup	File (KB)	Check" << std::endl;
+
+	for (unsigned i = 0; i < sizeof(MapLoadBenchmarkWidths) / sizeof(MapLoadBenchmarkWidths[0]); ++i)
+	{
+		int width = MapLoadBenchmarkWidths[i];
+		Random random(width);
+		Map map(width);
+
+		GenerateBenchmarkMap(map, random, 20);
+
+		std::ofstream text("BenchmarkMap.txt");
+		map.WriteText(text);
+		text.close();
+		map.SaveBinary(L"BenchmarkMap.map");
+
+		double text_time = 0.0;
+		double layers_time = 0.0;
+		for (int load = 0; load < MapLoadBenchmarkLoads; ++load)
+		{
+			Map loaded;
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+			loaded.Serialize(L"BenchmarkMap.txt");
+			g_clock.StopStopwatchPathfinding();
+			text_time += g_clock.GetStopwatchPathfindingTime();
+
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+			loaded.GetJumpDistances();
+			loaded.GetVisibility();
+			g_clock.StopStopwatchPathfinding();
+			layers_time += g_clock.GetStopwatchPathfindingTime();
+
+			loaded.Destroy();
+		}
+		text_time /= MapLoadBenchmarkLoads;
+		layers_time = text_time + layers_time / MapLoadBenchmarkLoads;
+
+		double binary_time = 0.0;
+		for (int load = 0; load < MapLoadBenchmarkLoads; ++load)
+		{
+			Map loaded;
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+			loaded.Serialize(L"BenchmarkMap.map");
+			g_clock.StopStopwatchPathfinding();
+			binary_time += g_clock.GetStopwatchPathfindingTime();
+
+			loaded.Destroy();
+		}
+		binary_time /= MapLoadBenchmarkLoads;
+
+		// the binary map comes back with the same walls and layers
+		Map loaded;
+		loaded.Serialize(L"BenchmarkMap.map");
+		bool matches = loaded.GetWidth() == width;
+		JumpDistances **jumps = map.GetJumpDistances();
+		JumpDistances **loaded_jumps = loaded.GetJumpDistances();
+		const VisibilitySet *visibility = map.GetVisibility();
+		const VisibilitySet *loaded_visibility = loaded.GetVisibility();
+		for (int r = 0; matches && r < width; ++r)
+		{
+			if (memcmp(map.GetTerrain()[r], loaded.GetTerrain()[r], width * sizeof(Tile)) != 0 ||
+				memcmp(jumps[r], loaded_jumps[r], width * sizeof(JumpDistances)) != 0)
+				matches = false;
+		}
+		if ((visibility != 0) != (loaded_visibility != 0) || (visibility && visibility->GetBits() != loaded_visibility->GetBits()))
+			matches = false;
+
+		std::ifstream binary("BenchmarkMap.map", std::ios::binary | std::ios::ate);
+		double file_kb = static_cast<double>(binary.tellg()) / 1024.0;
+		binary.close();
+
+		out << width << "\t" << text_time << "\t\t" << layers_time << "\t\t\t" << binary_time << "\t\t"
+			<< (binary_time > 0.0 ? layers_time / binary_time : 0.0) << "x\t" << file_kb << "\t\t"
+			<< (matches ? "same walls and layers" : "DIFFERS") << std::endl;
+
+		loaded.Destroy();
+		map.Destroy();
+	}
+
+	remove("BenchmarkMap.txt");
+	remove("BenchmarkMap.map");
+
+	out.close();
+}
+
+void PathfindingTests::RunReanalysisBenchmark(const char *out_filename)
+{
+	static const char *names[] = { "Openness", "Visibility" };
+	bool analysis_flag = g_blackboard.GetTerrainAnalysisFlag();
+	int analysis_type = g_blackboard.GetTerrainAnalysisType();
+	if (!analysis_flag)
+		g_blackboard.ToggleTerrainAnalysisFlag();
+
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Reanalysis benchmark: a full analysis against Analyze() after each of " << ReanalysisBenchmarkEdits
+		<< " single wall edits, 20% walls" << std::endl << std::endl;
+	out << "Analysis	Width	Full (ms)	Per edit (ms)	Speedup	Check" << std::endl;
+
+	for (unsigned i = 0; i < sizeof(ReanalysisBenchmarkTypes) / sizeof(ReanalysisBenchmarkTypes[0]); ++i)
+	{
+		int width = ReanalysisBenchmarkWidths[i];
+		Random random(width);
+		Map map(width);
+
+		GenerateBenchmarkMap(map, random, 20);
+		g_terrain.BindMap(map);
+		g_blackboard.SetTerrainAnalysisType(ReanalysisBenchmarkTypes[i]);
+
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		g_terrain.SetTerrainAnalysis();
+		g_clock.StopStopwatchPathfinding();
+		double full_time = g_clock.GetStopwatchPathfindingTime();
+
+		double edit_time = 0.0;
+		for (int edit = 0; edit < ReanalysisBenchmarkEdits; ++edit)
+		{
+			int r = random.RangeInt(0, width - 1);
+			int c = random.RangeInt(0, width - 1);
+			if (g_terrain.IsWall(r, c))
+				map.RemoveWall(r, c);
+			else
+				map.PlaceWall(r, c);
+
+			g_clock.ClearStopwatchPathfinding();
+			g_clock.StartStopwatchPathfinding();
+			g_terrain.Analyze();
+			g_clock.StopStopwatchPathfinding();
+			edit_time += g_clock.GetStopwatchPathfindingTime();
+		}
+		edit_time /= ReanalysisBenchmarkEdits;
+
+		// the patched layer matches one analyzed from scratch over the edited walls
+		std::vector<float> patched(width * width);
+		for (int r = 0; r < width; ++r)
+			for (int c = 0; c < width; ++c)
+				patched[r * width + c] = g_terrain.GetInfluenceMapValue(r, c);
+
+		g_terrain.SetTerrainAnalysis();
+		bool matches = true;
+		for (int r = 0; matches && r < width; ++r)
+			for (int c = 0; matches && c < width; ++c)
+				matches = patched[r * width + c] == g_terrain.GetInfluenceMapValue(r, c);
+
+		out << names[i] << "\t" << width << "\t" << full_time << "\t\t" << edit_time << "\t\t"
+			<< (edit_time > 0.0 ? full_time / edit_time : 0.0) << "x\t"
+			<< (matches ? "same as a full analysis" : "DIFFERS") << std::endl;
+
+		map.Destroy();
+	}
+
+	// occupancy is propagated every frame, Analyze() only zeroes it on new walls
+	int width = ReanalysisBenchmarkWidths[0];
+	Random random(width);
+	Map map(width);
+
+	GenerateBenchmarkMap(map, random, 20);
+	g_terrain.BindMap(map);
+	g_blackboard.SetTerrainAnalysisType(TerrainAnalysis_Propagation);
+	g_terrain.SetTerrainAnalysis();
+	for (int r = 0; r < width; ++r)
+		for (int c = 0; c < width; ++c)
+			if (!g_terrain.IsWall(r, c))
+				g_terrain.SetInfluenceMapValue(r, c, 1.0f);
+
+	std::vector<int> placed;
+	for (int edit = 0; edit < ReanalysisBenchmarkEdits; ++edit)
+	{
+		int r = random.RangeInt(0, width - 1);
+		int c = random.RangeInt(0, width - 1);
+		if (!g_terrain.IsWall(r, c))
+		{
+			map.PlaceWall(r, c);
+			placed.push_back(r * width + c);
+		}
+	}
+
+	g_clock.ClearStopwatchPathfinding();
+	g_clock.StartStopwatchPathfinding();
+	g_terrain.Analyze();
+	g_clock.StopStopwatchPathfinding();
+	double clear_time = g_clock.GetStopwatchPathfindingTime();
+
+	bool cleared = true;
+	for (size_t i = 0; i < placed.size(); ++i)
+		cleared = cleared && g_terrain.GetInfluenceMapValue(placed[i] / width, placed[i] % width) == 0.0f;
+
+	out << std::endl << "Occupancy	" << width << "\t" << placed.size() << " walls placed, cleared in " << clear_time << " ms\t"
+		<< (cleared ? "no influence left on walls" : "DIFFERS") << std::endl;
+
+	map.Destroy();
+
+	g_blackboard.SetTerrainAnalysisType(analysis_type);
+	if (!analysis_flag)
+		g_blackboard.ToggleTerrainAnalysisFlag();
+	g_terrain.BindMap(*g_terrain.GetCurrentMap());
+
+	out.close();
+}
+
+void PathfindingTests::RunFieldOfViewBenchmark(const char *out_filename)
+{
+	g_clock.UpdateQPCFrequency();
+
+	std::ofstream out(out_filename);
+
+	out << std::endl << "Field of view benchmark: tiles seen by " << FieldOfViewBenchmarkViewers
+		<< " viewers, all around and in a facing cone a tad over 180 degrees, 20% walls" << std::endl << std::endl;
+	out << "Width	Walk (ms)	Sweep (ms)	Cone sweep (ms)	Speedup	Seen per viewer	Check" << std::endl;
+
+	FieldOfView field_of_view;
+	std::vector<int> tiles;
+
+	for (unsigned i = 0; i < sizeof(FieldOfViewBenchmarkWidths) / sizeof(FieldOfViewBenchmarkWidths[0]); ++i)
+	{
+		int width = FieldOfViewBenchmarkWidths[i];
+		Random random(width);
+		Map map(width);
+
+		GenerateBenchmarkMap(map, random, 20);
+
+		std::vector<int> rows, cols;
+		std::vector<float> dir_x, dir_z;
+		while (static_cast<int>(rows.size()) < FieldOfViewBenchmarkViewers)
+		{
+			int r = random.RangeInt(0, width - 1);
+			int c = random.RangeInt(0, width - 1);
+			if (map.IsWall(r, c))
+				continue;
+
+			rows.push_back(r);
+			cols.push_back(c);
+			dir_x.push_back(random.RangeFloat(-1.0f, 1.0f));
+			dir_z.push_back(random.RangeFloat(-1.0f, 1.0f));
+		}
+
+		// every tile tested the way the analyses did before, the cone as AnalyzeSearch applied it
+		std::vector<std::vector<int> > walked(FieldOfViewBenchmarkViewers), walked_cone(FieldOfViewBenchmarkViewers);
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int viewer = 0; viewer < FieldOfViewBenchmarkViewers; ++viewer)
+		{
+			float dir_length = sqrtf(dir_x[viewer] * dir_x[viewer] + dir_z[viewer] * dir_z[viewer]);
+			for (int r = 0; r < width; ++r)
+			{
+				for (int c = 0; c < width; ++c)
+				{
+					if (!map.IsClearPath(rows[viewer], cols[viewer], r, c))
+						continue;
+
+					walked[viewer].push_back(r * width + c);
+
+					float x = static_cast<float>(c - cols[viewer]);
+					float z = static_cast<float>(r - rows[viewer]);
+					if (x * dir_x[viewer] + z * dir_z[viewer] >= -0.1f * sqrtf(x * x + z * z) * dir_length)
+						walked_cone[viewer].push_back(r * width + c);
+				}
+			}
+		}
+		g_clock.StopStopwatchPathfinding();
+		double walk_time = g_clock.GetStopwatchPathfindingTime();
+
+		bool matches = true;
+		size_t seen = 0;
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int viewer = 0; viewer < FieldOfViewBenchmarkViewers; ++viewer)
+		{
+			field_of_view.Compute(map, rows[viewer], cols[viewer], tiles);
+			seen += tiles.size();
+
+			g_clock.StopStopwatchPathfinding();
+			std::sort(tiles.begin(), tiles.end());
+			matches = matches && tiles == walked[viewer];
+			g_clock.StartStopwatchPathfinding();
+		}
+		g_clock.StopStopwatchPathfinding();
+		double sweep_time = g_clock.GetStopwatchPathfindingTime();
+
+		g_clock.ClearStopwatchPathfinding();
+		g_clock.StartStopwatchPathfinding();
+		for (int viewer = 0; viewer < FieldOfViewBenchmarkViewers; ++viewer)
+		{
+			field_of_view.Compute(map, rows[viewer], cols[viewer], dir_x[viewer], dir_z[viewer], -0.1f, tiles);
+
+			g_clock.StopStopwatchPathfinding();
+			std::sort(tiles.begin(), tiles.end());
+			matches = matches && tiles == walked_cone[viewer];
+			g_clock.StartStopwatchPathfinding();
+		}
+		g_clock.StopStopwatchPathfinding();
+		double cone_time = g_clock.GetStopwatchPathfindingTime();
+
+		out << width << "\t" << walk_time << "\t\t" << sweep_time << "\t\t" << cone_time << "\t\t\t"
+			<< (sweep_time > 0.0 ? walk_time / sweep_time : 0.0) << "x\t" << seen / FieldOfViewBenchmarkViewers << "\t\t\t"
+			<< (matches ? "same tiles as the walk" : "DIFFERS") << std::endl;
+
+		map.Destroy();
+	}
+
+	out.close();
+}
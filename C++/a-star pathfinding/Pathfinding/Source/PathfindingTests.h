@@ -108,6 +108,81 @@ public:
 	void GetSampleTestResult(const char *filename, Agent &agent, bool is_increasing,
 		bool is_straightline, bool is_rubberband, bool is_smooth, FileLoadSample sample);
 
+	// run every benchmark, each one writes its own results file
+	void RunBenchmarks(Agent &agent);
+
+	// nodes expanded per second for each open list queue type over the sample queries
+	void RunOpenListBenchmark(const char *filename, const char *out_filename, Agent &agent);
+
+	// search cost on generated maps from 40x40 up to 4096x4096
+	void RunGridScalingBenchmark(const char *out_filename, Agent &agent);
+
+	// per-query latency of short searches on a large map, full node wipe against generation reset
+	void RunNodeResetBenchmark(const char *out_filename);
+
+	// A*, JPS and JPS+ checked against the sample outcomes, then compared on a generated map
+	void RunJumpPointBenchmark(const char *filename, const char *out_filename, Agent &agent);
+
+	// long routes with flat A* against HPA*: latency, path length, memory and cluster graph upkeep
+	void RunHierarchicalBenchmark(const char *out_filename);
+
+	// a frame of path requests from many agents searched by the worker pool, for every worker count
+	void RunPathRequestBenchmark(const char *out_filename);
+
+	// bursts of long searches run to the end in one frame against sliced under a frame budget
+	void RunTimeSlicingBenchmark(const char *out_filename);
+
+	// repeated patrol routes with and without the path cache, with a wall edit every so often
+	void RunPathCacheBenchmark(const char *out_filename);
+
+	// rubberbanding long paths with the bounding rectangle check against the supercover line check
+	void RunRubberbandBenchmark(const char *out_filename);
+
+	// time and heap allocations of rubberbanding, adding points and smoothing on long paths
+	void RunPostProcessBenchmark(const char *out_filename);
+
+	// messages routed to objects looked up in the database against a linear list scan
+	void RunDatabaseBenchmark(const char *out_filename);
+
+	// broadcasts to one object type through the per-type lists against composing a fresh list each time
+	void RunBroadcastBenchmark(const char *out_filename);
+
+	// radius and nearest queries through the spatial hash against a scan of every agent, at rising agent counts
+	void RunSpatialHashBenchmark(const char *out_filename);
+
+	// 10k periodic state timers through the timing wheel against the old sorted set of heap-allocated messages
+	void RunTimerBenchmark(const char *out_filename);
+
+	// state machine tracing into the binary debug log ring against copying strings into heap-allocated entries
+	void RunDebugLogBenchmark(const char *out_filename);
+
+	// thousands of agents updated one after another, then in phases on more and more threads, checking every run ends the same
+	void RunPhasedUpdateBenchmark(const char *out_filename);
+
+	// messages to a 64 state machine sent through every scope against only the scopes registered for them, in its first and last state
+	void RunDispatchBenchmark(const char *out_filename);
+
+	// closest wall distances for the openness analysis from the distance transform against checking every wall, and patched after wall edits
+	void RunOpennessBenchmark(const char *out_filename);
+
+	// tiles each tile sees for the visibility analysis from the map's visibility set against walking every line, and patched after wall edits
+	void RunVisibilityBenchmark(const char *out_filename);
+
+	// normalized two-sided influence propagation over the flat layers against a scalar pass over separate rows, in tiles per second
+	void RunPropagationBenchmark(const char *out_filename);
+
+	// wall lookups of an A* expansion and of line of sight on the wall mask against separately allocated tile rows (whole searches are in the grid scaling benchmark)
+	void RunMapLayoutBenchmark(const char *out_filename);
+
+	// map loading from the binary format with its precomputed layers against parsing the text format and computing the layers
+	void RunMapLoadBenchmark(const char *out_filename);
+
+	// single wall edits followed by Analyze(), which patches the openness and visibility layers and zeroes occupancy on new walls, against a full analysis
+	void RunReanalysisBenchmark(const char *out_filename);
+
+	// tiles a viewer sees, all around and in the player's facing cone, from one shadowcasting sweep against walking a line to every tile
+	void RunFieldOfViewBenchmark(const char *out_filename);
+
 private:
 	int m_outcome_index;
 	PathFindingOutcomeArray m_outcomes;
@@ -0,0 +1,281 @@
+#include "Stdafx.h"
+#include "SearchScheduler.h"
+#include "ClusterGraph.h"
+#include <algorithm>
+
+using namespace AStar;
+
+//default budget, a slice is short enough that the clock is checked well inside it
+static const double DEFAULT_FRAME_BUDGET = 2000.0;
+static const unsigned DEFAULT_SLICE_EXPANSIONS = 256;
+
+AStar::SchedulerStats::SchedulerStats() :
+  frames(0),
+  spikes(0),
+  totalFrameTime(0.0),
+  maxFrameTime(0.0),
+  completed(0),
+  restarted(0),
+  expansions(0),
+  totalLatency(0),
+  maxLatency(0)
+{
+}
+
+AStar::SearchScheduler::SearchScheduler() :
+  nextTicket(NO_TICKET + 1),
+  frameBudget(DEFAULT_FRAME_BUDGET),
+  sliceExpansions(DEFAULT_SLICE_EXPANSIONS),
+  firstSlot(0),
+  frame(0)
+{
+  g_clock.UpdateQPCFrequency();
+  SetSlotCount(SEARCH_SLOTS);
+}
+
+PathTicket AStar::SearchScheduler::Submit(const PathRequest& request)
+{
+  Job job;
+  job.ticket = nextTicket++;
+  job.request = request;
+  job.submitFrame = frame;
+  waiting.push_back(job);
+
+  //skip the null ticket when the counter wraps
+  if (nextTicket == NO_TICKET)
+    ++nextTicket;
+  return job.ticket;
+}
+
+bool AStar::SearchScheduler::Collect(PathTicket ticket, WaypointList& path)
+{
+  std::unordered_map<PathTicket, WaypointList>::iterator it = results.find(ticket);
+  if (it == results.end())
+    return false;
+
+  if (path.empty())
+    path.swap(it->second);
+  else
+    path.insert(path.end(), it->second.begin(), it->second.end());
+  results.erase(it);
+  return true;
+}
+
+void AStar::SearchScheduler::Cancel(PathTicket ticket)
+{
+  if (ticket == NO_TICKET)
+    return;
+
+  for (std::deque<Job>::iterator it = waiting.begin(); it != waiting.end(); ++it)
+  {
+    if (it->ticket == ticket)
+    {
+      waiting.erase(it);
+      return;
+    }
+  }
+
+  //a running search gives its slot back straight away
+  for (size_t i = 0; i < slots.size(); ++i)
+  {
+    if (slots[i].job.ticket == ticket)
+    {
+      slots[i].job.ticket = NO_TICKET;
+      slots[i].path.clear();
+      return;
+    }
+  }
+  results.erase(ticket);
+}
+
+void AStar::SearchScheduler::Update()
+{
+  ++frame;
+  if (waiting.empty() && GetActiveCount() == 0)
+    return;
+
+  Clock& clock = g_clock;
+  double start = clock.GetHighestResolutionTime();
+  double deadline = start + frameBudget * clock.GetQPCFrequency() / 1000.0;
+  unsigned wallVersion = g_terrain.GetMap()->GetWallVersion();
+
+  //a search that already looked at a changed tile could hand back a path through a new wall
+  for (size_t i = 0; i < slots.size(); ++i)
+  {
+    if (slots[i].job.ticket != NO_TICKET && WallsChangedUnder(slots[i], wallVersion))
+    {
+      ++stats.restarted;
+      ++slots[i].restarts;
+      Start(slots[i]);
+    }
+  }
+
+  //one slice per running search in turn, at least one round even when the budget is tiny
+  bool working = true;
+  while (working)
+  {
+    working = false;
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+      Slot& slot = slots[(firstSlot + i) % slots.size()];
+      if (slot.job.ticket == NO_TICKET)
+      {
+        if (waiting.empty())
+          continue;
+
+        slot.job = waiting.front();
+        slot.restarts = 0;
+        waiting.pop_front();
+        Start(slot);
+        if (slot.job.ticket == NO_TICKET)
+          continue;
+      }
+
+      MovementAlgo& search = *slot.search;
+      unsigned expanded = search.nodesExpanded;
+      bool sliced = frameBudget > 0.0 && slot.restarts < MAX_SEARCH_RESTARTS;
+      bool done = search.PathFind(slot.path, sliced ? sliceExpansions : 0);
+      stats.expansions += search.nodesExpanded - expanded;
+      if (done)
+        Finish(slot);
+
+      working = true;
+      if (frameBudget > 0.0 && clock.GetHighestResolutionTime() >= deadline)
+      {
+        working = false;
+        break;
+      }
+    }
+  }
+  firstSlot = (firstSlot + 1) % slots.size();
+
+  double frameTime = (clock.GetHighestResolutionTime() - start) / clock.GetQPCFrequency();
+  ++stats.frames;
+  stats.totalFrameTime += frameTime;
+  stats.maxFrameTime = (std::max)(stats.maxFrameTime, frameTime);
+  if (frameBudget > 0.0 && frameTime * 1000.0 > frameBudget * 2.0)
+    ++stats.spikes;
+}
+
+void AStar::SearchScheduler::SetFrameBudget(double microseconds, unsigned slice)
+{
+  frameBudget = microseconds;
+  sliceExpansions = (std::max)(slice, 1u);
+}
+
+void AStar::SearchScheduler::SetSlotCount(unsigned count)
+{
+  //searches in slots that go away start over from the front of the queue
+  for (size_t i = count; i < slots.size(); ++i)
+  {
+    if (slots[i].job.ticket != NO_TICKET)
+      waiting.push_front(slots[i].job);
+  }
+
+  size_t old = slots.size();
+  slots.resize((std::max)(count, 1u));
+  for (size_t i = old; i < slots.size(); ++i)
+  {
+    slots[i].job.ticket = NO_TICKET;
+    slots[i].wallVersion = 0;
+    slots[i].restarts = 0;
+    slots[i].search.reset(new MovementAlgo());
+    slots[i].search->openlist.SetDebugColors(false);
+  }
+  firstSlot = 0;
+}
+
+size_t AStar::SearchScheduler::GetActiveCount() const
+{
+  size_t active = waiting.size();
+  for (size_t i = 0; i < slots.size(); ++i)
+  {
+    if (slots[i].job.ticket != NO_TICKET)
+      ++active;
+  }
+  return active;
+}
+
+const SchedulerStats& AStar::SearchScheduler::GetStats() const
+{
+  return stats;
+}
+
+void AStar::SearchScheduler::ResetStats()
+{
+  stats = SchedulerStats();
+}
+
+void AStar::SearchScheduler::Start(Slot& slot)
+{
+  Terrain& terrain = g_terrain;
+  MovementAlgo& search = *slot.search;
+  const PathRequest& request = slot.job.request;
+
+  slot.path.clear();
+  slot.wallVersion = terrain.GetMap()->GetWallVersion();
+
+  //the cluster graph answers in one go, there is nothing to slice
+  if (request.algorithm == HierarchicalSearch)
+  {
+    g_cluster_graph.Update(*terrain.GetMap());
+    g_cluster_graph.PathFind(request.start, request.goal, slot.path);
+    Finish(slot);
+    return;
+  }
+
+  if (search.bounds != terrain.GetWidth())
+    search.SetBounds(terrain.GetWidth());
+
+  search.openlist.clear();
+  search.start = request.start;
+  search.goal = request.goal;
+  search.heur = request.heur;
+  search.h_weight = request.weight;
+  search.algorithm = request.algorithm;
+  search.isSingleStep = false;
+  search.openlist.push(search.start, NO_PARENT, search.GetHCost(search.start, search.goal) * search.h_weight, 0.f);
+}
+
+void AStar::SearchScheduler::Finish(Slot& slot)
+{
+  unsigned latency = frame - slot.job.submitFrame;
+  ++stats.completed;
+  stats.totalLatency += latency;
+  stats.maxLatency = (std::max)(stats.maxLatency, latency);
+
+  results[slot.job.ticket].swap(slot.path);
+  slot.path.clear();
+  slot.job.ticket = NO_TICKET;
+}
+
+bool AStar::SearchScheduler::WallsChangedUnder(Slot& slot, unsigned wallVersion)
+{
+  if (slot.wallVersion == wallVersion)
+    return false;
+
+  //jump point searches read tiles they never push, and without the edit log there is no telling what changed
+  std::vector<int> tiles;
+  Map& map = *g_terrain.GetMap();
+  if (slot.job.request.algorithm != AStarSearch || !map.GetWallChanges(slot.wallVersion, tiles))
+    return true;
+
+  //edits the search has not reached yet, or next to, cannot change what it has done so far
+  MovementAlgo& search = *slot.search;
+  for (size_t i = 0; i < tiles.size(); ++i)
+  {
+    Point tile = search.openlist.PointOf(tiles[i]);
+    for (int r = -1; r <= 1; ++r)
+    {
+      for (int c = -1; c <= 1; ++c)
+      {
+        Point pos(tile.r + r, tile.c + c);
+        if (search.InBounds(pos) && search.openlist.WasVisited(search.openlist.IndexOf(pos)))
+          return true;
+      }
+    }
+  }
+
+  slot.wallVersion = wallVersion;
+  return false;
+}
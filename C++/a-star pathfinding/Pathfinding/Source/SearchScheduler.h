@@ -0,0 +1,78 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "PathRequestQueue.h"
+
+namespace AStar
+{
+  //searches running at once, each keeps a node pool the size of the map
+  const unsigned SEARCH_SLOTS = 8;
+
+  //after this many restarts a search runs to the end in one go so steady wall edits cannot starve it
+  const unsigned MAX_SEARCH_RESTARTS = 4;
+
+  struct SchedulerStats
+  {
+    SchedulerStats();
+    unsigned frames;            //updates that had work to do
+    unsigned spikes;            //of those, frames that took more than twice the budget
+    double totalFrameTime;      //ms
+    double maxFrameTime;        //ms
+    unsigned completed;
+    unsigned restarted;         //searches started over because the walls changed under them
+    unsigned expansions;
+    unsigned totalLatency;      //frames from submit to result, summed over completed searches
+    unsigned maxLatency;
+  };
+
+  //time-sliced searches: every Update hands out slices of a few expansions round robin until the frame budget is spent,
+  //unfinished searches keep their open list and carry on next frame
+  class SearchScheduler
+  {
+  public:
+    SearchScheduler();
+    PathTicket Submit(const PathRequest& request);
+    bool Collect(PathTicket ticket, WaypointList& path);
+    void Cancel(PathTicket ticket);
+    void Update();
+    void SetFrameBudget(double microseconds, unsigned sliceExpansions);
+    void SetSlotCount(unsigned count);
+    size_t GetActiveCount() const;
+    const SchedulerStats& GetStats() const;
+    void ResetStats();
+
+  private:
+    struct Job
+    {
+      PathTicket ticket;
+      PathRequest request;
+      unsigned submitFrame;
+    };
+
+    struct Slot
+    {
+      Job job;
+      unsigned wallVersion;     //walls the search started on
+      unsigned restarts;
+      std::unique_ptr<MovementAlgo> search;
+      WaypointList path;
+    };
+
+    void Start(Slot& slot);
+    void Finish(Slot& slot);
+    bool WallsChangedUnder(Slot& slot, unsigned wallVersion);
+
+    PathTicket nextTicket;
+    std::deque<Job> waiting;
+    std::vector<Slot> slots;                              //free while the ticket is NO_TICKET
+    std::unordered_map<PathTicket, WaypointList> results;
+
+    double frameBudget;       //microseconds, zero runs every search to the end
+    unsigned sliceExpansions;
+    size_t firstSlot;         //rotates so no slot always goes last
+    unsigned frame;
+    SchedulerStats stats;
+  };
+};
@@ -0,0 +1,198 @@
+#include <Stdafx.h>
+#include <algorithm>
+
+SpatialHash::SpatialHash( void )
+: m_cells( SPATIAL_HASH_CELLS * SPATIAL_HASH_CELLS ),
+  m_size( 0 )
+{
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         Update
+
+  Description:  Puts an object with a body in the cell of its current
+				position. Objects that did not leave their cell cost a lookup.
+
+  Arguments:    object : the game object
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void SpatialHash::Update( GameObject& object )
+{
+	unsigned int slot = object.GetID() & OBJECT_INDEX_MASK;
+	if( slot >= m_entries.size() )
+	{
+		Entry empty = { -1, 0 };
+		m_entries.resize( slot + 1, empty );
+	}
+
+	D3DXVECTOR3& pos = object.GetBody().GetPos();
+	int cell = GetCellCoordinate( pos.z ) * SPATIAL_HASH_CELLS + GetCellCoordinate( pos.x );
+
+	Entry& entry = m_entries[slot];
+	if( entry.m_cell == cell ) {
+		return;
+	}
+
+	if( entry.m_cell >= 0 ) {
+		Unlink( slot );
+	}
+	else {
+		++m_size;
+	}
+
+	CellEntry cellEntry = { &object, object.GetType(), slot };
+	entry.m_cell = cell;
+	entry.m_position = static_cast<unsigned int>( m_cells[cell].size() );
+	m_cells[cell].push_back( cellEntry );
+}
+
+void SpatialHash::Remove( GameObject& object )
+{
+	unsigned int slot = object.GetID() & OBJECT_INDEX_MASK;
+	if( slot < m_entries.size() && m_entries[slot].m_cell >= 0 )
+	{
+		Unlink( slot );
+		m_entries[slot].m_cell = -1;
+		--m_size;
+	}
+}
+
+void SpatialHash::Clear( void )
+{
+	for( std::vector<Cell>::iterator i = m_cells.begin(); i != m_cells.end(); ++i )
+	{
+		i->clear();
+	}
+	m_entries.clear();
+	m_size = 0;
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         QueryRadius
+
+  Description:  Finds the objects of a type within a radius, looking only at
+				the cells the circle overlaps.
+
+  Arguments:    pos     : the center
+				radius  : the radius
+				type    : the type of object, or OBJECT_Ignore_Type for all
+				results : the list the objects are appended to, in no order
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void SpatialHash::QueryRadius( const D3DXVECTOR3& pos, float radius, unsigned int type, std::vector<GameObject*>& results )
+{
+	int rowMin = GetCellCoordinate( pos.z - radius );
+	int rowMax = GetCellCoordinate( pos.z + radius );
+	int colMin = GetCellCoordinate( pos.x - radius );
+	int colMax = GetCellCoordinate( pos.x + radius );
+	float radiusSquared = radius * radius;
+
+	for( int row = rowMin; row <= rowMax; ++row )
+	{
+		for( int col = colMin; col <= colMax; ++col )
+		{
+			Cell& cell = m_cells[row * SPATIAL_HASH_CELLS + col];
+			for( Cell::iterator i = cell.begin(); i != cell.end(); ++i )
+			{
+				float distSquared;
+				if( IsMatch( *i, pos, radiusSquared, type, distSquared ) ) {
+					results.push_back( i->m_object );
+				}
+			}
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         FindNearest
+
+  Description:  Finds the closest object of a type within a radius, searching
+				rings of cells outward from pos until no closer object can be
+				in the next ring.
+
+  Arguments:    pos    : the center
+				radius : the radius
+				type   : the type of object, or OBJECT_Ignore_Type for all
+				ignore : an object to skip, usually the one asking
+
+  Returns:      The closest object, or 0 if there is none in the radius.
+ *---------------------------------------------------------------------------*/
+GameObject* SpatialHash::FindNearest( const D3DXVECTOR3& pos, float radius, unsigned int type, GameObject* ignore )
+{
+	const float cellSize = 1.0f / SPATIAL_HASH_CELLS;
+	int centerRow = GetCellCoordinate( pos.z );
+	int centerCol = GetCellCoordinate( pos.x );
+	int maxRing = (std::min)( static_cast<int>( radius / cellSize ) + 1, SPATIAL_HASH_CELLS );
+
+	GameObject* nearest = 0;
+	float bestSquared = radius * radius;
+
+	for( int ring = 0; ring <= maxRing; ++ring )
+	{
+		//Anything in this ring is at least ring - 1 whole cells away
+		float gap = (ring - 1) * cellSize;
+		if( ring > 1 && gap * gap > bestSquared ) {
+			break;
+		}
+
+		for( int row = centerRow - ring; row <= centerRow + ring; ++row )
+		{
+			if( row < 0 || row >= SPATIAL_HASH_CELLS ) {
+				continue;
+			}
+
+			//Only the ring's border, the inside was searched already
+			bool edgeRow = ( row == centerRow - ring || row == centerRow + ring );
+			int step = edgeRow ? 1 : 2 * ring;
+			for( int col = centerCol - ring; col <= centerCol + ring; col += step )
+			{
+				if( col < 0 || col >= SPATIAL_HASH_CELLS ) {
+					continue;
+				}
+
+				Cell& cell = m_cells[row * SPATIAL_HASH_CELLS + col];
+				for( Cell::iterator i = cell.begin(); i != cell.end(); ++i )
+				{
+					float distSquared;
+					if( i->m_object != ignore && IsMatch( *i, pos, bestSquared, type, distSquared ) )
+					{
+						nearest = i->m_object;
+						bestSquared = distSquared;
+					}
+				}
+			}
+		}
+	}
+
+	return( nearest );
+}
+
+int SpatialHash::GetCellCoordinate( float coordinate )
+{
+	int cell = static_cast<int>( floorf( coordinate * SPATIAL_HASH_CELLS ) );
+	return( (std::max)( 0, (std::min)( cell, SPATIAL_HASH_CELLS - 1 ) ) );
+}
+
+void SpatialHash::Unlink( unsigned int slot )
+{
+	//Swap with the last entry of the cell so removal does not shift the others
+	Entry& entry = m_entries[slot];
+	Cell& cell = m_cells[entry.m_cell];
+
+	cell[entry.m_position] = cell.back();
+	m_entries[cell[entry.m_position].m_slot].m_position = entry.m_position;
+	cell.pop_back();
+}
+
+bool SpatialHash::IsMatch( const CellEntry& entry, const D3DXVECTOR3& pos, float radiusSquared, unsigned int type, float& distSquared )
+{
+	if( type != OBJECT_Ignore_Type && ( entry.m_type & type ) == 0 ) {
+		return( false );
+	}
+
+	D3DXVECTOR3 diff = entry.m_object->GetBody().GetPos() - pos;
+	distSquared = D3DXVec3Dot( &diff, &diff );
+	return( distSquared <= radiusSquared );
+}
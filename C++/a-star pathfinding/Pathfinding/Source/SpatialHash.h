@@ -0,0 +1,50 @@
+#pragma once
+
+class GameObject;
+
+// Cells per side of the grid laid over the unit square the terrain covers
+#define SPATIAL_HASH_CELLS 32
+
+// Uniform grid of game objects with a body, bucketed by x and z. Positions
+// outside the terrain are clamped into the border cells, so nothing is lost,
+// and queries test the exact distance to the body's current position.
+class SpatialHash
+{
+public:
+	SpatialHash( void );
+
+	void Update( GameObject& object );		//Insert, or move to the cell of its current position
+	void Remove( GameObject& object );
+	void Clear( void );
+
+	// Appends objects of the type (OBJECT_Ignore_Type for any) within radius of pos
+	void QueryRadius( const D3DXVECTOR3& pos, float radius, unsigned int type, std::vector<GameObject*>& results );
+	GameObject* FindNearest( const D3DXVECTOR3& pos, float radius, unsigned int type, GameObject* ignore = 0 );
+
+	inline unsigned int GetSize( void )			{ return( m_size ); }
+
+private:
+
+	struct CellEntry
+	{
+		GameObject* m_object;
+		unsigned int m_type;
+		unsigned int m_slot;		//Index of the object in m_entries
+	};
+
+	struct Entry
+	{
+		int m_cell;					//-1 while not in the grid
+		unsigned int m_position;	//Index in the cell
+	};
+
+	typedef std::vector<CellEntry> Cell;
+
+	int GetCellCoordinate( float coordinate );
+	void Unlink( unsigned int slot );
+	bool IsMatch( const CellEntry& entry, const D3DXVECTOR3& pos, float radiusSquared, unsigned int type, float& distSquared );
+
+	std::vector<Cell> m_cells;
+	std::vector<Entry> m_entries;	//Indexed by the slot bits of the objectID
+	unsigned int m_size;
+};
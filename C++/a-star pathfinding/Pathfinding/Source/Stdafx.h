@@ -41,7 +41,11 @@
 // Game Engine
 #include <Blackboard.h>
 #include <database.h>
+#include <VisibilitySet.h>
+#include <MappedFile.h>
 #include <Map.h>
+#include <WallDistance.h>
+#include <FieldOfView.h>
 #include <terrain.h>
 #include <Clock.h>
 #include <triggersystem.h>
@@ -50,17 +54,21 @@
 // Game Object
 #include <body.h>
 #include <gameobject.h>
+#include <WaypointList.h>
 #include <movement.h>			// project 1 only
 
 // State Machine Language
 #include <debuglog.h>
 #include <msg.h>
+#include <TimingWheel.h>
 #include <msgroute.h>
 #include <statemch.h>
 
 // Unit test state machines
 #include <agent.h>
 #include <Enemy.h>
+#include <BenchmarkAgent.h>
+#include <BenchmarkDispatch.h>
 //#include <UnitTests/unittest1.h>
 //#include <UnitTests/unittest2a.h>
 //#include <UnitTests/unittest2b.h>
@@ -0,0 +1,455 @@
+#include <Stdafx.h>
+#include <algorithm>
+#include <functional>
+
+#define TIMER_NO_NODE 0xFFFFFFFF
+#define TIMER_SLOT_READY -1
+#define TIMER_SLOT_FREE -2
+
+TimingWheel::TimingWheel( void )
+: m_slots( TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS, TIMER_NO_NODE ),
+  m_tick( 0 ),
+  m_sequence( 0 ),
+  m_size( 0 ),
+  m_wheelSize( 0 ),
+  m_allocations( 0 )
+{
+	std::fill( m_levelSize, m_levelSize + TIMING_WHEEL_LEVELS, 0 );
+	m_nodes.reserve( TIMING_WHEEL_POOL_SIZE );
+	m_freeNodes.reserve( TIMING_WHEEL_POOL_SIZE );
+	m_ready.reserve( TIMING_WHEEL_POOL_SIZE );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         Schedule
+
+  Description:  Stores a copy of the message until its delivery time.
+
+  Arguments:    msg : the message, with its delivery time set
+
+  Returns:      A handle to cancel the message with.
+ *---------------------------------------------------------------------------*/
+TimerHandle TimingWheel::Schedule( MSG_Object & msg )
+{
+	unsigned int index;
+	if( !m_freeNodes.empty() )
+	{
+		index = m_freeNodes.back();
+		m_freeNodes.pop_back();
+	}
+	else
+	{
+		ASSERTMSG( m_nodes.size() <= TIMER_INDEX_MASK, "TimingWheel::Schedule - Out of timer nodes." );
+		if( m_nodes.size() == m_nodes.capacity() ) {
+			++m_allocations;
+		}
+		Node empty;
+		empty.m_generation = 1;
+		empty.m_slot = TIMER_SLOT_FREE;
+		index = static_cast<unsigned int>( m_nodes.size() );
+		m_nodes.push_back( empty );
+	}
+
+	Node& node = m_nodes[index];
+	node.m_msg = msg;
+	node.m_tick = GetTick( msg.GetDeliveryTime() );
+	node.m_sequence = m_sequence++;
+
+	//Link at the head of the receiver slot's list
+	unsigned int slot = msg.GetReceiver() & OBJECT_INDEX_MASK;
+	if( slot >= m_receivers.size() )
+	{
+		if( slot >= m_receivers.capacity() ) {
+			++m_allocations;
+		}
+		m_receivers.resize( slot + 1, TIMER_NO_NODE );
+	}
+	node.m_prevReceiver = TIMER_NO_NODE;
+	node.m_nextReceiver = m_receivers[slot];
+	if( node.m_nextReceiver != TIMER_NO_NODE ) {
+		m_nodes[node.m_nextReceiver].m_prevReceiver = index;
+	}
+	m_receivers[slot] = index;
+
+	++m_size;
+	Place( index );
+	return( GetHandle( index ) );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         Cancel
+
+  Description:  Drops a scheduled message before it is delivered.
+
+  Arguments:    handle : the handle from Schedule
+
+  Returns:      False if the message was already delivered or cancelled.
+ *---------------------------------------------------------------------------*/
+bool TimingWheel::Cancel( TimerHandle handle )
+{
+	Node* node = GetNode( handle );
+	if( node == 0 ) {
+		return( false );
+	}
+
+	unsigned int index = handle & TIMER_INDEX_MASK;
+	if( node->m_slot >= 0 ) {
+		UnlinkSlot( index );
+	}
+	//A ready message leaves a stale heap entry behind, skipped when it comes up
+
+	UnlinkReceiver( index );
+	Free( index );
+	return( true );
+}
+
+void TimingWheel::Clear( void )
+{
+	//Nodes stay in the pool, with new generations so old handles stop working
+	m_freeNodes.clear();
+	for( unsigned int i = 0; i < m_nodes.size(); ++i )
+	{
+		if( m_nodes[i].m_slot != TIMER_SLOT_FREE ) {
+			Free( i );
+		}
+		else {
+			m_freeNodes.push_back( i );
+		}
+	}
+
+	std::fill( m_slots.begin(), m_slots.end(), TIMER_NO_NODE );
+	std::fill( m_receivers.begin(), m_receivers.end(), TIMER_NO_NODE );
+	m_ready.clear();
+	m_wheelSize = 0;
+	std::fill( m_levelSize, m_levelSize + TIMING_WHEEL_LEVELS, 0 );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         PopDue
+
+  Description:  Turns the wheel up to now and hands over the earliest message
+				whose delivery time has come.
+
+  Arguments:    now : the current time
+				msg : receives the message
+
+  Returns:      False if no message is due.
+ *---------------------------------------------------------------------------*/
+bool TimingWheel::PopDue( float now, MSG_Object & msg )
+{
+	Advance( GetTick( now ) );
+
+	while( !m_ready.empty() )
+	{
+		ReadyEntry entry = m_ready.front();
+		Node* node = GetNode( entry.m_handle );
+		if( node != 0 && entry.m_time > now ) {
+			return( false );
+		}
+
+		std::pop_heap( m_ready.begin(), m_ready.end(), std::greater<ReadyEntry>() );
+		m_ready.pop_back();
+
+		if( node != 0 )
+		{
+			unsigned int index = entry.m_handle & TIMER_INDEX_MASK;
+			msg = node->m_msg;
+			UnlinkReceiver( index );
+			Free( index );
+			return( true );
+		}
+	}
+
+	return( false );
+}
+
+TimerHandle TimingWheel::GetFirst( objectID receiver )
+{
+	unsigned int slot = receiver & OBJECT_INDEX_MASK;
+	if( slot >= m_receivers.size() ) {
+		return( INVALID_TIMER_HANDLE );
+	}
+
+	unsigned int index = FindReceiver( m_receivers[slot], receiver );
+	if( index == TIMER_NO_NODE ) {
+		return( INVALID_TIMER_HANDLE );
+	}
+	return( GetHandle( index ) );
+}
+
+TimerHandle TimingWheel::GetNext( TimerHandle handle )
+{
+	Node* node = GetNode( handle );
+	if( node == 0 ) {
+		return( INVALID_TIMER_HANDLE );
+	}
+
+	unsigned int index = FindReceiver( node->m_nextReceiver, node->m_msg.GetReceiver() );
+	if( index == TIMER_NO_NODE ) {
+		return( INVALID_TIMER_HANDLE );
+	}
+	return( GetHandle( index ) );
+}
+
+MSG_Object* TimingWheel::Get( TimerHandle handle )
+{
+	Node* node = GetNode( handle );
+	if( node == 0 ) {
+		return( 0 );
+	}
+	return( &node->m_msg );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         VerifyOrder
+
+  Description:  Verifies that every message will come out at its delivery
+				time: ready messages form a heap on delivery time, and each
+				message in the wheel is in a slot that comes up after the
+				current tick and no later than its own.
+
+  Arguments:    None.
+
+  Returns:      True if the messages are in order.
+ *---------------------------------------------------------------------------*/
+bool TimingWheel::VerifyOrder( void )
+{
+	if( !std::is_heap( m_ready.begin(), m_ready.end(), std::greater<ReadyEntry>() ) ) {
+		return( false );
+	}
+
+	for( std::vector<ReadyEntry>::iterator i = m_ready.begin(); i != m_ready.end(); ++i )
+	{
+		Node* node = GetNode( i->m_handle );
+		if( node != 0 && node->m_tick > m_tick ) {
+			return( false );
+		}
+	}
+
+	unsigned int count = 0;
+	for( int level = 0; level < TIMING_WHEEL_LEVELS; ++level )
+	{
+		int shift = level * TIMING_WHEEL_SLOT_BITS;
+		for( int slot = 0; slot < TIMING_WHEEL_SLOTS; ++slot )
+		{
+			//The block this slot comes up for next, its current block has already been cascaded
+			unsigned long long block = m_tick >> shift;
+			block += (slot - static_cast<int>( block & (TIMING_WHEEL_SLOTS - 1) ) + TIMING_WHEEL_SLOTS) & (TIMING_WHEEL_SLOTS - 1);
+			if( level > 0 && block == m_tick >> shift ) {
+				block += TIMING_WHEEL_SLOTS;
+			}
+			unsigned long long reached = block << shift;
+
+			for( unsigned int index = m_slots[level * TIMING_WHEEL_SLOTS + slot]; index != TIMER_NO_NODE; index = m_nodes[index].m_next )
+			{
+				if( reached <= m_tick || reached > m_nodes[index].m_tick ) {
+					return( false );
+				}
+				++count;
+			}
+		}
+	}
+
+	return( count == m_wheelSize );
+}
+
+TimingWheel::Node* TimingWheel::GetNode( TimerHandle handle )
+{
+	unsigned int index = handle & TIMER_INDEX_MASK;
+	if( index >= m_nodes.size() || m_nodes[index].m_slot == TIMER_SLOT_FREE || m_nodes[index].m_generation != handle >> TIMER_INDEX_BITS ) {
+		return( 0 );
+	}
+	return( &m_nodes[index] );
+}
+
+TimerHandle TimingWheel::GetHandle( unsigned int index )
+{
+	return( (m_nodes[index].m_generation << TIMER_INDEX_BITS) | index );
+}
+
+unsigned int TimingWheel::FindReceiver( unsigned int index, objectID receiver )
+{
+	//A slot's list also holds messages for earlier objects that used the slot
+	while( index != TIMER_NO_NODE && m_nodes[index].m_msg.GetReceiver() != receiver ) {
+		index = m_nodes[index].m_nextReceiver;
+	}
+	return( index );
+}
+
+unsigned long long TimingWheel::GetTick( float time )
+{
+	if( time <= 0.0f ) {
+		return( 0 );
+	}
+	return( static_cast<unsigned long long>( time * TIMING_WHEEL_TICKS_PER_SECOND ) );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         Advance
+
+  Description:  Turns the wheel up to the given tick, cascading the higher
+				levels as their blocks come up and moving each level 0 slot
+				reached into the ready heap. Stretches where the lower levels
+				are empty are skipped to the next block boundary.
+
+  Arguments:    tick : the tick to turn to
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void TimingWheel::Advance( unsigned long long tick )
+{
+	if( m_wheelSize == 0 )
+	{	//Nothing to reach, jump straight there
+		m_tick = (std::max)( m_tick, tick );
+		return;
+	}
+
+	while( m_tick < tick && m_wheelSize > 0 )
+	{
+		int lowest = 0;
+		while( m_levelSize[lowest] == 0 ) {
+			++lowest;
+		}
+
+		if( lowest > 0 )
+		{	//Nothing can come out before the next block of the lowest busy level
+			int shift = lowest * TIMING_WHEEL_SLOT_BITS;
+			unsigned long long boundary = ((m_tick >> shift) + 1) << shift;
+			if( boundary > tick ) {
+				break;
+			}
+			m_tick = boundary - 1;
+		}
+
+		++m_tick;
+
+		for( int level = TIMING_WHEEL_LEVELS - 1; level > 0; --level )
+		{
+			int shift = level * TIMING_WHEEL_SLOT_BITS;
+			if( ( m_tick & ((1ull << shift) - 1) ) == 0 ) {
+				Cascade( level, static_cast<int>( (m_tick >> shift) & (TIMING_WHEEL_SLOTS - 1) ) );
+			}
+		}
+
+		Cascade( 0, static_cast<int>( m_tick & (TIMING_WHEEL_SLOTS - 1) ) );
+	}
+
+	m_tick = (std::max)( m_tick, tick );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         Place
+
+  Description:  Puts a message in the ready heap if its tick has passed, or
+				else in the lowest level whose span reaches it.
+
+  Arguments:    index : the node
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void TimingWheel::Place( unsigned int index )
+{
+	Node& node = m_nodes[index];
+	if( node.m_tick <= m_tick )
+	{
+		ReadyEntry entry = { node.m_msg.GetDeliveryTime(), node.m_sequence, GetHandle( index ) };
+		node.m_slot = TIMER_SLOT_READY;
+		if( m_ready.size() == m_ready.capacity() ) {
+			++m_allocations;
+		}
+		m_ready.push_back( entry );
+		std::push_heap( m_ready.begin(), m_ready.end(), std::greater<ReadyEntry>() );
+		return;
+	}
+
+	unsigned long long distance = node.m_tick - m_tick;
+	unsigned long long tick = node.m_tick;
+	int level = 0;
+	while( level < TIMING_WHEEL_LEVELS - 1 && distance >= (1ull << ((level + 1) * TIMING_WHEEL_SLOT_BITS)) ) {
+		++level;
+	}
+
+	const unsigned long long span = 1ull << (TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOT_BITS);
+	if( distance >= span )
+	{	//Past the end of the wheel, wait in its last slot
+		tick = m_tick + span - 1;
+	}
+
+	int shift = level * TIMING_WHEEL_SLOT_BITS;
+	LinkSlot( index, level * TIMING_WHEEL_SLOTS + static_cast<int>( (tick >> shift) & (TIMING_WHEEL_SLOTS - 1) ) );
+}
+
+void TimingWheel::Cascade( int level, int slot )
+{
+	int wheelSlot = level * TIMING_WHEEL_SLOTS + slot;
+	unsigned int index = m_slots[wheelSlot];
+	m_slots[wheelSlot] = TIMER_NO_NODE;
+
+	while( index != TIMER_NO_NODE )
+	{
+		unsigned int next = m_nodes[index].m_next;
+		--m_wheelSize;
+		--m_levelSize[level];
+		Place( index );
+		index = next;
+	}
+}
+
+void TimingWheel::LinkSlot( unsigned int index, int slot )
+{
+	Node& node = m_nodes[index];
+	node.m_slot = slot;
+	node.m_prev = TIMER_NO_NODE;
+	node.m_next = m_slots[slot];
+	if( node.m_next != TIMER_NO_NODE ) {
+		m_nodes[node.m_next].m_prev = index;
+	}
+	m_slots[slot] = index;
+	++m_wheelSize;
+	++m_levelSize[slot / TIMING_WHEEL_SLOTS];
+}
+
+void TimingWheel::UnlinkSlot( unsigned int index )
+{
+	Node& node = m_nodes[index];
+	if( node.m_prev != TIMER_NO_NODE ) {
+		m_nodes[node.m_prev].m_next = node.m_next;
+	}
+	else {
+		m_slots[node.m_slot] = node.m_next;
+	}
+	if( node.m_next != TIMER_NO_NODE ) {
+		m_nodes[node.m_next].m_prev = node.m_prev;
+	}
+	--m_wheelSize;
+	--m_levelSize[node.m_slot / TIMING_WHEEL_SLOTS];
+}
+
+void TimingWheel::UnlinkReceiver( unsigned int index )
+{
+	Node& node = m_nodes[index];
+	if( node.m_prevReceiver != TIMER_NO_NODE ) {
+		m_nodes[node.m_prevReceiver].m_nextReceiver = node.m_nextReceiver;
+	}
+	else {
+		m_receivers[node.m_msg.GetReceiver() & OBJECT_INDEX_MASK] = node.m_nextReceiver;
+	}
+	if( node.m_nextReceiver != TIMER_NO_NODE ) {
+		m_nodes[node.m_nextReceiver].m_prevReceiver = node.m_prevReceiver;
+	}
+}
+
+void TimingWheel::Free( unsigned int index )
+{
+	Node& node = m_nodes[index];
+	node.m_slot = TIMER_SLOT_FREE;
+	node.m_generation = (node.m_generation + 1) & TIMER_GENERATION_MASK;
+	if( node.m_generation == 0 ) {
+		node.m_generation = 1;
+	}
+	if( m_freeNodes.size() == m_freeNodes.capacity() ) {
+		++m_allocations;
+	}
+	m_freeNodes.push_back( index );
+	--m_size;
+}
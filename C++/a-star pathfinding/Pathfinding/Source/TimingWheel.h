@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+
+// Handle to a scheduled message, (generation << TIMER_INDEX_BITS) | node index
+typedef unsigned int TimerHandle;
+#define INVALID_TIMER_HANDLE 0
+
+#define TIMER_INDEX_BITS 20
+#define TIMER_INDEX_MASK ((1u << TIMER_INDEX_BITS) - 1)
+#define TIMER_GENERATION_MASK ((1u << (32 - TIMER_INDEX_BITS)) - 1)
+
+// Wheel layout: 4 levels of 256 slots with 1 ms ticks, the clock's resolution.
+// Level 0 covers the next 256 ms, level 3 about 49 days; anything later
+// waits in the last slot of level 3 and is placed again when it comes round.
+#define TIMING_WHEEL_LEVELS 4
+#define TIMING_WHEEL_SLOT_BITS 8
+#define TIMING_WHEEL_SLOTS (1 << TIMING_WHEEL_SLOT_BITS)
+#define TIMING_WHEEL_TICKS_PER_SECOND 1000.0f
+
+// Messages the pool holds before it has to grow
+#define TIMING_WHEEL_POOL_SIZE 8192
+
+// Delayed messages in a hierarchical timing wheel. Messages live in a pool
+// of nodes reserved up front and reused through a free list, so scheduling
+// does not allocate until the pool has to grow. Scheduling and cancelling
+// through a handle are O(1), and the messages for each receiver slot are
+// linked together so removals only look at them. Due messages come out
+// ordered by delivery time, then by scheduling order.
+class TimingWheel
+{
+public:
+
+	TimingWheel( void );
+	~TimingWheel( void ) {}
+
+	TimerHandle Schedule( MSG_Object & msg );
+	bool Cancel( TimerHandle handle );
+	void Clear( void );
+
+	// Copies out and removes the next message due at or before now
+	bool PopDue( float now, MSG_Object & msg );
+
+	// Walks one receiver's pending messages, safe to Cancel the current one
+	TimerHandle GetFirst( objectID receiver );
+	TimerHandle GetNext( TimerHandle handle );
+	MSG_Object* Get( TimerHandle handle );
+
+	// Checks that every message sits where it will come out on time
+	bool VerifyOrder( void );
+
+	inline unsigned int GetSize( void )			{ return( m_size ); }
+
+	// Heap allocations made growing the pool and lists, flat in a steady state
+	inline unsigned int GetAllocationCount( void )	{ return( m_allocations ); }
+
+private:
+
+	struct Node
+	{
+		MSG_Object m_msg;
+		unsigned long long m_tick;
+		unsigned int m_sequence;		//Breaks ties between equal delivery times
+		unsigned int m_generation;
+		int m_slot;						//Level * TIMING_WHEEL_SLOTS + slot, or TIMER_SLOT_READY / TIMER_SLOT_FREE
+		unsigned int m_prev, m_next;	//Slot list
+		unsigned int m_prevReceiver, m_nextReceiver;
+	};
+
+	struct ReadyEntry
+	{
+		float m_time;
+		unsigned int m_sequence;
+		TimerHandle m_handle;			//Stale once the message is cancelled
+
+		bool operator>( const ReadyEntry & rhs ) const
+		{
+			if( m_time != rhs.m_time ) {
+				return( m_time > rhs.m_time );
+			}
+			return( m_sequence > rhs.m_sequence );
+		}
+	};
+
+	Node* GetNode( TimerHandle handle );
+	TimerHandle GetHandle( unsigned int index );
+	unsigned int FindReceiver( unsigned int index, objectID receiver );
+	unsigned long long GetTick( float time );
+
+	void Advance( unsigned long long tick );
+	void Place( unsigned int index );
+	void Cascade( int level, int slot );
+	void LinkSlot( unsigned int index, int slot );
+	void UnlinkSlot( unsigned int index );
+	void UnlinkReceiver( unsigned int index );
+	void Free( unsigned int index );
+
+	std::vector<Node> m_nodes;
+	std::vector<unsigned int> m_freeNodes;
+	std::vector<unsigned int> m_slots;			//Head node of each slot, all levels
+	std::vector<ReadyEntry> m_ready;			//Min-heap of messages whose tick has passed
+	std::vector<unsigned int> m_receivers;		//Head node of each receiver slot's list, by object index
+
+	unsigned long long m_tick;					//Last tick moved into m_ready
+	unsigned int m_sequence;
+	unsigned int m_size;
+	unsigned int m_wheelSize;					//Messages still in slots
+	unsigned int m_levelSize[TIMING_WHEEL_LEVELS];
+	unsigned int m_allocations;
+};
@@ -0,0 +1,207 @@
+#include <Stdafx.h>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline int CountBits(unsigned int bits)
+{
+#ifdef _MSC_VER
+	return static_cast<int>(__popcnt(bits));
+#else
+	return __builtin_popcount(bits);
+#endif
+}
+
+// Whether the line between the centers of tiles a and b can pass over tile t:
+// t lies within their bounding box and the line comes within half a tile of
+// its center along both axes combined. Candidates are retested with the walk.
+static bool MayCross(int ra, int ca, int rb, int cb, int rt, int ct)
+{
+	if (rt < (std::min)(ra, rb) || rt > (std::max)(ra, rb))
+		return false;
+	if (ct < (std::min)(ca, cb) || ct > (std::max)(ca, cb))
+		return false;
+
+	int dr = rb - ra;
+	int dc = cb - ca;
+	int cross = dr * (ct - ca) - dc * (rt - ra);
+	return 2 * abs(cross) <= abs(dr) + abs(dc);
+}
+
+VisibilitySet::VisibilitySet(void)
+	: m_map(0),
+	m_width(0),
+	m_tiles(0),
+	m_words(0),
+	m_version(0),
+	m_patchedVersion(0)
+{
+}
+
+bool VisibilitySet::Build(Map& map)
+{
+	int width = map.GetWidth();
+	if (width * width > VISIBILITY_MAX_TILES)
+	{
+		Clear();
+		return false;
+	}
+
+	m_map = &map;
+	m_width = width;
+	m_tiles = width * width;
+	m_words = (m_tiles + 31) / 32;
+	m_version = map.GetWallVersion();
+	m_bits.assign(m_tiles * m_words, 0);
+	m_patchedVersion = m_version;
+	m_patchedTiles.clear();
+
+	// every pair is walked once, from the lower tile, then copied across a
+	// block of 32 rows at a time
+	JobPool::GetAnalysisPool().Run(m_tiles, [this](unsigned, unsigned tile) { BuildUpperRow(tile); });
+	JobPool::GetAnalysisPool().Run(m_words, [this](unsigned, unsigned block) { MirrorLowerBlock(block); }, 1);
+	return true;
+}
+
+bool VisibilitySet::Update(Map& map)
+{
+	std::vector<int> tiles;
+	if (&map != m_map || map.GetWidth() != m_width || !map.GetWallChanges(m_version, tiles) || tiles.size() > VISIBILITY_MAX_PATCH_TILES)
+		return Build(map);
+
+	m_patchedVersion = m_version;
+	m_version = map.GetWallVersion();
+	m_patchedTiles.clear();
+	if (tiles.empty())
+		return true;
+
+	std::vector<char> patched(m_tiles, 0);
+	JobPool::GetAnalysisPool().Run(m_tiles, [this, &tiles, &patched](unsigned, unsigned tile) { patched[tile] = PatchRow(tile, tiles); });
+
+	for (int tile = 0; tile < m_tiles; ++tile)
+		if (patched[tile])
+			m_patchedTiles.push_back(tile);
+	return true;
+}
+
+bool VisibilitySet::GetChangedTiles(unsigned version, std::vector<int>& tiles) const
+{
+	if (version == m_version)
+		return true;
+	if (version != m_patchedVersion)
+		return false;
+
+	tiles.insert(tiles.end(), m_patchedTiles.begin(), m_patchedTiles.end());
+	return true;
+}
+
+bool VisibilitySet::Load(Map& map, const unsigned int* bits)
+{
+	int width = map.GetWidth();
+	if (width * width > VISIBILITY_MAX_TILES)
+	{
+		Clear();
+		return false;
+	}
+
+	m_map = &map;
+	m_width = width;
+	m_tiles = width * width;
+	m_words = (m_tiles + 31) / 32;
+	m_version = map.GetWallVersion();
+	m_bits.assign(bits, bits + m_tiles * m_words);
+	m_patchedVersion = m_version;
+	m_patchedTiles.clear();
+	return true;
+}
+
+void VisibilitySet::Clear(void)
+{
+	m_map = 0;
+	m_width = 0;
+	m_tiles = 0;
+	m_words = 0;
+	m_version = 0;
+	std::vector<unsigned int>().swap(m_bits);
+	m_patchedVersion = 0;
+	m_patchedTiles.clear();
+}
+
+int VisibilitySet::CountVisible(int row, int col) const
+{
+	int tile = row * m_width + col;
+	const unsigned int* bits = &m_bits[tile * m_words];
+
+	int count = 0;
+	for (int i = 0; i < m_words; ++i)
+		count += CountBits(bits[i]);
+	return count;
+}
+
+void VisibilitySet::BuildUpperRow(int tile)
+{
+	int r0 = tile / m_width;
+	int c0 = tile % m_width;
+
+	for (int other = tile + 1; other < m_tiles; ++other)
+		SetBit(tile, other, m_map->IsClearPath(r0, c0, other / m_width, other % m_width));
+}
+
+// The block's rows read word block of the rows before them. An earlier
+// block only writes its rows' words up to its own, so no word is shared.
+void VisibilitySet::MirrorLowerBlock(int block)
+{
+	int last = (std::min)(block * 32 + 32, m_tiles);
+	for (int tile = block * 32; tile < last; ++tile)
+		for (int other = 0; other < tile; ++other)
+			SetBit(tile, other, ((m_bits[other * m_words + block] >> (tile & 31)) & 1) != 0);
+}
+
+// Returns whether any of the row's bits flipped
+bool VisibilitySet::PatchRow(int tile, const std::vector<int>& changed)
+{
+	int r0 = tile / m_width;
+	int c0 = tile % m_width;
+	bool flipped = false;
+
+	for (size_t i = 0; i < changed.size(); ++i)
+	{
+		// the line can only cross the changed tile on its way to tiles beyond it
+		int rt = changed[i] / m_width;
+		int ct = changed[i] % m_width;
+		int rFirst = (rt > r0) ? rt : 0;
+		int rLast = (rt < r0) ? rt : m_width - 1;
+		int cFirst = (ct > c0) ? ct : 0;
+		int cLast = (ct < c0) ? ct : m_width - 1;
+
+		for (int r1 = rFirst; r1 <= rLast; ++r1)
+		{
+			for (int c1 = cFirst; c1 <= cLast; ++c1)
+			{
+				int other = r1 * m_width + c1;
+				if (other == tile || !MayCross(r0, c0, r1, c1, rt, ct))
+					continue;
+
+				// walked from the lower tile, as Build does, so both rows agree
+				bool visible = (tile < other) ? m_map->IsClearPath(r0, c0, r1, c1) : m_map->IsClearPath(r1, c1, r0, c0);
+				flipped |= SetBit(tile, other, visible);
+			}
+		}
+	}
+	return flipped;
+}
+
+// Returns whether the bit flipped
+bool VisibilitySet::SetBit(int tile, int other, bool visible)
+{
+	unsigned int& word = m_bits[tile * m_words + (other >> 5)];
+	unsigned int mask = 1u << (other & 31);
+	unsigned int before = word;
+	if (visible)
+		word |= mask;
+	else
+		word &= ~mask;
+	return word != before;
+}
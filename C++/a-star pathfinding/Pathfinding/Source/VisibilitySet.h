@@ -0,0 +1,65 @@
+#pragma once
+
+class Map;
+
+// Largest map given a visibility set, the bits grow with the tiles squared (2 MB here)
+#define VISIBILITY_MAX_TILES 4096
+
+// Changed tiles patched in before a rebuild is cheaper
+#define VISIBILITY_MAX_PATCH_TILES 32
+
+// Which tiles see each other, one bit per pair, as Map::IsClearPath decides
+// it. Each tile's row is packed into 32-bit words so counting what a tile
+// sees is a popcount per word. Rows are built on the worker threads. A wall
+// edit can only change pairs whose line passes over the edited tile, so
+// Update retests just those.
+class VisibilitySet
+{
+public:
+	VisibilitySet(void);
+
+	// Returns false for maps over VISIBILITY_MAX_TILES, which get no set
+	bool Build(Map& map);
+
+	// Catches up with the map's wall edits, building from scratch if the log
+	// doesn't reach back far enough
+	bool Update(Map& map);
+
+	// Tiles whose row changed when the set last caught up, if it caught up
+	// from this version. False when that's unknown and every tile may have.
+	bool GetChangedTiles(unsigned version, std::vector<int>& tiles) const;
+
+	void Clear(void);
+
+	// Takes the bits of a set saved for the map's current walls
+	bool Load(Map& map, const unsigned int* bits);
+	inline const std::vector<unsigned int>& GetBits(void) const	{ return m_bits; }
+
+	inline bool IsVisible(int r0, int c0, int r1, int c1) const
+	{
+		int b = r1 * m_width + c1;
+		return ((m_bits[(r0 * m_width + c0) * m_words + (b >> 5)] >> (b & 31)) & 1) != 0;
+	}
+
+	// Tiles visible from this one, not counting itself
+	int CountVisible(int row, int col) const;
+
+	inline unsigned GetVersion(void) const		{ return m_version; }
+
+private:
+	Map* m_map;
+	int m_width;
+	int m_tiles;
+	int m_words;		// words per row
+	unsigned m_version;
+
+	std::vector<unsigned int> m_bits;
+
+	unsigned m_patchedVersion;			// version the last update started from
+	std::vector<int> m_patchedTiles;	// and the tiles whose row it changed
+
+	void BuildUpperRow(int tile);
+	void MirrorLowerBlock(int block);
+	bool PatchRow(int tile, const std::vector<int>& changed);
+	bool SetBit(int tile, int other, bool visible);
+};
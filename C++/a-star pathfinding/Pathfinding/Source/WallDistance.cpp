@@ -0,0 +1,137 @@
+#include <Stdafx.h>
+
+WallDistance::WallDistance(void)
+	: m_map(0),
+	m_width(0),
+	m_version(0)
+{
+}
+
+void WallDistance::Build(Map& map)
+{
+	m_map = &map;
+	m_width = map.GetWidth();
+	m_version = map.GetWallVersion();
+
+	m_column.assign(m_width * m_width, 0);
+	m_squared.assign(m_width * m_width, 0);
+	m_height.assign(m_width + 2, 0);
+	m_site.assign(m_width + 2, 0);
+	m_boundary.assign(m_width + 3, 0.0);
+	m_rowChanged.assign(m_width, 0);
+
+	for (int c = 0; c < m_width; ++c)
+		ComputeColumn(c);
+	for (int r = 0; r < m_width; ++r)
+		ComputeRow(r);
+}
+
+bool WallDistance::Update(Map& map, std::vector<int>& rows)
+{
+	std::vector<int> tiles;
+	if (&map != m_map || map.GetWidth() != m_width || !map.GetWallChanges(m_version, tiles))
+	{
+		Build(map);
+		return false;
+	}
+	m_version = map.GetWallVersion();
+
+	// a column only changes where its closest wall moved, so only those rows need the second pass
+	std::vector<int> previous(m_width);
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		int c = tiles[i] % m_width;
+		for (int r = 0; r < m_width; ++r)
+			previous[r] = m_column[r * m_width + c];
+
+		ComputeColumn(c);
+
+		for (int r = 0; r < m_width; ++r)
+		{
+			if (previous[r] != m_column[r * m_width + c])
+				m_rowChanged[r] = 1;
+		}
+	}
+
+	for (int r = 0; r < m_width; ++r)
+	{
+		if (m_rowChanged[r])
+		{
+			m_rowChanged[r] = 0;
+			ComputeRow(r);
+			rows.push_back(r);
+		}
+	}
+	return true;
+}
+
+void WallDistance::ComputeColumn(int col)
+{
+	Tile** terrain = m_map->GetTerrain();
+
+	// walls above, the top edge sits at row -1
+	int wall = -1;
+	for (int r = 0; r < m_width; ++r)
+	{
+		if (terrain[r][col] == TILE_WALL)
+			wall = r;
+		m_column[r * m_width + col] = r - wall;
+	}
+
+	// walls below, the bottom edge sits at row m_width
+	wall = m_width;
+	for (int r = m_width - 1; r >= 0; --r)
+	{
+		if (terrain[r][col] == TILE_WALL)
+			wall = r;
+		int &distance = m_column[r * m_width + col];
+		if (wall - r < distance)
+			distance = wall - r;
+	}
+}
+
+void WallDistance::ComputeRow(int row)
+{
+	// sites run from column -1 to column m_width, the two edges are walls
+	int sites = m_width + 2;
+	const int *column = &m_column[row * m_width];
+
+	m_height[0] = 0;
+	m_height[sites - 1] = 0;
+	for (int c = 0; c < m_width; ++c)
+		m_height[c + 1] = column[c] * column[c];
+
+	// lower envelope of the parabolas (x - q)^2 + height[q]
+	int k = 0;
+	m_site[0] = 0;
+	m_boundary[0] = -1e20;
+	m_boundary[1] = 1e20;
+	for (int q = 1; q < sites; ++q)
+	{
+		// drop the sites the new parabola is lower than, the first boundary is never passed
+		double s;
+		while (true)
+		{
+			int p = m_site[k];
+			s = ((m_height[q] + q * q) - (m_height[p] + p * p)) / (2.0 * (q - p));
+			if (s > m_boundary[k])
+				break;
+			--k;
+		}
+
+		++k;
+		m_site[k] = q;
+		m_boundary[k] = s;
+		m_boundary[k + 1] = 1e20;
+	}
+
+	int *squared = &m_squared[row * m_width];
+	k = 0;
+	for (int q = 1; q < sites - 1; ++q)
+	{
+		while (m_boundary[k + 1] < q)
+			++k;
+		int p = m_site[k];
+		squared[q - 1] = (q - p) * (q - p) + m_height[p];
+	}
+}
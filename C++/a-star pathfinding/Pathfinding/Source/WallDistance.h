@@ -0,0 +1,41 @@
+#pragma once
+
+// Exact Euclidean distance from every tile to its closest wall, counting the
+// edges of the map as walls just outside it. Built with the separable
+// Felzenszwalb-Huttenlocher transform in time linear in the tiles: first the
+// distance to the closest wall in each column, then the lower envelope of
+// one parabola per column along each row. A wall edit only changes its own
+// column, so Update redoes that column and the rows it changed.
+class WallDistance
+{
+public:
+	WallDistance(void);
+
+	void Build(Map& map);
+
+	// Catches up with the map's wall edits. Returns false when it had to
+	// build from scratch, otherwise rows lists every row that changed.
+	bool Update(Map& map, std::vector<int>& rows);
+
+	inline int GetWidth(void) const							{ return m_width; }
+	inline unsigned GetVersion(void) const					{ return m_version; }
+	inline int GetSquaredDistance(int row, int col) const	{ return m_squared[row * m_width + col]; }
+
+private:
+	Map* m_map;
+	int m_width;
+	unsigned m_version;
+
+	std::vector<int> m_column;		// distance to the closest wall in the same column
+	std::vector<int> m_squared;		// squared distance to the closest wall
+
+	// scratch for one row: parabola heights, envelope sites and boundaries
+	std::vector<int> m_height;
+	std::vector<int> m_site;
+	std::vector<double> m_boundary;
+
+	std::vector<char> m_rowChanged;
+
+	void ComputeColumn(int col);
+	void ComputeRow(int row);
+};
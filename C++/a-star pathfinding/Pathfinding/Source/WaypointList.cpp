@@ -0,0 +1,231 @@
+#include <Stdafx.h>
+#include <algorithm>
+
+std::atomic<unsigned> WaypointList::s_allocations(0);
+
+WaypointList::WaypointList(void)
+: m_data(m_local),
+  m_first(0),
+  m_size(0),
+  m_capacity(WAYPOINT_LOCAL_CAPACITY)
+{
+}
+
+WaypointList::WaypointList(const WaypointList &other)
+: m_data(m_local),
+  m_first(0),
+  m_size(0),
+  m_capacity(WAYPOINT_LOCAL_CAPACITY)
+{
+	*this = other;
+}
+
+WaypointList::WaypointList(WaypointList &&other)
+: m_data(m_local),
+  m_first(0),
+  m_size(0),
+  m_capacity(WAYPOINT_LOCAL_CAPACITY)
+{
+	swap(other);
+}
+
+WaypointList::~WaypointList(void)
+{
+	Release();
+}
+
+WaypointList &WaypointList::operator=(const WaypointList &other)
+{
+	if (this != &other)
+	{
+		clear();
+		MakeRoom(other.m_size);
+		std::copy(other.begin(), other.end(), m_data);
+		m_size = other.m_size;
+	}
+	return *this;
+}
+
+WaypointList &WaypointList::operator=(WaypointList &&other)
+{
+	if (this != &other)
+	{
+		clear();
+		swap(other);
+	}
+	return *this;
+}
+
+void WaypointList::push_back(const D3DXVECTOR3 &point)
+{
+	if (m_first + m_size == m_capacity)
+	{
+		// Copy first, the point may live in this list
+		D3DXVECTOR3 copy = point;
+		MakeRoom(m_size + 1);
+		m_data[m_first + m_size++] = copy;
+		return;
+	}
+	m_data[m_first + m_size++] = point;
+}
+
+void WaypointList::pop_front(void)
+{
+	assert(m_size > 0 && "pop_front on an empty waypoint list");
+
+	++m_first;
+	if (--m_size == 0)
+		m_first = 0;
+}
+
+WaypointList::iterator WaypointList::insert(iterator pos, const D3DXVECTOR3 &point)
+{
+	size_t index = pos - begin();
+	D3DXVECTOR3 copy = point;
+
+	if (m_first + m_size == m_capacity)
+		MakeRoom(m_size + 1);
+
+	iterator at = begin() + index;
+	std::copy_backward(at, end(), end() + 1);
+	*at = copy;
+	++m_size;
+	return at;
+}
+
+void WaypointList::insert(iterator pos, const_iterator first, const_iterator last)
+{
+	size_t index = pos - begin();
+	size_t count = last - first;
+	if (count == 0)
+		return;
+
+	// A range out of this list moves somewhere stable before the points shift
+	if (first >= m_data && first < m_data + m_capacity)
+	{
+		WaypointList copy;
+		copy.insert(copy.end(), first, last);
+		insert(begin() + index, copy.begin(), copy.end());
+		return;
+	}
+
+	if (m_first + m_size + count > m_capacity)
+		MakeRoom(m_size + count);
+
+	iterator at = begin() + index;
+	std::copy_backward(at, end(), end() + count);
+	std::copy(first, last, at);
+	m_size += count;
+}
+
+WaypointList::iterator WaypointList::erase(iterator pos)
+{
+	std::copy(pos + 1, end(), pos);
+	--m_size;
+	return pos;
+}
+
+void WaypointList::resize(size_t count)
+{
+	if (count > m_size)
+	{
+		MakeRoom(count);
+		std::fill(end(), begin() + count, D3DXVECTOR3(0.0f, 0.0f, 0.0f));
+	}
+	m_size = count;
+	if (m_size == 0)
+		m_first = 0;
+}
+
+void WaypointList::reserve(size_t count)
+{
+	MakeRoom(count);
+}
+
+void WaypointList::clear(void)
+{
+	m_first = 0;
+	m_size = 0;
+}
+
+void WaypointList::swap(WaypointList &other)
+{
+	if (!IsLocal() && !other.IsLocal())
+	{
+		std::swap(m_data, other.m_data);
+		std::swap(m_first, other.m_first);
+		std::swap(m_size, other.m_size);
+		std::swap(m_capacity, other.m_capacity);
+		return;
+	}
+
+	// A list in its local buffer hands over the points, a heap block is handed over as is
+	WaypointList *local = IsLocal() ? this : &other;
+	WaypointList *remote = (local == this) ? &other : this;
+
+	D3DXVECTOR3 points[WAYPOINT_LOCAL_CAPACITY];
+	size_t count = local->m_size;
+	std::copy(local->begin(), local->end(), points);
+
+	if (remote->IsLocal())
+	{
+		local->m_first = 0;
+		local->m_size = remote->m_size;
+		std::copy(remote->begin(), remote->end(), local->m_local);
+	}
+	else
+	{
+		local->m_data = remote->m_data;
+		local->m_first = remote->m_first;
+		local->m_size = remote->m_size;
+		local->m_capacity = remote->m_capacity;
+		remote->m_data = remote->m_local;
+		remote->m_capacity = WAYPOINT_LOCAL_CAPACITY;
+	}
+
+	remote->m_first = 0;
+	remote->m_size = count;
+	std::copy(points, points + count, remote->m_local);
+}
+
+unsigned WaypointList::GetAllocationCount(void)
+{
+	return s_allocations;
+}
+
+void WaypointList::ResetAllocationCount(void)
+{
+	s_allocations = 0;
+}
+
+void WaypointList::MakeRoom(size_t count)
+{
+	// Slide the points back to the start before growing, pop_front leaves a gap there
+	if (count <= m_capacity)
+	{
+		if (m_first + count > m_capacity)
+		{
+			std::copy(begin(), end(), m_data);
+			m_first = 0;
+		}
+		return;
+	}
+
+	size_t capacity = (std::max)(count, m_capacity * 2);
+	D3DXVECTOR3 *data = new D3DXVECTOR3[capacity];
+	++s_allocations;
+
+	std::copy(begin(), end(), data);
+	Release();
+	m_data = data;
+	m_first = 0;
+	m_capacity = capacity;
+}
+
+void WaypointList::Release(void)
+{
+	if (!IsLocal())
+		delete[] m_data;
+	m_data = m_local;
+	m_capacity = WAYPOINT_LOCAL_CAPACITY;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Points kept in the object before the list moves to the heap, enough for most rubberbanded paths
+const size_t WAYPOINT_LOCAL_CAPACITY = 16;
+
+// Contiguous waypoint storage with the std::list calls the movement code uses.
+// pop_front moves the start along instead of shifting the points, and a heap
+// block is kept until the list is destroyed so a reused list stops allocating.
+class WaypointList
+{
+public:
+	typedef D3DXVECTOR3 value_type;
+	typedef D3DXVECTOR3 *iterator;
+	typedef const D3DXVECTOR3 *const_iterator;
+
+	WaypointList(void);
+	WaypointList(const WaypointList &other);
+	WaypointList(WaypointList &&other);
+	~WaypointList(void);
+	WaypointList &operator=(const WaypointList &other);
+	WaypointList &operator=(WaypointList &&other);
+
+	iterator begin(void)						{ return m_data + m_first; }
+	iterator end(void)							{ return m_data + m_first + m_size; }
+	const_iterator begin(void) const			{ return m_data + m_first; }
+	const_iterator end(void) const				{ return m_data + m_first + m_size; }
+
+	size_t size(void) const						{ return m_size; }
+	bool empty(void) const						{ return m_size == 0; }
+	size_t capacity(void) const					{ return m_capacity; }
+
+	D3DXVECTOR3 &front(void)					{ return m_data[m_first]; }
+	D3DXVECTOR3 &back(void)						{ return m_data[m_first + m_size - 1]; }
+	const D3DXVECTOR3 &front(void) const		{ return m_data[m_first]; }
+	const D3DXVECTOR3 &back(void) const			{ return m_data[m_first + m_size - 1]; }
+	D3DXVECTOR3 &operator[](size_t i)			{ return m_data[m_first + i]; }
+	const D3DXVECTOR3 &operator[](size_t i) const	{ return m_data[m_first + i]; }
+
+	void push_back(const D3DXVECTOR3 &point);
+	void pop_front(void);
+	iterator insert(iterator pos, const D3DXVECTOR3 &point);
+	void insert(iterator pos, const_iterator first, const_iterator last);
+	iterator erase(iterator pos);
+	void resize(size_t count);
+	void reserve(size_t count);
+	void clear(void);
+	void swap(WaypointList &other);
+
+	// Heap blocks taken by all lists since the last reset, counted across worker threads
+	static unsigned GetAllocationCount(void);
+	static void ResetAllocationCount(void);
+
+private:
+	bool IsLocal(void) const					{ return m_data == m_local; }
+	void MakeRoom(size_t count);
+	void Release(void);
+
+	D3DXVECTOR3 *m_data;		// m_local or the heap block
+	size_t m_first;				// index of front(), moved along by pop_front
+	size_t m_size;
+	size_t m_capacity;
+	D3DXVECTOR3 m_local[WAYPOINT_LOCAL_CAPACITY];
+
+	static std::atomic<unsigned> s_allocations;
+};
@@ -39,7 +39,8 @@ enum StateName {
 	STATE_DefaultTest1,
 	STATE_DefaultTest2,
 	STATE_AllTests,
-	STATE_CreateSampleTests
+	STATE_CreateSampleTests,
+	STATE_Benchmarks
 };
 
 //Add new substates here
@@ -80,6 +81,9 @@ bool Agent::States( State_Machine_Event event, MSG_Object * msg, int state, int
 	OnMsg( MSG_SetHeuristicCalc )
 		m_owner->GetMovement().SetHeuristicCalc( msg->GetIntData() );
 
+	OnMsg( MSG_SetSearchAlgorithm )
+		m_owner->GetMovement().SetSearchAlgorithm( msg->GetIntData() );
+
 	OnMsg( MSG_SetSmoothing )
 		m_owner->GetMovement().SetSmoothPath( msg->GetBoolData() );
 
@@ -164,6 +168,9 @@ bool Agent::States( State_Machine_Event event, MSG_Object * msg, int state, int
 	OnMsg(MSG_CreateSampleTests)
 		ChangeState(STATE_CreateSampleTests);
 
+	OnMsg(MSG_RunBenchmarks)
+		ChangeState(STATE_Benchmarks);
+
 	OnMsg( MSG_SetGoal )
 		int row = -1;
 		int col = -1;
@@ -376,6 +383,13 @@ bool Agent::States( State_Machine_Event event, MSG_Object * msg, int state, int
 			g_tests.CreateSampleTest("test", "sample", 5, 50, 25, 5);
 			ChangeState(STATE_Idle);
 
+	///////////////////////////////////////////////////////////////
+	DeclareState(STATE_Benchmarks)
+
+		OnEnter
+			g_tests.RunBenchmarks(*this);
+			ChangeState(STATE_Idle);
+
 EndStateMachine
 }
 
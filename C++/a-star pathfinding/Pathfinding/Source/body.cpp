@@ -28,4 +28,10 @@ Body::~Body( void )
 
 }
 
+void Body::SetPos( D3DXVECTOR3& pos )
+{
+	m_pos = pos;
+	g_database.MoveBody( *m_owner );
+}
+
 
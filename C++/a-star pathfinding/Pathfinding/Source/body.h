@@ -26,7 +26,7 @@ public:
 	inline void SetSpeed( float speed )				{ m_speed = speed; }
 	inline float GetSpeed( void )					{ return( m_speed ); }
 
-	inline void SetPos( D3DXVECTOR3& pos )			{ m_pos = pos; }
+	void SetPos( D3DXVECTOR3& pos );				//Also moves the owner in the database's grid
 	inline D3DXVECTOR3& GetPos( void )				{ return( m_pos ); }
 
 	inline void SetDir( D3DXVECTOR3& dir )			{ m_dir = dir; }
@@ -9,20 +9,27 @@
  */
 
 #include <Stdafx.h>
+#include <algorithm>
 
-Database::Database( void )
-: m_nextFreeID( SYSTEM_OBJECT_ID + 1 )
+static bool IsMarkedForDeletion( GameObject* object )
 {
+	return( object->IsMarkedForDeletion() );
+}
 
+Database::Database( void )
+: m_phased( false ),
+  m_inPhase( false )
+{
+	//IDs up to SYSTEM_OBJECT_ID are reserved and their slots are never used
+	dbSlot reserved = { 0, 0, 0 };
+	m_slots.resize( SYSTEM_OBJECT_ID + 1, reserved );
 }
 
 Database::~Database( void )
 {
-	dbContainer::iterator i = m_database.begin();
-	while( i != m_database.end() )
+	for( dbContainer::iterator i = m_database.begin(); i != m_database.end(); ++i )
 	{	//Destroy object
 		delete( *i );
-		i = m_database.erase( i );
 	}
 }
 
@@ -37,29 +44,122 @@ Database::~Database( void )
  *---------------------------------------------------------------------------*/
 void Database::Update( void )
 {
-	for( dbContainer::iterator i = m_database.begin(); i != m_database.end(); ++i )
-	{
-		(*i)->Update();
+	//Positions written through GetPos skip the grid, it catches up here
+	UpdateSpatialHash( m_database );
+
+	if( m_phased )
+	{	//Objects stored while a phase's messages go out get a phase of their own
+		for( unsigned int updated = 0; updated < m_database.size(); )
+		{
+			m_phaseObjects.assign( m_database.begin() + updated, m_database.end() );
+			updated = static_cast<unsigned int>( m_database.size() );
+			UpdatePhased( m_phaseObjects );
+		}
+	}
+	else
+	{	//Objects stored during the loop are updated this frame as well
+		for( unsigned int i = 0; i < m_database.size(); ++i )
+		{
+			m_database[i]->Update();
+		}
 	}
 
 	g_msgroute.DeliverDelayedMessages();
 
-	//Destroy objects that have requested it
-	dbContainer::iterator i = m_database.begin();
-	while( i != m_database.end() )
+	//Destroy objects that have requested it, keeping the others in order
+	dbContainer doomed;
+	unsigned int kept = 0;
+	for( unsigned int i = 0; i < m_database.size(); ++i )
 	{
-		if( (*i)->IsMarkedForDeletion() )
-		{	//Destroy object
-			delete( *i );
-			i = m_database.erase( i );
+		GameObject* object = m_database[i];
+		if( object->IsMarkedForDeletion() )
+		{
+			Unlink( object );
+			doomed.push_back( object );
 		}
 		else
 		{
-			++i;
+			m_database[kept] = object;
+			GetSlot( object->GetID() )->m_position = kept;
+			++kept;
+		}
+	}
+	m_database.resize( kept );
+
+	if( doomed.empty() ) {
+		return;
+	}
+
+	for( dbTypeIndex::iterator i = m_types.begin(); i != m_types.end(); ++i )
+	{
+		dbContainer& objects = i->second;
+		objects.erase( std::remove_if( objects.begin(), objects.end(), IsMarkedForDeletion ), objects.end() );
+	}
+
+	for( dbContainer::iterator i = doomed.begin(); i != doomed.end(); ++i )
+	{	//Destroy object
+		if( m_names.find( (*i)->GetName() ) == m_names.end() ) {
+			IndexName( (*i)->GetName() );
 		}
+		delete( *i );
 	}
 }
 
+/*---------------------------------------------------------------------------*
+  Name:         UpdatePhased
+
+  Description:  Updates objects in parallel on the job pool. Whatever they
+				send, remove or purge through the message router is held
+				back and done afterwards, object by object in list order,
+				so delayed messages come out exactly as from a serial update
+				whatever the number of workers. Messages sent to be delivered
+				now arrive after every object has updated instead of during
+				the sender's update.
+
+				While the objects update they may only change themselves,
+				read other objects and the database, log and reach others
+				through the message router. Objects can't be stored or
+				removed until the phase is over, and bodies they move only
+				join their new cells in the grid then.
+
+  Arguments:    objects : the objects to update
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void Database::UpdatePhased( const dbCompositionList & objects )
+{
+	unsigned int count = static_cast<unsigned int>( objects.size() );
+	g_msgroute.BeginPhase( count, m_jobPool.GetWorkerCount() );
+
+	m_inPhase = true;
+	m_jobPool.Run( count, [&objects]( unsigned int worker, unsigned int index ) {
+		g_msgroute.BeginDeferred( worker, index );
+		objects[index]->Update();
+		g_msgroute.EndDeferred();
+	} );
+	m_inPhase = false;
+
+	UpdateSpatialHash( objects );
+	g_msgroute.EndPhase();
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         SetPhasedUpdate
+
+  Description:  Switches Update between updating the objects one after
+				another and updating them in phases through UpdatePhased.
+
+  Arguments:    phased  : whether to update in phases
+				workers : threads to add to the calling one in phases
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void Database::SetPhasedUpdate( bool phased, unsigned int workers )
+{
+	m_phased = phased;
+	m_jobPool.SetWorkerCount( phased ? workers : 0 );
+}
+
 void Database::Animate( double dTimeDelta )
 {
 	for( dbContainer::iterator i = m_database.begin(); i != m_database.end(); i++ )
@@ -165,12 +265,14 @@ void Database::SendMsgFromSystem( GameObject* object, MSG_Name name, MSG_Data& d
  *---------------------------------------------------------------------------*/
 void Database::SendMsgFromSystem( MSG_Name name, MSG_Data& data )
 {
-	for( dbContainer::iterator i=m_database.begin(); i!=m_database.end(); ++i )
+	//Walked by index, a receiver may store new objects and grow the database
+	for( unsigned int i=0, count=m_database.size(); i<count; ++i )
 	{
-		MSG_Object msg( 0.0f, name, SYSTEM_OBJECT_ID, (*i)->GetID(), SCOPE_TO_STATE_MACHINE, 0, STATE_MACHINE_QUEUE_ALL, data, false, false );
-		if((*i)->GetStateMachineManager())
+		GameObject* object = m_database[i];
+		MSG_Object msg( 0.0f, name, SYSTEM_OBJECT_ID, object->GetID(), SCOPE_TO_STATE_MACHINE, 0, STATE_MACHINE_QUEUE_ALL, data, false, false );
+		if(object->GetStateMachineManager())
 		{
-			(*i)->GetStateMachineManager()->SendMsg( msg );
+			object->GetStateMachineManager()->SendMsg( msg );
 		}
 	}
 }
@@ -180,14 +282,35 @@ void Database::SendMsgFromSystem( MSG_Name name, MSG_Data& data )
 
   Description:  Stores an object within the database.
 
-  Arguments:    object : the game object
+  Arguments:    object : the game object, with an ID from GetNewObjectID
 
   Returns:      None.
  *---------------------------------------------------------------------------*/
 void Database::Store( GameObject & object )
 {
-	if( Find( object.GetID() ) == 0 ) {
+	ASSERTMSG( !m_inPhase, "Database::Store - Objects can't be stored during a phased update." );
+
+	objectID id = object.GetID();
+	unsigned int index = id & OBJECT_INDEX_MASK;
+	ASSERTMSG( index > SYSTEM_OBJECT_ID && index < m_slots.size(), "Database::Store - Object ID not from GetNewObjectID." );
+
+	dbSlot& slot = m_slots[index];
+	if( slot.m_object == 0 && slot.m_generation == id >> OBJECT_INDEX_BITS ) {
+		slot.m_object = &object;
+		slot.m_position = static_cast<unsigned int>( m_database.size() );
 		m_database.push_back( &object );
+		m_names.insert( std::make_pair( std::string( object.GetName() ), id ) );
+
+		for( dbTypeIndex::iterator i = m_types.begin(); i != m_types.end(); ++i )
+		{
+			if( object.GetType() & i->first ) {
+				i->second.push_back( &object );
+			}
+		}
+
+		if( object.HasBody() ) {
+			m_spatialHash.Update( object );
+		}
 	}
 	else {
 		ASSERTMSG( 0, "Database::Store - Object ID already represented in database." );
@@ -205,13 +328,34 @@ void Database::Store( GameObject & object )
  *---------------------------------------------------------------------------*/
 void Database::Remove( objectID id )
 {
-	for( dbContainer::iterator i=m_database.begin(); i!=m_database.end(); ++i )
+	ASSERTMSG( !m_inPhase, "Database::Remove - Objects can't be removed during a phased update." );
+
+	GameObject* object = Find( id );
+	if( object == 0 ) {
+		return;
+	}
+
+	unsigned int position = GetSlot( id )->m_position;
+	Unlink( object );
+
+	m_database.erase( m_database.begin() + position );
+	for( unsigned int i = position; i < m_database.size(); ++i )
 	{
-		if( (*i)->GetID() == id ) {
-			m_database.erase(i);	
-			return;
+		GetSlot( m_database[i]->GetID() )->m_position = i;
+	}
+
+	for( dbTypeIndex::iterator i = m_types.begin(); i != m_types.end(); ++i )
+	{
+		if( object->GetType() & i->first )
+		{
+			dbContainer& objects = i->second;
+			objects.erase( std::find( objects.begin(), objects.end(), object ) );
 		}
 	}
+
+	if( m_names.find( object->GetName() ) == m_names.end() ) {
+		IndexName( object->GetName() );
+	}
 }
 
 /*---------------------------------------------------------------------------*
@@ -225,15 +369,8 @@ void Database::Remove( objectID id )
  *---------------------------------------------------------------------------*/
 GameObject* Database::Find( objectID id )
 {
-	for( dbContainer::iterator i=m_database.begin(); i!=m_database.end(); ++i )
-	{
-		if( (*i)->GetID() == id ) {
-			return( *i );
-		}
-	}
-
-	return( 0 );
-
+	dbSlot* slot = GetSlot( id );
+	return( slot ? slot->m_object : 0 );
 }
 
 GameObject* Database::Find(char *name)
@@ -249,14 +386,13 @@ GameObject* Database::Find(char *name)
   Arguments:    name : the name of the object
 
   Returns:      An ID. If object is not found, returns INVALID_OBJECT_ID.
+				With several objects of that name, the first one stored.
  *---------------------------------------------------------------------------*/
 objectID Database::GetIDByName( char* name )
 {
-	for( dbContainer::iterator i=m_database.begin(); i!=m_database.end(); ++i )
-	{
-		if( strcmp( (*i)->GetName(), name ) == 0 ) {
-			return( (*i)->GetID() );
-		}
+	dbNameIndex::iterator i = m_names.find( name );
+	if( i != m_names.end() ) {
+		return( i->second );
 	}
 
 	return( INVALID_OBJECT_ID );
@@ -265,7 +401,8 @@ objectID Database::GetIDByName( char* name )
 /*---------------------------------------------------------------------------*
   Name:         GetNewObjectID
 
-  Description:  Get a fresh object ID.
+  Description:  Get a fresh object ID, reusing the slot of a destroyed object
+				when there is one.
 
   Arguments:    None.
 
@@ -273,8 +410,23 @@ objectID Database::GetIDByName( char* name )
  *---------------------------------------------------------------------------*/
 objectID Database::GetNewObjectID( void )
 {
-	return( m_nextFreeID++ );
+	ASSERTMSG( !m_inPhase, "Database::GetNewObjectID - IDs can't be handed out during a phased update." );
 
+	unsigned int index;
+	if( !m_freeSlots.empty() )
+	{
+		index = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		ASSERTMSG( m_slots.size() <= OBJECT_INDEX_MASK, "Database::GetNewObjectID - Out of object slots." );
+		dbSlot slot = { 0, 0, 0 };
+		index = static_cast<unsigned int>( m_slots.size() );
+		m_slots.push_back( slot );
+	}
+
+	return( (m_slots[index].m_generation << OBJECT_INDEX_BITS) | index );
 }
 
 /*---------------------------------------------------------------------------*
@@ -289,13 +441,199 @@ objectID Database::GetNewObjectID( void )
  *---------------------------------------------------------------------------*/
 void Database::ComposeList( dbCompositionList & list, unsigned int type )
 {
+	const dbCompositionList& objects = GetObjectsOfType( type );
+	list.insert( list.end(), objects.begin(), objects.end() );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         GetObjectsOfType
+
+  Description:  The objects of a certain type, without copying them. The first
+				call for a type mask builds its list, after which Store, Remove
+				and Update keep it current.
+
+				Objects stored while the list is walked are appended to it, so
+				walk it by index up to the size it had at the start. Remove
+				must not be called while walking it.
+
+  Arguments:    type   : the type of object, or OBJECT_Ignore_Type for all
+
+  Returns:      The objects in the order they were stored.
+ *---------------------------------------------------------------------------*/
+const dbCompositionList& Database::GetObjectsOfType( unsigned int type )
+{
+	if( type == OBJECT_Ignore_Type ) {
+		return( m_database );
+	}
+
+	dbTypeIndex::iterator found = m_types.find( type );
+	if( found != m_types.end() ) {
+		return( found->second );
+	}
+
 	//Find all objects of "type"
+	dbContainer& objects = m_types[type];
 	for( dbContainer::iterator i=m_database.begin(); i!=m_database.end(); ++i )
 	{
-		if( type == OBJECT_Ignore_Type || (*i)->GetType() & type )
+		if( (*i)->GetType() & type )
 		{	//Type matches
-			list.push_back(*i);
+			objects.push_back(*i);
+		}
+	}
+	return( objects );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         ComposeListInRadius
+
+  Description:  Compose a list of objects of a certain type within a radius.
+
+  Arguments:    list   : the list to fill with the result of the operation
+				pos    : the center
+				radius : the radius
+				type   : the type of object to add to the list (optional)
+
+  Returns:      None. (The result is stored in the list argument, in the
+				order the objects were stored.)
+ *---------------------------------------------------------------------------*/
+void Database::ComposeListInRadius( dbCompositionList & list, const D3DXVECTOR3& pos, float radius, unsigned int type )
+{
+	size_t first = list.size();
+	m_spatialHash.QueryRadius( pos, radius, type, list );
+
+	//Grid order depends on where objects stand, stored order keeps message order stable
+	std::sort( list.begin() + first, list.end(), [this]( GameObject* a, GameObject* b ) {
+		return( m_slots[a->GetID() & OBJECT_INDEX_MASK].m_position < m_slots[b->GetID() & OBJECT_INDEX_MASK].m_position );
+	} );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         FindNearest
+
+  Description:  Find the closest object of a certain type within a radius.
+
+  Arguments:    pos    : the center
+				radius : the radius
+				type   : the type of object (optional)
+				ignore : an object to skip, usually the one asking (optional)
+
+  Returns:      An object pointer. If no object is in range, returns 0.
+ *---------------------------------------------------------------------------*/
+GameObject* Database::FindNearest( const D3DXVECTOR3& pos, float radius, unsigned int type, GameObject* ignore )
+{
+	return( m_spatialHash.FindNearest( pos, radius, type, ignore ) );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         MoveBody
+
+  Description:  Moves a stored object to the grid cell of its body's current
+				position, so proximity queries see it where it is now. The
+				grid can't change while a phase updates on the workers, so
+				then the object waits for the phase to end.
+
+  Arguments:    object : a game object with a body
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void Database::MoveBody( GameObject & object )
+{
+	if( m_inPhase ) {
+		return;
+	}
+
+	dbSlot* slot = GetSlot( object.GetID() );
+	if( slot && slot->m_object == &object ) {
+		m_spatialHash.Update( object );
+	}
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         UpdateSpatialHash
+
+  Description:  Moves the objects with a body to the grid cells of their
+				current positions. Objects that stayed in their cell cost a
+				lookup.
+
+  Arguments:    objects : stored game objects
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void Database::UpdateSpatialHash( const dbCompositionList & objects )
+{
+	for( unsigned int i = 0; i < objects.size(); ++i )
+	{
+		if( objects[i]->HasBody() ) {
+			m_spatialHash.Update( *objects[i] );
 		}
 	}
 }
 
+
+/*---------------------------------------------------------------------------*
+  Name:         GetSlot
+
+  Description:  Get the slot of a stored object.
+
+  Arguments:    id : the ID of the object
+
+  Returns:      The slot, or 0 if the ID is out of range or from an earlier
+				generation of the slot.
+ *---------------------------------------------------------------------------*/
+Database::dbSlot* Database::GetSlot( objectID id )
+{
+	unsigned int index = id & OBJECT_INDEX_MASK;
+	if( index >= m_slots.size() || m_slots[index].m_generation != id >> OBJECT_INDEX_BITS ) {
+		return( 0 );
+	}
+	return( &m_slots[index] );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         Unlink
+
+  Description:  Frees an object's slot and drops it from the name index. The
+				object stays in m_database and the type lists for the caller
+				to take out, and if the name has no entry afterwards the
+				caller re-indexes it once they are updated.
+
+  Arguments:    object : a stored game object
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void Database::Unlink( GameObject* object )
+{
+	objectID id = object->GetID();
+	m_spatialHash.Remove( *object );
+
+	dbSlot& slot = m_slots[id & OBJECT_INDEX_MASK];
+	slot.m_object = 0;
+	slot.m_generation = (slot.m_generation + 1) & OBJECT_GENERATION_MASK;
+	m_freeSlots.push_back( id & OBJECT_INDEX_MASK );
+
+	dbNameIndex::iterator i = m_names.find( object->GetName() );
+	if( i != m_names.end() && i->second == id ) {
+		m_names.erase( i );
+	}
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         IndexName
+
+  Description:  Points the name index at the first stored object with the
+				given name, if any.
+
+  Arguments:    name : the name of the object
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void Database::IndexName( const char* name )
+{
+	for( dbContainer::iterator i=m_database.begin(); i!=m_database.end(); ++i )
+	{
+		if( strcmp( (*i)->GetName(), name ) == 0 ) {
+			m_names[name] = (*i)->GetID();
+			return;
+		}
+	}
+}
@@ -11,12 +11,22 @@
 #pragma once
 
 #include "msg.h"
+#include "SpatialHash.h"
+#include "JobPool.h"
 
 class GameObject;
 
 
 #define INVALID_OBJECT_ID 0
 
+// An objectID is a slot index in the low bits and the slot's generation in the
+// high bits. A slot is reused once its object is gone, with the generation
+// bumped, so an old ID finds nothing instead of the slot's new object
+// (until the generation wraps after 4096 reuses of the same slot).
+#define OBJECT_INDEX_BITS 20
+#define OBJECT_INDEX_MASK ((1u << OBJECT_INDEX_BITS) - 1)
+#define OBJECT_GENERATION_MASK ((1u << (32 - OBJECT_INDEX_BITS)) - 1)
+
 typedef std::vector<GameObject*> dbCompositionList;
 
 class Database
@@ -27,6 +37,7 @@ public:
 	~Database( void );
 
 	void Update( void );
+	void UpdatePhased( const dbCompositionList & objects );
 	void Animate( double dTimeDelta );
 	void AdvanceTimeAndDraw( IDirect3DDevice9* pd3dDevice, D3DXMATRIX* pViewProj, double dTimeDelta, D3DXVECTOR3 *pvEye );
 	void Initialize( void );
@@ -46,16 +57,50 @@ public:
 	objectID GetNewObjectID( void );
 	
 	void ComposeList( dbCompositionList & list, unsigned int type = 0 );
+	const dbCompositionList& GetObjectsOfType( unsigned int type = 0 );
 
+	//Proximity queries on objects with a body, through a grid that follows Body::SetPos.
+	//Bodies moved during a phased update join their new cells once the phase is over.
+	void ComposeListInRadius( dbCompositionList & list, const D3DXVECTOR3& pos, float radius, unsigned int type = 0 );
+	GameObject* FindNearest( const D3DXVECTOR3& pos, float radius, unsigned int type = 0, GameObject* ignore = 0 );
+	void MoveBody( GameObject & object );
 
-private:
+	//Update in phases on the calling thread plus workers, see UpdatePhased
+	void SetPhasedUpdate( bool phased, unsigned int workers );
+	inline bool IsPhasedUpdate( void )					{ return( m_phased ); }
+	inline unsigned int GetUpdateWorkerCount( void )	{ return( m_jobPool.GetWorkerCount() ); }
 
-	typedef std::list<GameObject*> dbContainer;
 
-	//Make this a more efficient data structure (like a hash table)
-	dbContainer m_database;
+private:
 
-	objectID m_nextFreeID;
+	struct dbSlot
+	{
+		GameObject* m_object;			//0 while the ID is handed out but not stored yet
+		unsigned int m_generation;
+		unsigned int m_position;		//Index of the object in m_database
+	};
+
+	typedef std::vector<GameObject*> dbContainer;
+	typedef std::vector<dbSlot> dbSlotContainer;
+	typedef std::unordered_map<std::string, objectID> dbNameIndex;
+	typedef std::unordered_map<unsigned int, dbContainer> dbTypeIndex;
+
+	dbContainer m_database;				//Stored objects, in the order they were stored
+	dbSlotContainer m_slots;			//Indexed by the low bits of an objectID
+	std::vector<unsigned int> m_freeSlots;
+	dbNameIndex m_names;				//First stored object with each name
+	dbTypeIndex m_types;				//Objects matching each type mask asked for so far, in stored order
+	SpatialHash m_spatialHash;
+
+	bool m_phased;
+	bool m_inPhase;						//Objects are updating on the job pool
+	JobPool m_jobPool;
+	dbContainer m_phaseObjects;
+
+	dbSlot* GetSlot( objectID id );
+	void Unlink( GameObject* object );
+	void IndexName( const char* name );
+	void UpdateSpatialHash( const dbCompositionList & objects );
 
 
 };
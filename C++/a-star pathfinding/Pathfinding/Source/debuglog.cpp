@@ -10,41 +10,28 @@
 
 #include <Stdafx.h>
 
-#define MAX_DEBUG_LOG_SIZE 200
-
-
-LogEntry::LogEntry( void )
+//Names of the State_Machine_Event values, for events no handler caught
+static const char* EventNameText[] =
 {
-	m_owner = INVALID_OBJECT_ID;
-	m_name[0] = 0;
-	m_handled = false;
-
-	m_timestamp = -1.0f;
-	m_statename[0] = 0;
-	m_eventmsgname[0] = 0;
-	m_msg = false;
-	m_receiver = INVALID_OBJECT_ID;
-	m_sender = INVALID_OBJECT_ID;
-	m_data = 0;
-	
-}
-
-
-/*---------------------------------------------------------------------------*
-  Name:         ~DebugLog
-
-  Description:  Destructor
- *---------------------------------------------------------------------------*/
-DebugLog::~DebugLog( void )
+	"INVALID_EVENT",
+	"EVENT_Update",
+	"EVENT_Message",
+	"EVENT_CCMessage",
+	"EVENT_Enter",
+	"EVENT_Exit",
+	"EVENT_Probe",
+	"EVENT_PostEnter"
+};
+
+
+DebugLog::DebugLog( void )
+: m_next( 0 ),
+  m_echo( false )
 {
-	LoggingContainer::iterator i;
-	for( i=m_log.begin(); i!=m_log.end(); ++i )
+	for( int i=0; i<DEBUG_LOG_CAPACITY; i++ )
 	{
-		LogEntry* entry = *i;
-		delete(entry);
+		m_log[i].m_ticket.store( 0, std::memory_order_relaxed );
 	}
-
-	m_log.clear();
 }
 
 
@@ -54,102 +41,69 @@ DebugLog::~DebugLog( void )
   Description:  Logs a state machine event, such as a received message.
 
   Arguments:    id           : ID of the object
-				name         : string name of the object
 				msg          : pointer to message object containing event
-				statename    : current state of object
-				substatename : current substate of object
-				eventmsgname : the name of the event
+				statename    : current state of object, a string literal
+				substatename : current substate of object, a string literal
+				eventname    : the name of the event, a string literal
 				handled      : whether the event was handled by the object
 
   Returns:      None.
  *---------------------------------------------------------------------------*/
-void DebugLog::LogStateMachineEvent( objectID id, char* name, MSG_Object * msg, const char* statename, const char* substatename, MSG_Name eventmsgname, bool handled )
-{
-	LogStateMachineEvent( id, name, msg, statename, substatename, (char*)TranslateMsgNameToString( eventmsgname ), handled );
-}
-
-void DebugLog::LogStateMachineEvent( objectID id, char* name, MSG_Object * msg, const char* statename, const char* substatename, char* eventmsgname, bool handled )
+void DebugLog::LogStateMachineEvent( objectID id, MSG_Object * msg, const char* statename, const char* substatename, const char* eventname, bool handled )
 {
-	if( msg && ( strcmp( MessageNameText[msg->GetName()], "MSG_CHANGE_STATE_DELAYED" ) == 0 ||
-		strcmp( MessageNameText[msg->GetName()], "MSG_CHANGE_SUBSTATE_DELAYED" ) == 0 ))
+	if( msg && ( msg->GetName() == MSG_CHANGE_STATE_DELAYED || msg->GetName() == MSG_CHANGE_SUBSTATE_DELAYED ) )
 	{	//Don't log these events
 		return;
 	}
 
-	LogEntry * entry = new LogEntry();
-
-	entry->m_owner = id;
-	strcpy(entry->m_name, name);
-	entry->m_handled = handled;
-	entry->m_timestamp = g_clock.GetCurTime();
-	strcpy( entry->m_statename, statename );
-	strcpy( entry->m_substatename, substatename );
+	unsigned int ticket;
+	LogEntry& entry = BeginEntry( id, handled, ticket );
+	entry.m_statename = statename;
+	entry.m_substatename = substatename;
+	entry.m_eventname = eventname;
+	SetMsg( entry, msg );
+	EndEntry( ticket );
 
-	if( !handled )
-	{
-		if( eventmsgname[0] == '1')
-		{
-			strcpy( entry->m_eventmsgname, "EVENT_Update" );
-		}
-		else if( eventmsgname[0] == '2' && msg )
-		{
-			strcpy( entry->m_eventmsgname, MessageNameText[msg->GetName()] );
-		}
-		else if( eventmsgname[0] == '3')
-		{
-			strcpy( entry->m_eventmsgname, "EVENT_CCMessage" );
-		}
-		else if( eventmsgname[0] == '4') 
-		{
-			strcpy( entry->m_eventmsgname, "EVENT_Enter" );
-		}
-		else if( eventmsgname[0] == '5') 
-		{
-			strcpy( entry->m_eventmsgname, "EVENT_Exit" );
-		}
-		else if( eventmsgname[0] == '6') 
-		{
-			strcpy( entry->m_eventmsgname, "EVENT_Probe" );
-		}
-		else if( eventmsgname[0] == '7') 
-		{
-			strcpy( entry->m_eventmsgname, "EVENT_PostEnter" );
-		}
-		else
-		{
-			ASSERTMSG( 0, "DebugLog::LogStateMachineEvent - eventmsgname not handled" );
-			strcpy( entry->m_eventmsgname, "INVALID_EVENT" );
-		}
-	}
-	else
-	{
-		strcpy( entry->m_eventmsgname, eventmsgname );
+	if( m_echo && strcmp( eventname, "EVENT_Update" ) != 0 ) {
+		PrintLogEntry( entry );
 	}
+}
 
-	if( msg ) {
-		entry->m_msg = true;
-		entry->m_receiver = msg->GetReceiver();
-		entry->m_sender = msg->GetSender();
-		if( msg->IsIntData() )
-		{ 
-			entry->m_data = msg->GetIntData();
-		}
-		else
-		{	//TODO: Deal with float data properly
-			entry->m_data = 0;
-		}
-	}
+void DebugLog::LogStateMachineEvent( objectID id, MSG_Object * msg, const char* statename, const char* substatename, MSG_Name eventmsgname, bool handled )
+{
+	LogStateMachineEvent( id, msg, statename, substatename, TranslateMsgNameToString( eventmsgname ), handled );
+}
 
-	if( (handled || eventmsgname[0] == '2') &&
-		strcmp(entry->m_eventmsgname, "EVENT_Update") != 0 )
-	{
-		PrintLogEntry( *entry );
+/*---------------------------------------------------------------------------*
+  Name:         LogStateMachineUnhandledEvent
+
+  Description:  Logs an event that no handler in the current state caught.
+
+  Arguments:    id           : ID of the object
+				msg          : pointer to message object containing event
+				statename    : current state of object, a string literal
+				substatename : current substate of object, a string literal
+				event        : the State_Machine_Event
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void DebugLog::LogStateMachineUnhandledEvent( objectID id, MSG_Object * msg, const char* statename, const char* substatename, int event )
+{
+	if( msg && ( msg->GetName() == MSG_CHANGE_STATE_DELAYED || msg->GetName() == MSG_CHANGE_SUBSTATE_DELAYED ) )
+	{	//Don't log these events
+		return;
 	}
 
-	m_log.push_back( entry );
-	if( m_log.size() > MAX_DEBUG_LOG_SIZE ) {
-		delete( m_log.front() );
-		m_log.pop_front();
+	unsigned int ticket;
+	LogEntry& entry = BeginEntry( id, false, ticket );
+	entry.m_statename = statename;
+	entry.m_substatename = substatename;
+	entry.m_event = event;
+	SetMsg( entry, msg );
+	EndEntry( ticket );
+
+	if( m_echo && event == EVENT_Message ) {
+		PrintLogEntry( entry );
 	}
 }
 
@@ -159,32 +113,22 @@ void DebugLog::LogStateMachineEvent( objectID id, char* name, MSG_Object * msg,
   Description:  Logs a state machine state change.
 
   Arguments:    id        : ID of the object
-				name      : string name of the object
 				state     : new state index
 				substate  : new substate index
-				statename : current state of object
 
   Returns:      None.
  *---------------------------------------------------------------------------*/
-void DebugLog::LogStateMachineStateChange( objectID id, char* name, unsigned int state, int substate )
+void DebugLog::LogStateMachineStateChange( objectID id, unsigned int state, int substate )
 {
-	LogEntry * entry = new LogEntry();
-
-	entry->m_owner = id;
-	strcpy(entry->m_name, name);
-	entry->m_handled = true;
-	entry->m_timestamp = g_clock.GetCurTime();
-	sprintf( entry->m_statename, "%d", state );
-	sprintf( entry->m_substatename, "%d", substate );
-	strcpy( entry->m_eventmsgname, "STATE_CHANGE" );
-	entry->m_msg = false;
-
-	PrintLogEntry( *entry );
-
-	m_log.push_back( entry );
-	if( m_log.size() > MAX_DEBUG_LOG_SIZE ) {
-		delete( m_log.front() );
-		m_log.pop_front();
+	unsigned int ticket;
+	LogEntry& entry = BeginEntry( id, true, ticket );
+	entry.m_stateChange = true;
+	entry.m_event = static_cast<int>( state );
+	entry.m_substate = substate;
+	EndEntry( ticket );
+
+	if( m_echo ) {
+		PrintLogEntry( entry );
 	}
 }
 
@@ -201,23 +145,154 @@ void DebugLog::LogStateMachineStateChange( objectID id, char* name, unsigned int
 void DebugLog::Dump( objectID id )
 {
 	GameObject* obj = g_database.Find( id );
-	printf( "DebugLog: %s, id=%d\n", obj->GetName(), id );
+	printf( "DebugLog: %s, id=%d\n", obj ? obj->GetName() : "(removed)", id );
+
+	PrintRange( id );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         Print
+
+  Description:  Prints every entry still in the log, oldest first.
 
-	LoggingContainer::iterator i;
-	for( i=m_log.begin(); i!=m_log.end(); ++i )
+  Arguments:    None.
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void DebugLog::Print( void )
+{
+	PrintRange( INVALID_OBJECT_ID );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         Clear
+
+  Description:  Empties the log. Not safe while another thread is logging.
+
+  Arguments:    None.
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void DebugLog::Clear( void )
+{
+	for( int i=0; i<DEBUG_LOG_CAPACITY; i++ )
 	{
-		LogEntry* log = *i;
-		if( log && log->m_owner == id )
+		m_log[i].m_ticket.store( 0, std::memory_order_relaxed );
+	}
+	m_next.store( 0 );
+}
+
+LogEntry& DebugLog::BeginEntry( objectID id, bool handled, unsigned int & ticket )
+{
+	//Claim the next slot, then mark it as being written so readers skip it
+	ticket = m_next.fetch_add( 1, std::memory_order_relaxed );
+	Slot& slot = m_log[ticket & DEBUG_LOG_MASK];
+	slot.m_ticket.store( 0, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+
+	LogEntry& entry = slot.m_entry;
+	entry.m_timestamp = g_clock.GetCurTime();
+	entry.m_owner = id;
+	entry.m_handled = handled;
+	entry.m_stateChange = false;
+	entry.m_statename = "";
+	entry.m_substatename = "";
+	entry.m_eventname = 0;
+	entry.m_event = EVENT_INVALID;
+	entry.m_substate = -1;
+	entry.m_msg = false;
+	return( entry );
+}
+
+void DebugLog::EndEntry( unsigned int ticket )
+{
+	m_log[ticket & DEBUG_LOG_MASK].m_ticket.store( ticket + 1, std::memory_order_release );
+}
+
+void DebugLog::SetMsg( LogEntry& entry, MSG_Object * msg )
+{
+	if( msg ) {
+		entry.m_msg = true;
+		entry.m_msgname = msg->GetName();
+		entry.m_receiver = msg->GetReceiver();
+		entry.m_sender = msg->GetSender();
+		if( msg->IsIntData() )
+		{ 
+			entry.m_data = msg->GetIntData();
+		}
+		else
+		{	//TODO: Deal with float data properly
+			entry.m_data = 0;
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         CopyEntry
+
+  Description:  Copies out the entry logged with a ticket.
+
+  Arguments:    ticket : the ticket the entry was logged with
+				copy   : receives the entry
+
+  Returns:      False if the entry was overwritten or is still being written.
+ *---------------------------------------------------------------------------*/
+bool DebugLog::CopyEntry( unsigned int ticket, LogEntry& copy )
+{
+	Slot& slot = m_log[ticket & DEBUG_LOG_MASK];
+	if( slot.m_ticket.load( std::memory_order_acquire ) != ticket + 1 ) {
+		return( false );
+	}
+
+	copy = slot.m_entry;
+
+	//A writer that claimed the slot meanwhile will have changed the ticket
+	std::atomic_thread_fence( std::memory_order_acquire );
+	return( slot.m_ticket.load( std::memory_order_relaxed ) == ticket + 1 );
+}
+
+void DebugLog::PrintRange( objectID id )
+{
+	unsigned int last = m_next.load( std::memory_order_acquire );
+	unsigned int first = last > DEBUG_LOG_CAPACITY ? last - DEBUG_LOG_CAPACITY : 0;
+
+	for( unsigned int ticket = first; ticket != last; ++ticket )
+	{
+		LogEntry entry;
+		if( CopyEntry( ticket, entry ) && ( id == INVALID_OBJECT_ID || entry.m_owner == id ) )
 		{
-			PrintLogEntry( *log );
+			PrintLogEntry( entry );
 		}
 	}
 }
 
+const char* DebugLog::GetEventName( LogEntry& entry )
+{
+	if( entry.m_stateChange )
+	{
+		return( "STATE_CHANGE" );
+	}
+	else if( entry.m_eventname )
+	{
+		return( entry.m_eventname );
+	}
+	else if( entry.m_event == EVENT_Message && entry.m_msg )
+	{
+		return( MessageNameText[entry.m_msgname] );
+	}
+	else if( entry.m_event > EVENT_INVALID && entry.m_event <= EVENT_PostEnter )
+	{
+		return( EventNameText[entry.m_event] );
+	}
+
+	ASSERTMSG( 0, "DebugLog::GetEventName - event not handled" );
+	return( EventNameText[EVENT_INVALID] );
+}
+
 /*---------------------------------------------------------------------------*
   Name:         PrintLogEntry
 
-  Description:  Prints a single log entry.
+  Description:  Prints a single log entry, looking up the object's name.
 
   Arguments:    entry : the log entry to print
 
@@ -230,7 +305,14 @@ void DebugLog::PrintLogEntry( LogEntry& entry )
 	char debug2[1024];
 	char state[64];
 
-	if( entry.m_statename[0] != 0 )
+	GameObject* obj = g_database.Find( entry.m_owner );
+	const char* name = obj ? obj->GetName() : "(removed)";
+
+	if( entry.m_stateChange )
+	{	//State changes log indices, the names are only known inside the machine
+		sprintf( state, "%d", entry.m_event );
+	}
+	else if( entry.m_statename[0] != 0 )
 	{	//Use state
 		strcpy( state, entry.m_statename );
 	}
@@ -239,7 +321,7 @@ void DebugLog::PrintLogEntry( LogEntry& entry )
 		strcpy( state, entry.m_substatename );
 	}
 
-	sprintf( debug0, "%.3f-[%s,%d] %s:%s ", entry.m_timestamp, entry.m_name, entry.m_owner, state, entry.m_eventmsgname );
+	sprintf( debug0, "%.3f-[%s,%d] %s:%s ", entry.m_timestamp, name, entry.m_owner, state, GetEventName( entry ) );
 	
 	if( entry.m_msg )
 	{
@@ -259,10 +341,6 @@ void DebugLog::PrintLogEntry( LogEntry& entry )
 		strcpy( debug2, "(not handled)\n" );
 	}
 
-	//char final[4096];
-	//sprintf( final, "%s%s%s\n", debug0, debug1, debug2 );
-	//LPCWSTR utf16str = wstring_to_utf16str(utf8str_to_wstring(final));
-
 	char msg[1024];
 	sprintf(msg, "%s%s%s", debug0, debug1, debug2);
 	WCHAR final[1024];
@@ -270,4 +348,4 @@ void DebugLog::PrintLogEntry( LogEntry& entry )
 	MultiByteToWideChar (CP_ACP, 0, msg, length, final, length);
 	final[length] = 0;
 	OutputDebugString(final);
-}
\ No newline at end of file
+}
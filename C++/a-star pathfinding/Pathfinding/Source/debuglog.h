@@ -12,65 +12,95 @@
 
 #pragma warning(disable: 4995)
 
+#include <atomic>
+
 #define REGISTER_MESSAGE_NAME(x) #x,
 static const char* MessageNameText[] =
 {
-	"Invalid"
+	"Invalid",
 	#include "msgnames.h"
 	"Invalid_Max_Num"
 };
 #undef REGISTER_MESSAGE_NAME
 
 
-class LogEntry
-{
-public:
-	
-	LogEntry( void );
-	~LogEntry( void ) {}
+// Records the ring holds, a power of two. Once full the oldest are overwritten.
+#define DEBUG_LOG_CAPACITY 4096
+#define DEBUG_LOG_MASK (DEBUG_LOG_CAPACITY - 1)
 
+// One logged event, ids and enums only. The state and event names are
+// pointers to the string literals the state machine macros pass in, so
+// nothing is copied or formatted until the entry is printed.
+struct LogEntry
+{
+	float m_timestamp;
 	objectID m_owner;
-	char m_name[GAME_OBJECT_MAX_NAME_SIZE];
 	bool m_handled;
+	bool m_stateChange;
 
-	float m_timestamp;
-	char m_statename[64];
-	char m_substatename[64];
-	char m_eventmsgname[64];
+	const char* m_statename;
+	const char* m_substatename;
+	const char* m_eventname;	//Literal event name, or 0 to name it from m_event or m_msgname
+	int m_event;				//Unhandled State_Machine_Event, or the new state of a state change
+	int m_substate;				//New substate of a state change
 
 	//msg only info
 	bool m_msg;
+	int m_msgname;
 	objectID m_receiver;
 	objectID m_sender;
 	unsigned int m_data;
-
-
 };
 
+// Fixed ring of state machine events. Writers claim a slot with one atomic
+// increment and never take a lock or allocate; Dump and Print copy entries
+// out and format them, skipping any a writer is still filling in.
 class DebugLog
 {
 public:
 
-	DebugLog( void ) {}
-	~DebugLog( void );
+	DebugLog( void );
+	~DebugLog( void ) {}
 
-	void LogStateMachineEvent( objectID id, char* name, MSG_Object * msg, const char* statename, const char* substatename, char* eventmsgname, bool handled ); 
-	void LogStateMachineEvent( objectID id, char* name, MSG_Object * msg, const char* statename, const char* substatename, MSG_Name eventmsgname, bool handled ); 
-	void LogStateMachineStateChange( objectID id, char* name, unsigned int state, int substate );
+	// Event names must be string literals, only the pointer is kept
+	void LogStateMachineEvent( objectID id, MSG_Object * msg, const char* statename, const char* substatename, const char* eventname, bool handled ); 
+	void LogStateMachineEvent( objectID id, MSG_Object * msg, const char* statename, const char* substatename, MSG_Name eventmsgname, bool handled ); 
+	void LogStateMachineUnhandledEvent( objectID id, MSG_Object * msg, const char* statename, const char* substatename, int event ); 
+	void LogStateMachineStateChange( objectID id, unsigned int state, int substate );
 
 	const char * TranslateMsgNameToString( MSG_Name msgname )		{ return( MessageNameText[ msgname ] ); }
 
 	void Dump( objectID id );
+	void Print( void );
+	void Clear( void );
+
+	// Also print handled events and state changes as they are logged
+	inline void SetEcho( bool echo )							{ m_echo = echo; }
+
+	inline unsigned int GetCount( void )						{ return( m_next ); }
 
 	void OutputDebugStringX( const wchar_t * string, ... ) { va_list args; va_start(args, string); wchar_t buf[2048]; vswprintf(buf, string, args); OutputDebugString(buf); }
 
 
 private:
 
-	typedef std::list<LogEntry*> LoggingContainer;
+	struct Slot
+	{
+		std::atomic<unsigned int> m_ticket;		//Ticket + 1 once written, 0 while being written
+		LogEntry m_entry;
+	};
 
-	LoggingContainer m_log;
+	LogEntry& BeginEntry( objectID id, bool handled, unsigned int & ticket );
+	void EndEntry( unsigned int ticket );
+	void SetMsg( LogEntry& entry, MSG_Object * msg );
+	bool CopyEntry( unsigned int ticket, LogEntry& copy );
+	void PrintRange( objectID id );
 
+	const char* GetEventName( LogEntry& entry );
 	void PrintLogEntry( LogEntry& entry );
 
+	Slot m_log[DEBUG_LOG_CAPACITY];
+	std::atomic<unsigned int> m_next;		//Next ticket to hand out
+	bool m_echo;
+
 };
@@ -65,6 +65,7 @@ public:
 	//Body component
 	void CreateBody( int health, D3DXVECTOR3& pos );
 	inline Body& GetBody( void )					{ ASSERTMSG(m_body, "GameObject::GetBody - m_body not set"); return( *m_body ); }
+	inline bool HasBody( void )						{ return( m_body != 0 ); }
 
 	//Tiny
 	void CreateTiny( CMultiAnim *pMA, std::vector< CTiny* > *pv_pChars, CSoundManager *pSM, double dTimeCurrent );
@@ -60,6 +60,10 @@ enum SampleTestStatus
 #define g_random Singleton<Random>::GetInstance()
 #define g_tests Singleton<PathfindingTests>::GetInstance()
 #define g_movement_algo Singleton<AStar::MovementAlgo>::GetInstance()
+#define g_cluster_graph Singleton<AStar::ClusterGraph>::GetInstance()
+#define g_path_requests Singleton<AStar::PathRequestQueue>::GetInstance()
+#define g_search_scheduler Singleton<AStar::SearchScheduler>::GetInstance()
+#define g_path_cache Singleton<AStar::PathCache>::GetInstance()
 
 #define INVALID_OBJECT_ID 0
 #define SYSTEM_OBJECT_ID 1
@@ -23,7 +23,12 @@ Movement::Movement(GameObject& owner)
 	m_aStarUsesAnalysis(false),
 	m_heuristicWeight(1.0f),
 	m_heuristicCalc(0),
-	m_debugDraw(true)
+	m_searchAlgorithm(0),
+	m_debugDraw(true),
+	m_batchPathing(false),
+	m_timeSliced(false),
+	m_pathTicket(0),
+	m_pathCaching(false)
 {
 	m_target.x = m_target.y = m_target.z = 0.0f;
 }
@@ -12,8 +12,6 @@
 
 class GameObject;
 
-typedef std::list<D3DXVECTOR3> WaypointList;
-
 enum MovementMode
 {
 	MOVEMENT_NULL,
@@ -56,6 +54,8 @@ public:
 	float GetHeuristicWeight() const                        { return m_heuristicWeight; }
 	void SetHeuristicCalc(int value)						{ m_heuristicCalc = value; }
 	int GetHeuristicCalc() const                            { return m_heuristicCalc; }
+	void SetSearchAlgorithm(int value)						{ m_searchAlgorithm = value; }
+	int GetSearchAlgorithm() const                          { return m_searchAlgorithm; }
 	void SetSmoothPath(bool enable)						{ m_smooth = enable; }
 	bool GetSmoothPath() const                              { return m_smooth; }
 	void SetRubberbandPath(bool enable)					{ m_rubberband = enable; }
@@ -70,6 +70,12 @@ public:
 	bool GetAnalysis() const                                { return m_aStarUsesAnalysis; }
 	void SetDebugDraw(bool enable)							{ m_debugDraw = enable; }
 	bool GetDebugDraw() const								{ return m_debugDraw; }
+	void SetBatchPathing(bool enable)						{ m_batchPathing = enable; }
+	bool GetBatchPathing() const							{ return m_batchPathing; }
+	void SetTimeSliced(bool enable)							{ m_timeSliced = enable; }
+	bool GetTimeSliced() const								{ return m_timeSliced; }
+	void SetPathCaching(bool enable)						{ m_pathCaching = enable; }
+	bool GetPathCaching() const								{ return m_pathCaching; }
 
 protected:
 	GameObject* m_owner;
@@ -82,6 +88,7 @@ protected:
 	bool m_aStarUsesAnalysis;
 	float m_heuristicWeight;
 	int m_heuristicCalc;
+	int m_searchAlgorithm;
 	MovementMode m_movementMode;
 
 	D3DXVECTOR3 m_target;
@@ -94,5 +101,13 @@ protected:
 
 	bool m_debugDraw;
 
+	// searches go through the path request queue or the search scheduler and finish on a later frame
+	bool m_batchPathing;
+	bool m_timeSliced;
+	unsigned m_pathTicket;
+
+	// searches on this thread check the path cache first and store what they find
+	bool m_pathCaching;
+
 	bool ComputePath(int r, int c, bool newRequest);
 };
\ No newline at end of file
@@ -9,6 +9,10 @@
  */
 #include <Stdafx.h>
 #include "Astar.h"
+#include "ClusterGraph.h"
+#include "PathRequestQueue.h"
+#include "SearchScheduler.h"
+#include "PathCache.h"
 
 bool Movement::ComputePath( int r, int c, bool newRequest )
 {
@@ -32,8 +36,9 @@ bool Movement::ComputePath( int r, int c, bool newRequest )
     
     if (newRequest)
     {
-      //clear previous lists
+      //size the node pool for the current map and clear previous lists
       m_waypointList.clear();
+      g_algo.SetBounds(terrain.GetWidth());
       g_algo.openlist.clear();
 
       //store the goal
@@ -51,13 +56,14 @@ bool Movement::ComputePath( int r, int c, bool newRequest )
 
       //init variables
       g_algo.heur = static_cast<Heuristic>(m_heuristicCalc);
+      g_algo.algorithm = static_cast<Algorithm>(m_searchAlgorithm);
       g_algo.isSingleStep = m_singleStep;
       g_algo.h_weight = m_heuristicWeight;
-      g_movement_algo.SetBounds(g_terrain.GetWidth());
+      g_algo.nodesExpanded = 0;
 
-      //push start node onto openlist, gcost is zero, parent is nullptr
+      //push start node onto openlist, gcost is zero, no parent
       float s_cost = g_algo.GetHCost(start, goal) * m_heuristicWeight;
-      g_algo.openlist.push(AStarNode(start, nullptr, s_cost, 0.f, Open));
+      g_algo.openlist.push(start, NO_PARENT, s_cost, 0.f);
     }
 
     if (m_straightline)
@@ -71,13 +77,57 @@ bool Movement::ComputePath( int r, int c, bool newRequest )
       }
     }
 
+    //hierarchical paths are close to optimal but not optimal, so they stay out of the cache
+    bool useCache = m_pathCaching && g_algo.algorithm != HierarchicalSearch;
+    bool cached = false;
+
     //run pathfinding
     bool isComplete;
-    isComplete =  g_algo.PathFind(m_waypointList);
+    if (useCache && newRequest && g_path_cache.Lookup(g_algo.start, g_algo.goal, g_algo.heur, m_heuristicWeight, m_waypointList))
+    {
+      cached = true;
+      isComplete = true;
+    }
+    else if (m_batchPathing)
+    {
+      //the queue searches everything submitted this frame at the start of the next one
+      if (newRequest)
+      {
+        g_path_requests.Cancel(m_pathTicket);
+        m_pathTicket = g_path_requests.Submit(PathRequest(g_algo.start, g_algo.goal, g_algo.heur, m_heuristicWeight, g_algo.algorithm));
+      }
+      isComplete = g_path_requests.Collect(m_pathTicket, m_waypointList);
+      if (isComplete)
+        m_pathTicket = NO_TICKET;
+    }
+    else if (m_timeSliced)
+    {
+      //the scheduler spreads the search over as many frames as the shared budget needs
+      if (newRequest)
+      {
+        g_search_scheduler.Cancel(m_pathTicket);
+        m_pathTicket = g_search_scheduler.Submit(PathRequest(g_algo.start, g_algo.goal, g_algo.heur, m_heuristicWeight, g_algo.algorithm));
+      }
+      isComplete = g_search_scheduler.Collect(m_pathTicket, m_waypointList);
+      if (isComplete)
+        m_pathTicket = NO_TICKET;
+    }
+    else if (g_algo.algorithm == HierarchicalSearch)
+    {
+      //cluster graph catches up with any walls placed since the last request
+      g_cluster_graph.Update(*terrain.GetMap());
+      isComplete = g_cluster_graph.PathFind(g_algo.start, g_algo.goal, m_waypointList);
+    }
+    else
+      isComplete =  g_algo.PathFind(m_waypointList);
 
     //if path is complete 
     if (isComplete)
     {
+      //remember the raw path before it gets rubberbanded and smoothed
+      if (useCache && !cached)
+        g_path_cache.Store(g_algo.start, g_algo.goal, g_algo.heur, m_heuristicWeight, m_waypointList);
+
       //rubberbanding
       if (m_rubberband)
         g_algo.RubberbandPath(m_waypointList);
@@ -112,8 +112,6 @@ private:
 
 class MSG_Object
 {
-	friend struct CompareMsg;
-
 public:
 
 	MSG_Object( void );
@@ -20,6 +20,7 @@ REGISTER_MESSAGE_NAME(MSG_CHANGE_SUBSTATE_DELAYED)		//Reserved message name
 REGISTER_MESSAGE_NAME(MSG_SetGoal)
 REGISTER_MESSAGE_NAME(MSG_SetHeuristicWeight)
 REGISTER_MESSAGE_NAME(MSG_SetHeuristicCalc)
+REGISTER_MESSAGE_NAME(MSG_SetSearchAlgorithm)
 REGISTER_MESSAGE_NAME(MSG_SetSmoothing)
 REGISTER_MESSAGE_NAME(MSG_SetRubberbanding)
 REGISTER_MESSAGE_NAME(MSG_SetStraightline)
@@ -47,6 +48,7 @@ REGISTER_MESSAGE_NAME(MSG_RunDefaultTest1)
 REGISTER_MESSAGE_NAME(MSG_RunDefaultTest2)
 REGISTER_MESSAGE_NAME(MSG_RunAllTests)
 REGISTER_MESSAGE_NAME(MSG_CreateSampleTests)
+REGISTER_MESSAGE_NAME(MSG_RunBenchmarks)
 REGISTER_MESSAGE_NAME(MSG_MapChange)
 REGISTER_MESSAGE_NAME(MSG_ExtraCredit)
 
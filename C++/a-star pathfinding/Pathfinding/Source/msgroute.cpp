@@ -10,31 +10,9 @@
 
 #include <Stdafx.h>
 
-bool CompareMsg::operator()(const MSG_Object *lhs, const MSG_Object *rhs)
-{
-	if (Near(lhs->m_deliveryTime, rhs->m_deliveryTime))
-	{
-		if (lhs->m_sender == rhs->m_sender)
-		{
-			if (lhs->m_receiver == rhs->m_receiver)
-			{
-				return false;
-			}
-			else if (lhs->m_receiver < rhs->m_receiver)
-				return true;
-			else
-				return false;
-		}
-		else if (lhs->m_sender < rhs->m_sender)
-			return true;
-		else
-			return false;
-	}
-	else if (lhs->m_deliveryTime < rhs->m_deliveryTime)
-		return true;
-	else
-		return false;
-}
+//Worker whose buffer takes this thread's calls, -1 outside a phase, and the object it is updating
+static thread_local int s_deferredWorker = -1;
+static thread_local unsigned int s_deferredObject = 0;
 
 /*---------------------------------------------------------------------------*
   Name:         MsgRoute
@@ -54,14 +32,7 @@ MsgRoute::MsgRoute( void )
  *---------------------------------------------------------------------------*/
 MsgRoute::~MsgRoute( void )
 {
-	for( MessageContainer::iterator i=m_delayedMessages.begin(); i!=m_delayedMessages.end(); ++i )
-	{
-		MSG_Object * msg = *i;
-		delete( msg );
-	}
-
-	m_delayedMessages.clear();
-
+	m_delayedMessages.Clear();
 }
 
 
@@ -83,19 +54,28 @@ MsgRoute::~MsgRoute( void )
 				timer    : if this message is a timer (sent periodically)
 				cc       : if this message is a CC (a copy)
 
-  Returns:      None.
+  Returns:      A handle to cancel a delayed message with, or
+				INVALID_TIMER_HANDLE if the message was delivered immediately.
  *---------------------------------------------------------------------------*/
-void MsgRoute::SendMsg( float delay, MSG_Name name,
-						objectID receiver, objectID sender,
-						Scope_Rule rule, unsigned int scope,
-						StateMachineQueue queue, MSG_Data& data, 
-						bool timer, bool cc )
+TimerHandle MsgRoute::SendMsg( float delay, MSG_Name name,
+							   objectID receiver, objectID sender,
+							   Scope_Rule rule, unsigned int scope,
+							   StateMachineQueue queue, MSG_Data& data, 
+							   bool timer, bool cc )
 {
+	DeferredCall* call = Defer( DEFERRED_SEND );
+	if( call )
+	{	//Sent when the phase ends, so there is no handle to give back yet
+		call->m_delay = delay;
+		call->m_msg = MSG_Object( 0.0f, name, sender, receiver, rule, scope, queue, data, timer, cc );
+		return( INVALID_TIMER_HANDLE );
+	}
 
 	if( delay <= 0.0f )
 	{	//Deliver immediately
 		MSG_Object msg( g_clock.GetCurTime(), name, sender, receiver, rule, scope, queue, data, timer, cc );
 		RouteMsg( msg );
+		return( INVALID_TIMER_HANDLE );
 	}
 	else
 	{	
@@ -142,16 +122,8 @@ void MsgRoute::SendMsg( float delay, MSG_Name name,
 //#endif
 		
 		//Store in delivery list
-		MSG_Object * msg = new MSG_Object( deliveryTime, name, sender, receiver, rule, scope, queue, data, timer, false );
-		//if( m_delayedMessages.empty() || deliveryTime <= m_delayedMessages.front()->GetDeliveryTime() )
-		//{	//Put at the front if the list is empty or the delivery time is sooner than the first entry
-		//	m_delayedMessages.push_front( msg );
-		//}
-		//else
-		{
-			//m_delayedMessages.insert( insertPosition, msg );
-			m_delayedMessages.insert(msg);
-		}
+		MSG_Object msg( deliveryTime, name, sender, receiver, rule, scope, queue, data, timer, false );
+		return( m_delayedMessages.Schedule( msg ) );
 	}
 }
 
@@ -166,18 +138,10 @@ void MsgRoute::SendMsg( float delay, MSG_Name name,
  *---------------------------------------------------------------------------*/
 bool MsgRoute::VerifyDelayedMessageOrder( void )
 {	//Test for order - time complexity O(n)
-	float lastDeliveryTime = 0;
-
-	MessageContainer::iterator i;
-	for( i=m_delayedMessages.begin(); i!=m_delayedMessages.end(); ++i )
+	if( !m_delayedMessages.VerifyOrder() )
 	{
-		float time = (*i)->GetDeliveryTime();
-		if( time < lastDeliveryTime )
-		{
-			ASSERTMSG( 0, "MsgRoute::VerifyDelayedMessageOrder - Message list not in order" );
-			return false;
-		}
-		lastDeliveryTime = (*i)->GetDeliveryTime();
+		ASSERTMSG( 0, "MsgRoute::VerifyDelayedMessageOrder - Message list not in order" );
+		return false;
 	}
 
 	return true;
@@ -196,17 +160,25 @@ bool MsgRoute::VerifyDelayedMessageOrder( void )
 
 void MsgRoute::SendMsgBroadcast( MSG_Object & msg, unsigned int type )
 {
-	dbCompositionList list;
-	g_database.ComposeList( list, type );
+	DeferredCall* call = Defer( DEFERRED_BROADCAST );
+	if( call )
+	{
+		call->m_value = type;
+		call->m_msg = msg;
+		return;
+	}
+
+	//Walked by index, objects stored by a receiver don't get this message
+	const dbCompositionList& list = g_database.GetObjectsOfType( type );
 
-	dbCompositionList::iterator i;
-	for( i=list.begin(); i!=list.end(); ++i )
+	for( unsigned int i=0, count=list.size(); i<count; ++i )
 	{
-		if( msg.GetSender() != (*i)->GetID() )
+		GameObject* object = list[i];
+		if( msg.GetSender() != object->GetID() )
 		{
-			if((*i)->GetStateMachineManager())
+			if(object->GetStateMachineManager())
 			{
-				(*i)->GetStateMachineManager()->SendMsg( msg );
+				object->GetStateMachineManager()->SendMsg( msg );
 			}
 		}
 	}
@@ -223,30 +195,25 @@ void MsgRoute::SendMsgBroadcast( MSG_Object & msg, unsigned int type )
  *---------------------------------------------------------------------------*/
 void MsgRoute::DeliverDelayedMessages( void )
 {
+	if( g_clock.GetQPCFrequency() <= 0.0 ) {
+		g_clock.UpdateQPCFrequency();
+	}
+
+	//The frequency is in counts per millisecond
 	double timeStart = g_clock.GetHighestResolutionTime();
+	double timeLimit = m_loadBalancingTimeLimit * 1000.0 * g_clock.GetQPCFrequency();
 
-	MessageContainer::iterator i = m_delayedMessages.begin();
-	while( i != m_delayedMessages.end() )
-	{
-		if( (*i)->GetDeliveryTime() <= g_clock.GetCurTime() )
-		{	//Deliver and delete msg
-			MSG_Object * msg = *i;
-			RouteMsg( *msg );
-			delete( msg );
-			i = m_delayedMessages.erase( i );
-		}
-		else
-		{	//All messages beyond this one are not ready to fire, since the list is sorted
-			return;
-		}
+	MSG_Object msg;
+	while( m_delayedMessages.PopDue( g_clock.GetCurTime(), msg ) )
+	{	//Deliver the copy, the message is already out of the wheel
+		RouteMsg( msg );
 
 		//Decide whether to stop sending for this frame
 		double curTime = g_clock.GetHighestResolutionTime();
-		if( curTime - timeStart > m_loadBalancingTimeLimit )
+		if( curTime - timeStart > timeLimit )
 		{
 			return;
 		}
-
 	}
 }
 
@@ -310,23 +277,30 @@ void MsgRoute::RouteMsg( MSG_Object & msg )
  *---------------------------------------------------------------------------*/
 void MsgRoute::RemoveMsg( MSG_Name name, objectID receiver, objectID sender, bool timer )
 {
-	MessageContainer::iterator i = m_delayedMessages.begin();
-	while( i != m_delayedMessages.end() )
+	DeferredCall* call = Defer( DEFERRED_REMOVE );
+	if( call )
 	{
-		MSG_Object * msg = *i;
+		call->m_msg.SetName( name );
+		call->m_msg.SetReceiver( receiver );
+		call->m_msg.SetSender( sender );
+		call->m_msg.SetTimer( timer );
+		return;
+	}
+
+	//Only the receiver's messages are looked at
+	TimerHandle handle = m_delayedMessages.GetFirst( receiver );
+	while( handle != INVALID_TIMER_HANDLE )
+	{
+		TimerHandle next = m_delayedMessages.GetNext( handle );
+		MSG_Object * msg = m_delayedMessages.Get( handle );
 		if( msg->GetName() == name &&
-			msg->GetReceiver() == receiver &&
 			msg->GetSender() == sender &&
 			msg->IsTimer() == timer &&
 			!msg->IsDelivered() )
 		{
-			delete( msg );
-			i = m_delayedMessages.erase( i );
-		}
-		else
-		{
-			++i;
+			m_delayedMessages.Cancel( handle );
 		}
+		handle = next;
 	}
 }
 
@@ -345,25 +319,171 @@ void MsgRoute::RemoveMsg( MSG_Name name, objectID receiver, objectID sender, boo
  *---------------------------------------------------------------------------*/
 void MsgRoute::PurgeScopedMsg( objectID receiver, StateMachineQueue queue )
 {
-	MessageContainer::iterator i = m_delayedMessages.begin();
-	while( i != m_delayedMessages.end() )
+	DeferredCall* call = Defer( DEFERRED_PURGE );
+	if( call )
+	{
+		call->m_value = queue;
+		call->m_msg.SetReceiver( receiver );
+		return;
+	}
+
+	//Only the receiver's messages are looked at
+	TimerHandle handle = m_delayedMessages.GetFirst( receiver );
+	while( handle != INVALID_TIMER_HANDLE )
 	{
-		MSG_Object * msg = *i;
-		if( msg->GetReceiver() == receiver &&
-			msg->GetQueue() == queue &&
+		TimerHandle next = m_delayedMessages.GetNext( handle );
+		MSG_Object * msg = m_delayedMessages.Get( handle );
+		if( msg->GetQueue() == queue &&
 			msg->GetScopeRule() != SCOPE_TO_STATE_MACHINE &&
 			!msg->IsDelivered() )
 		{
-			delete( msg );
-			i = m_delayedMessages.erase( i );
+			m_delayedMessages.Cancel( handle );
 		}
-		else
-		{
-			++i;
+		handle = next;
+	}
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         CancelMsg
+
+  Description:  Cancels a delayed message.
+
+  Arguments:    handle : the handle SendMsg returned for the message
+
+  Returns:      Whether the message was still waiting. Inside a phase the
+				cancel waits for the phase to end and this returns true.
+ *---------------------------------------------------------------------------*/
+bool MsgRoute::CancelMsg( TimerHandle handle )
+{
+	DeferredCall* call = Defer( DEFERRED_CANCEL );
+	if( call )
+	{
+		call->m_value = handle;
+		return( true );
+	}
+
+	return( m_delayedMessages.Cancel( handle ) );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         BeginPhase
+
+  Description:  Starts buffering calls for a phased update.
+
+  Arguments:    objects : the number of objects the phase updates
+				workers : the highest worker number that will take calls
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void MsgRoute::BeginPhase( unsigned int objects, unsigned int workers )
+{
+	if( m_deferred.size() < workers + 1 ) {
+		m_deferred.resize( workers + 1 );
+	}
+	for( unsigned int i = 0; i < m_deferred.size(); ++i ) {
+		m_deferred[i].m_calls.clear();
+	}
+
+	DeferredSpan empty = { 0, 0, 0 };
+	m_spans.assign( objects, empty );
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         BeginDeferred
+
+  Description:  Buffers the calls made on this thread until EndDeferred, as
+				made by one object of the phase. Called on the worker thread.
+
+  Arguments:    worker : the worker number of this thread
+				object : the index of the object in the phase's update order
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void MsgRoute::BeginDeferred( unsigned int worker, unsigned int object )
+{
+	unsigned int first = static_cast<unsigned int>( m_deferred[worker].m_calls.size() );
+	DeferredSpan span = { worker, first, first };
+	m_spans[object] = span;
+
+	s_deferredWorker = static_cast<int>( worker );
+	s_deferredObject = object;
+}
+
+void MsgRoute::EndDeferred( void )
+{
+	m_spans[s_deferredObject].m_last = static_cast<unsigned int>( m_deferred[s_deferredWorker].m_calls.size() );
+	s_deferredWorker = -1;
+}
+
+/*---------------------------------------------------------------------------*
+  Name:         EndPhase
+
+  Description:  Makes the buffered calls, object by object in update order
+				and each object's in the order it made them. Delayed messages
+				get the same delivery order as if the objects had updated one
+				after another. Messages sent to be delivered now arrive here,
+				after every object has updated.
+
+  Arguments:    None.
+
+  Returns:      None.
+ *---------------------------------------------------------------------------*/
+void MsgRoute::EndPhase( void )
+{
+	for( unsigned int i = 0; i < m_spans.size(); ++i )
+	{
+		DeferredSpan& span = m_spans[i];
+		std::vector<DeferredCall>& calls = m_deferred[span.m_worker].m_calls;
+		for( unsigned int call = span.m_first; call < span.m_last; ++call ) {
+			Replay( calls[call] );
 		}
 	}
+
+	for( unsigned int i = 0; i < m_deferred.size(); ++i ) {
+		m_deferred[i].m_calls.clear();
+	}
+	m_spans.clear();
+}
+
+MsgRoute::DeferredCall* MsgRoute::Defer( DeferredCallType type )
+{
+	if( s_deferredWorker < 0 ) {
+		return( 0 );
+	}
+
+	std::vector<DeferredCall>& calls = m_deferred[s_deferredWorker].m_calls;
+	calls.push_back( DeferredCall() );
+	calls.back().m_type = type;
+	return( &calls.back() );
 }
 
+void MsgRoute::Replay( DeferredCall & call )
+{
+	MSG_Object& msg = call.m_msg;
+	switch( call.m_type )
+	{
+		case DEFERRED_SEND:
+			SendMsg( call.m_delay, msg.GetName(), msg.GetReceiver(), msg.GetSender(), msg.GetScopeRule(), msg.GetScope(),
+			         (StateMachineQueue)msg.GetQueue(), msg.GetMsgData(), msg.IsTimer(), msg.IsCC() );
+			break;
+
+		case DEFERRED_BROADCAST:
+			SendMsgBroadcast( msg, call.m_value );
+			break;
 
+		case DEFERRED_REMOVE:
+			RemoveMsg( msg.GetName(), msg.GetReceiver(), msg.GetSender(), msg.IsTimer() );
+			break;
 
+		case DEFERRED_PURGE:
+			PurgeScopedMsg( msg.GetReceiver(), (StateMachineQueue)call.m_value );
+			break;
 
+		case DEFERRED_CANCEL:
+			m_delayedMessages.Cancel( call.m_value );
+			break;
+
+		default:
+			ASSERTMSG( 0, "MsgRoute::Replay - Invalid deferred call." );
+	}
+}
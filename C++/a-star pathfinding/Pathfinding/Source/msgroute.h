@@ -10,18 +10,9 @@
 
 #pragma once
 
-#include <set>
-
 //Forward declaration
 enum StateMachineQueue;
 
-struct CompareMsg
-{
-	bool operator()(const MSG_Object *lhs, const MSG_Object *rhs);
-};
-
-typedef std::set<MSG_Object*, CompareMsg> MessageContainer;
-
 class MsgRoute
 {
 public:
@@ -31,27 +22,75 @@ public:
 
 	void DeliverDelayedMessages( void );
 
-	void SendMsg( float delay, MSG_Name name,
-	              objectID receiver, objectID sender, 
-	              Scope_Rule rule, unsigned int scope,
-	              StateMachineQueue queue, MSG_Data& data, 
-				  bool timer, bool cc );
+	TimerHandle SendMsg( float delay, MSG_Name name,
+	                     objectID receiver, objectID sender, 
+	                     Scope_Rule rule, unsigned int scope,
+	                     StateMachineQueue queue, MSG_Data& data, 
+				         bool timer, bool cc );
 	
 	void SendMsgBroadcast( MSG_Object & msg, unsigned int type = 0 );
 
 	//Delayed message load balancing
 	inline void SetLoadBalancingConstraint(float maxTimePerFrameInSeconds)	{ m_loadBalancingTimeLimit = maxTimePerFrameInSeconds; }
+	inline float GetLoadBalancingConstraint( void )						{ return( m_loadBalancingTimeLimit ); }
 	
 	//Removing delayed messages
+	bool CancelMsg( TimerHandle handle );
 	void RemoveMsg( MSG_Name name, objectID receiver, objectID sender, bool timer );
 	void PurgeScopedMsg( objectID receiver, StateMachineQueue queue );
 
+	inline unsigned int GetDelayedMessageCount( void )	{ return( m_delayedMessages.GetSize() ); }
+	inline unsigned int GetAllocationCount( void )		{ return( m_delayedMessages.GetAllocationCount() ); }
+
 	//For testing (unit tests)
 	bool VerifyDelayedMessageOrder( void );
 
+	//Phased updates (see Database::UpdatePhased). Between BeginDeferred and
+	//EndDeferred, calls made on that thread are buffered instead of routed,
+	//and EndPhase runs them in the order of the objects that made them.
+	void BeginPhase( unsigned int objects, unsigned int workers );
+	void BeginDeferred( unsigned int worker, unsigned int object );
+	void EndDeferred( void );
+	void EndPhase( void );
+
 private:
 
-	MessageContainer m_delayedMessages;
+	enum DeferredCallType
+	{
+		DEFERRED_SEND,
+		DEFERRED_BROADCAST,
+		DEFERRED_REMOVE,
+		DEFERRED_PURGE,
+		DEFERRED_CANCEL
+	};
+
+	struct DeferredCall
+	{
+		DeferredCallType m_type;
+		float m_delay;
+		unsigned int m_value;			//Broadcast type, queue or timer handle
+		MSG_Object m_msg;				//The message, or the fields to match
+	};
+
+	struct DeferredBuffer
+	{
+		std::vector<DeferredCall> m_calls;
+		char m_padding[64];				//Keeps the workers' buffers off each other's cache lines
+	};
+
+	struct DeferredSpan
+	{
+		unsigned int m_worker;
+		unsigned int m_first, m_last;	//The object's calls in its worker's buffer
+	};
+
+	DeferredCall* Defer( DeferredCallType type );
+	void Replay( DeferredCall & call );
+
+	std::vector<DeferredBuffer> m_deferred;		//One per worker
+	std::vector<DeferredSpan> m_spans;			//One per object in the phase, in update order
+
+	TimingWheel m_delayedMessages;
 	float m_loadBalancingTimeLimit;
 
 	void RouteMsg( MSG_Object & msg );	
@@ -12,6 +12,7 @@
 
 #define MAX_STATE_STACK_SIZE 10
 
+bool StateMachine::s_skipUnregisteredMsgs = true;
 
 
 StateMachine::StateMachine( GameObject & object )
@@ -53,12 +54,17 @@ void StateMachine::Initialize( void )
 	m_delayedSubstateChangeQueued = false;
 	m_stateChangeAllowed = true;
 	m_registeredEvents = 0;
+	m_substateMsgs.Clear();
+	m_stateMsgs.Clear();
+	m_stateMachineMsgs.Clear();
 	m_timeOnEnterState = 0.0f;
 	m_timeOnEnterSubstate = 0.0f;
 	m_ccMessagesToGameObject = 0;
 
 	m_currentStateNameString[0] = 0;
 	m_currentSubstateNameString[0] = 0;
+	m_probedStateName = "";
+	m_probedSubstateName = "";
   
 	m_broadcastList.clear();
 	m_stack.clear();
@@ -145,21 +151,57 @@ void StateMachine::Process( State_Machine_Event event, MSG_Object * msg )
 		bool handled = false;
 		if( m_currentSubstate >= 0 )
 		{	//Send to current substate
-			handled = States( event, msg, m_currentState, m_currentSubstate );
+			handled = ProcessScope( event, msg, m_currentState, m_currentSubstate, m_substateMsgs );
 		}
 		if( !handled )
 		{	//Send to current state
-			handled = States( event, msg, m_currentState, -1 );
+			handled = ProcessScope( event, msg, m_currentState, -1, m_stateMsgs );
 		}
 		if( !handled )
 		{	//Send to global state
-			handled = States( event, msg, -1, -1 );
+			handled = ProcessScope( event, msg, -1, -1, m_stateMachineMsgs );
 		}
 		
 		PerformStateChanges();
 	}
 }
 
+/*---------------------------------------------------------------------------*
+  Name:         ProcessScope
+
+  Description:  Sends an event to one scope of the state machine. A message
+				the scope registered no handler for on EVENT_Probe is
+				unhandled without walking the scope's handlers.
+
+  Arguments:    event    : the event to process
+				msg      : an optional msg to process with the event
+				state    : the state of the scope (-1 for the global state)
+				substate : the substate of the scope (-1 for none)
+				msgs     : the messages the scope has handlers for
+
+  Returns:      If the event was handled.
+ *---------------------------------------------------------------------------*/
+bool StateMachine::ProcessScope( State_Machine_Event event, MSG_Object * msg, int state, int substate, RegisteredMsgs & msgs )
+{
+	if( EVENT_Message != event || !msg || !s_skipUnregisteredMsgs || msgs.IsRegistered( msg->GetName() ) ) {
+		return( States( event, msg, state, substate ) );
+	}
+
+#ifdef DEBUG_STATE_MACHINE_MACROS
+	//Log the same entry the scope would have
+	if( state < 0 ) {
+		g_debuglog.LogStateMachineUnhandledEvent( m_owner->GetID(), msg, "STATE_Global", "", event );
+	}
+	else if( substate < 0 ) {
+		g_debuglog.LogStateMachineUnhandledEvent( m_owner->GetID(), msg, m_probedStateName, "", event );
+	}
+	else {
+		g_debuglog.LogStateMachineUnhandledEvent( m_owner->GetID(), msg, "", m_probedSubstateName, event );
+	}
+#endif
+	return( false );
+}
+
 /*---------------------------------------------------------------------------*
   Name:         PerformStateChanges
 
@@ -213,7 +255,7 @@ void StateMachine::PerformStateChanges( void )
 				m_currentState = m_nextState;
 				m_currentSubstate = m_nextSubstate;
 #ifdef DEBUG_STATE_MACHINE_MACROS
-				g_debuglog.LogStateMachineStateChange( m_owner->GetID(), m_owner->GetName(), m_currentState, m_currentSubstate );
+				g_debuglog.LogStateMachineStateChange( m_owner->GetID(), m_currentState, m_currentSubstate );
 #endif
 				break;
 				
@@ -228,7 +270,7 @@ void StateMachine::PerformStateChanges( void )
 					ASSERTMSG( 0, "StateMachine::PerformStateChanges - Hit bottom of state stack. Can't pop state." );
 				}
 #ifdef DEBUG_STATE_MACHINE_MACROS
-				g_debuglog.LogStateMachineStateChange( m_owner->GetID(), m_owner->GetName(), m_currentState, m_currentSubstate );
+				g_debuglog.LogStateMachineStateChange( m_owner->GetID(), m_currentState, m_currentSubstate );
 #endif
 				break;
 			
@@ -261,10 +303,13 @@ void StateMachine::PerformStateChanges( void )
 		if( m_nextSubstate < 0 )
 		{	//Moving to a state
 			m_registeredEvents &= REGISTERED_EVENT_STATEMACHINE;	//Only keep state machine bits
+			m_stateMsgs.Clear();
+			m_substateMsgs.Clear();
 		}
 		else
 		{	//Moving to a substate
 			m_registeredEvents &= (REGISTERED_EVENT_STATE | REGISTERED_EVENT_STATEMACHINE);	//Only keep state and state machine bits
+			m_substateMsgs.Clear();
 		}
 
 		States( EVENT_Probe, 0, static_cast<int>( m_currentState ), m_currentSubstate );
@@ -1493,13 +1538,14 @@ void StateMachineManager::Update( void )
 /*---------------------------------------------------------------------------*
   Name:         SendMsg
 
-  Description:  Sends a message to the currently active state machine in each queue
+  Description:  Sends a message to the currently active state machine in each
+				queue. The message is passed along by reference, not copied.
 
-  Arguments:    MSG_Object
+  Arguments:    msg : the message
 
   Returns:      None.
  *---------------------------------------------------------------------------*/
-void StateMachineManager::SendMsg( MSG_Object msg )
+void StateMachineManager::SendMsg( MSG_Object & msg )
 {
 	for( int queue=0; queue<STATE_MACHINE_NUM_QUEUES; ++queue )
 	{
@@ -22,24 +22,23 @@ class Trigger;
 
 #define DEBUG_STATE_MACHINE_MACROS		//Comment out to get the release macros (no string state/substate names and no debug logging info)
 #ifdef DEBUG_STATE_MACHINE_MACROS
-	#define BEGIN_STATE_MACHINE_ADDITIONAL_DEBUG_1				char eventbuffer[5];
-	#define BEGIN_STATE_MACHINE_ADDITIONAL_DEBUG_2				const char statename[MAX_STATE_NAME_SIZE] = "STATE_Global"; const char substatename[MAX_STATE_NAME_SIZE] = "";
-	#define END_STATE_MACHINE_ADDITIONAL_DEBUG_1				g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, itoa(event, eventbuffer, 10), false );
-	#define DECLARE_STATE_ADDITIONAL_DEBUG_1					g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, itoa(event, eventbuffer, 10), false );
-	#define DECLARE_STATE_ADDITIONAL_DEBUG_2(name)				int DUPLICATE_DeclareState_ ## name = 0;
-	#define DECLARE_STATE_ADDITIONAL_DEBUG_3(name)				const char statename[MAX_STATE_NAME_SIZE] = #name; const char substatename[MAX_STATE_NAME_SIZE] = ""; int verifystatecontext = 0; if( EVENT_Enter == event ) { SetCurrentStateName( #name ); } if( EVENT_Probe == event ) { RegisterOnEnter( state, substate ); }
-	#define DECLARE_SUBSTATE_ADDITIONAL_DEBUG_1(name)			const char statename[MAX_STATE_NAME_SIZE] = ""; const char substatename[MAX_STATE_NAME_SIZE] = #name; int verifysubstatecontext = 0; if( EVENT_Enter == event ) { SetCurrentSubstateName( #name ); } if( EVENT_Probe == event ) { RegisterOnEnter( state, substate ); } SubstateName verifysubstatename = name;
-	#define ONMSG_ADDITIONAL_DEBUG_1(msgname)					VerifyMessageEnum( msgname ); g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, #msgname, true );
-	#define ONEITHERMSG_ADDITIONAL_DEBUG_1(msgname1, msgname2)	VerifyMessageEnum( msgname1 ); VerifyMessageEnum( msgname2 ); if( msgname1 == msg->GetName() ) { g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, #msgname1, true ); } else { g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, #msgname2, true ); }
-	#define ONBOTHMSG_ADDITIONAL_DEBUG_1(msgname1, msgname2)	if( msgname1 == msg->GetName() ) { g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, #msgname1, true ); } else { g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, #msgname2, true ); }
-	#define ONANYMSG_ADDITIONAL_DEBUG_1							g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, msg->GetName(), true );
-	#define ONANYUNHANDLEDMSGDEBUGBREAK_ADDITIONAL_DEBUG_1		return( true ); } } while( false ); do { if( EVENT_Message == event && msg ) { __debugbreak();
-	#define ONCCMSG_ADDITIONAL_DEBUG_1(msgname)					g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, #msgname, true );
-	#define ONTIMEINSTATE_ADDITIONAL_DEBUG_1					g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, "MSG_GENERIC_TIMER", true );
-	#define ONEVENT_ADDITIONAL_DEBUG_1(a)						g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, #a, true );
-	#define ONNTHUPDATE_ADDITIONAL_DEBUG_1(n)					g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, "EVENT_Update", true ); COMPILE_TIME_ASSERT( n>0, argument_must_be_greater_than_zero );
-	#define ONEVERYNTHUPDATE_ADDITIONAL_DEBUG_1(n)				g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, "EVENT_Update", true ); COMPILE_TIME_ASSERT( n>1, argument_must_be_greater_than_one );
-	#define ONEVERYODDUPDATE_ADDITIONAL_DEBUG_1					g_debuglog.LogStateMachineEvent( m_owner->GetID(), m_owner->GetName(), msg, statename, substatename, "EVENT_Update", true );
+	#define BEGIN_STATE_MACHINE_ADDITIONAL_DEBUG_1
+	#define BEGIN_STATE_MACHINE_ADDITIONAL_DEBUG_2				const char* statename = "STATE_Global"; const char* substatename = "";
+	#define END_STATE_MACHINE_ADDITIONAL_DEBUG_1				g_debuglog.LogStateMachineUnhandledEvent( m_owner->GetID(), msg, statename, substatename, event );
+	#define DECLARE_STATE_ADDITIONAL_DEBUG_1					g_debuglog.LogStateMachineUnhandledEvent( m_owner->GetID(), msg, statename, substatename, event );
+	#define DECLARE_STATE_ADDITIONAL_DEBUG_2(name)				const char* statename = #name; const char* substatename = ""; int verifystatecontext = 0; if( EVENT_Enter == event ) { SetCurrentStateName( #name ); } if( EVENT_Probe == event ) { RegisterOnEnter( state, substate ); RegisterStateName( #name ); }
+	#define DECLARE_SUBSTATE_ADDITIONAL_DEBUG_1(name)			const char* statename = ""; const char* substatename = #name; int verifysubstatecontext = 0; if( EVENT_Enter == event ) { SetCurrentSubstateName( #name ); } if( EVENT_Probe == event ) { RegisterOnEnter( state, substate ); RegisterSubstateName( #name ); } SubstateName verifysubstatename = name;
+	#define ONMSG_ADDITIONAL_DEBUG_1(msgname)					VerifyMessageEnum( msgname ); g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, #msgname, true );
+	#define ONEITHERMSG_ADDITIONAL_DEBUG_1(msgname1, msgname2)	VerifyMessageEnum( msgname1 ); VerifyMessageEnum( msgname2 ); if( msgname1 == msg->GetName() ) { g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, #msgname1, true ); } else { g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, #msgname2, true ); }
+	#define ONBOTHMSG_ADDITIONAL_DEBUG_1(msgname1, msgname2)	if( msgname1 == msg->GetName() ) { g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, #msgname1, true ); } else { g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, #msgname2, true ); }
+	#define ONANYMSG_ADDITIONAL_DEBUG_1							g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, msg->GetName(), true );
+	#define ONANYUNHANDLEDMSGDEBUGBREAK_ADDITIONAL_DEBUG_1		return( true ); } } while( false ); do { if( EVENT_Probe == event ) { RegisterOnAnyMsg( state, substate ); continue; } if( EVENT_Message == event && msg ) { __debugbreak();
+	#define ONCCMSG_ADDITIONAL_DEBUG_1(msgname)					g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, #msgname, true );
+	#define ONTIMEINSTATE_ADDITIONAL_DEBUG_1					g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, "MSG_GENERIC_TIMER", true );
+	#define ONEVENT_ADDITIONAL_DEBUG_1(a)						g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, #a, true );
+	#define ONNTHUPDATE_ADDITIONAL_DEBUG_1(n)					g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, "EVENT_Update", true ); COMPILE_TIME_ASSERT( n>0, argument_must_be_greater_than_zero );
+	#define ONEVERYNTHUPDATE_ADDITIONAL_DEBUG_1(n)				g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, "EVENT_Update", true ); COMPILE_TIME_ASSERT( n>1, argument_must_be_greater_than_one );
+	#define ONEVERYODDUPDATE_ADDITIONAL_DEBUG_1					g_debuglog.LogStateMachineEvent( m_owner->GetID(), msg, statename, substatename, "EVENT_Update", true );
 	#define VERIFYSTATECONTEXT_ADDITIONAL_DEBUG_1				verifystatecontext;
 	#define VERIFYSUBSTATECONTEXT_ADDITIONAL_DEBUG_1			verifysubstatecontext;
 #else
@@ -48,7 +47,6 @@ class Trigger;
 	#define END_STATE_MACHINE_ADDITIONAL_DEBUG_1
 	#define DECLARE_STATE_ADDITIONAL_DEBUG_1
 	#define DECLARE_STATE_ADDITIONAL_DEBUG_2(name)
-	#define DECLARE_STATE_ADDITIONAL_DEBUG_3(name)
 	#define DECLARE_SUBSTATE_ADDITIONAL_DEBUG_1(name)
 	#define ONMSG_ADDITIONAL_DEBUG_1(msgname)
 	#define ONEITHERMSG_ADDITIONAL_DEBUG_1(msgname1, msgname2)
@@ -67,24 +65,26 @@ class Trigger;
 
 
 //State Machine Language Macros (put the keywords in the file USERTYPE.DAT in the same directory as MSDEV.EXE to get keyword highlighting)
-#define BeginStateMachine						StateName laststatedeclared; BEGIN_STATE_MACHINE_ADDITIONAL_DEBUG_1 if( state < 0 ) { BEGIN_STATE_MACHINE_ADDITIONAL_DEBUG_2 if( EVENT_Message == event && msg && MSG_CHANGE_STATE_DELAYED == msg->GetName() ) { ChangeState( static_cast<unsigned int>( msg->GetIntData() ) ); return( true ); } if( EVENT_Message == event && msg && MSG_CHANGE_SUBSTATE_DELAYED == msg->GetName() ) { ChangeSubstate( static_cast<unsigned int>( msg->GetIntData() ) ); return( true ); } do { if(0) {
-#define EndStateMachine							return( true ); } } while( false ); END_STATE_MACHINE_ADDITIONAL_DEBUG_1 return( false ); } ASSERTMSG( 0, "Invalid State" ); return( false );
+//States() switches straight to the block of the state asked for, and on EVENT_Probe each handler registers
+//the messages it takes so Process() can skip the scopes that have no handler for a message
+#define BeginStateMachine						StateName laststatedeclared; BEGIN_STATE_MACHINE_ADDITIONAL_DEBUG_1 switch( state ) { default: if( state < 0 ) { BEGIN_STATE_MACHINE_ADDITIONAL_DEBUG_2 if( EVENT_Probe == event ) { RegisterOnMsg( state, substate, MSG_CHANGE_STATE_DELAYED ); RegisterOnMsg( state, substate, MSG_CHANGE_SUBSTATE_DELAYED ); } if( EVENT_Message == event && msg && MSG_CHANGE_STATE_DELAYED == msg->GetName() ) { ChangeState( static_cast<unsigned int>( msg->GetIntData() ) ); return( true ); } if( EVENT_Message == event && msg && MSG_CHANGE_SUBSTATE_DELAYED == msg->GetName() ) { ChangeSubstate( static_cast<unsigned int>( msg->GetIntData() ) ); return( true ); } do { if(0) {
+#define EndStateMachine							return( true ); } } while( false ); END_STATE_MACHINE_ADDITIONAL_DEBUG_1 return( false ); } } ASSERTMSG( 0, "Invalid State" ); return( false );
 
-#define DeclareState(name)						return( true ); } } while( false ); DECLARE_STATE_ADDITIONAL_DEBUG_1 return( false ); } laststatedeclared = name; DECLARE_STATE_ADDITIONAL_DEBUG_2( name ) if( name == state && substate < 0 ) { int statevariableindexinternal = 0; int substatevariableindexinternal = 0; DECLARE_STATE_ADDITIONAL_DEBUG_3( name ) do { if(0) { 
+#define DeclareState(name)						return( true ); } } while( false ); DECLARE_STATE_ADDITIONAL_DEBUG_1 return( false ); } case name: laststatedeclared = name; if( name == state && substate < 0 ) { int statevariableindexinternal = 0; int substatevariableindexinternal = 0; DECLARE_STATE_ADDITIONAL_DEBUG_2( name ) do { if(0) { 
 #define DeclareSubstate(name)					return( true ); } } while( false ); return( false ); } if( laststatedeclared == state && name == substate ) { int statevariableindexinternal = 0; int substatevariableindexinternal = 0; DECLARE_SUBSTATE_ADDITIONAL_DEBUG_1(name) do { if(0) { 
 
-#define OnMsg(msgname)							return( true ); } } while( false ); do { if( EVENT_Message == event && msg && msgname == msg->GetName() ) { ONMSG_ADDITIONAL_DEBUG_1( msgname )
-#define OnEitherMsg(msgname1, msgname2)			return( true ); } } while( false ); do { if( EVENT_Message == event && msg && (msgname1 == msg->GetName() || msgname2 == msg->GetName()) ) { ONEITHERMSG_ADDITIONAL_DEBUG_1( msgname1, msgname2 )
-#define OnBothMsg(msgname1, msgname2)			return( true ); } } while( false ); int variableindexinternal__ ## msgname1 ## msgname2; StateVariableScope onbothmsgvariablescope__ ## msgname1 ## msgname2; if( substate < 0 ) { variableindexinternal__ ## msgname1 ## msgname2 = statevariableindexinternal++; onbothmsgvariablescope__ ## msgname1 ## msgname2 = STATE_VARIABLE_SCOPE; } else { variableindexinternal__ ## msgname1 ## msgname2 = substatevariableindexinternal++; onbothmsgvariablescope__ ## msgname1 ## msgname2 = SUBSTATE_VARIABLE_SCOPE; } StateVariableInt msgname1 ## msgname2( variableindexinternal__ ## msgname1 ## msgname2, this, onbothmsgvariablescope__ ## msgname1 ## msgname2, EVENT_Probe == event ); do { if( EVENT_Message == event && msg ) { if( msgname1 == msg->GetName() ) { msgname1 ## msgname2 |= 0x01; } if( msgname2 == msg->GetName() ) { msgname1 ## msgname2 |= 0x10; } if( msgname1 ## msgname2 != 0x11 ) { continue; } msgname1 ## msgname2 = 0; VerifyMessageEnum( msgname1 ); VerifyMessageEnum( msgname2 ); ONBOTHMSG_ADDITIONAL_DEBUG_1( msgname1, msgname2 )
-#define OnAnyMsg								return( true ); } } while( false ); do { if( EVENT_Message == event && msg ) { ONANYMSG_ADDITIONAL_DEBUG_1
+#define OnMsg(msgname)							return( true ); } } while( false ); do { if( EVENT_Probe == event ) { RegisterOnMsg( state, substate, msgname ); continue; } if( EVENT_Message == event && msg && msgname == msg->GetName() ) { ONMSG_ADDITIONAL_DEBUG_1( msgname )
+#define OnEitherMsg(msgname1, msgname2)			return( true ); } } while( false ); do { if( EVENT_Probe == event ) { RegisterOnMsg( state, substate, msgname1 ); RegisterOnMsg( state, substate, msgname2 ); continue; } if( EVENT_Message == event && msg && (msgname1 == msg->GetName() || msgname2 == msg->GetName()) ) { ONEITHERMSG_ADDITIONAL_DEBUG_1( msgname1, msgname2 )
+#define OnBothMsg(msgname1, msgname2)			return( true ); } } while( false ); int variableindexinternal__ ## msgname1 ## msgname2; StateVariableScope onbothmsgvariablescope__ ## msgname1 ## msgname2; if( substate < 0 ) { variableindexinternal__ ## msgname1 ## msgname2 = statevariableindexinternal++; onbothmsgvariablescope__ ## msgname1 ## msgname2 = STATE_VARIABLE_SCOPE; } else { variableindexinternal__ ## msgname1 ## msgname2 = substatevariableindexinternal++; onbothmsgvariablescope__ ## msgname1 ## msgname2 = SUBSTATE_VARIABLE_SCOPE; } StateVariableInt msgname1 ## msgname2( variableindexinternal__ ## msgname1 ## msgname2, this, onbothmsgvariablescope__ ## msgname1 ## msgname2, EVENT_Probe == event ); do { if( EVENT_Probe == event ) { RegisterOnMsg( state, substate, msgname1 ); RegisterOnMsg( state, substate, msgname2 ); continue; } if( EVENT_Message == event && msg ) { if( msgname1 == msg->GetName() ) { msgname1 ## msgname2 |= 0x01; } if( msgname2 == msg->GetName() ) { msgname1 ## msgname2 |= 0x10; } if( msgname1 ## msgname2 != 0x11 ) { continue; } msgname1 ## msgname2 = 0; VerifyMessageEnum( msgname1 ); VerifyMessageEnum( msgname2 ); ONBOTHMSG_ADDITIONAL_DEBUG_1( msgname1, msgname2 )
+#define OnAnyMsg								return( true ); } } while( false ); do { if( EVENT_Probe == event ) { RegisterOnAnyMsg( state, substate ); continue; } if( EVENT_Message == event && msg ) { ONANYMSG_ADDITIONAL_DEBUG_1
 #define OnAnyUnhandledMsgDebugBreak				ONANYUNHANDLEDMSGDEBUGBREAK_ADDITIONAL_DEBUG_1
 #define OnCCMsg(msgname)						return( true ); } } while( false ); do { if( EVENT_CCMessage == event && msg && msgname == msg->GetName() ) { ONCCMSG_ADDITIONAL_DEBUG_1( msgname )
 
-#define ONTIME_INTERNAL_HELPER(f, s)			return( true ); } } while( false ); do { if( EVENT_PostEnter == event ) { f( s, MSG_GENERIC_TIMER, MSG_Data( __LINE__ ) ); continue; } if( EVENT_Message == event && msg && MSG_GENERIC_TIMER == msg->GetName() && msg->GetIntData() == __LINE__ ) { ONTIMEINSTATE_ADDITIONAL_DEBUG_1
+#define ONTIME_INTERNAL_HELPER(f, s)			return( true ); } } while( false ); do { if( EVENT_Probe == event ) { RegisterOnMsg( state, substate, MSG_GENERIC_TIMER ); continue; } if( EVENT_PostEnter == event ) { f( s, MSG_GENERIC_TIMER, MSG_Data( __LINE__ ) ); continue; } if( EVENT_Message == event && msg && MSG_GENERIC_TIMER == msg->GetName() && msg->GetIntData() == __LINE__ ) { ONTIMEINSTATE_ADDITIONAL_DEBUG_1
 #define OnTimeInSubstate(s)						ONTIME_INTERNAL_HELPER( SendMsgDelayedToSubstate, s )
 #define OnTimeInState(s)						ONTIME_INTERNAL_HELPER( SendMsgDelayedToState, s )
 
-#define ONPERIODIC_INTERNAL_HELPER(f, f2, s)	return( true ); } } while( false ); do { if( EVENT_PostEnter == event || (EVENT_Message == event && msg && MSG_SPAWN_GENERIC_TIMER == msg->GetName() && msg->GetIntData() == __LINE__) ) { f( s, MSG_GENERIC_TIMER, MSG_Data( __LINE__ ) ); continue; } if( EVENT_Message == event && msg && MSG_GENERIC_TIMER == msg->GetName() && msg->GetIntData() == __LINE__ ) { f2( MSG_SPAWN_GENERIC_TIMER, MSG_Data( __LINE__ ) ); ONTIMEINSTATE_ADDITIONAL_DEBUG_1
+#define ONPERIODIC_INTERNAL_HELPER(f, f2, s)	return( true ); } } while( false ); do { if( EVENT_Probe == event ) { RegisterOnMsg( state, substate, MSG_GENERIC_TIMER ); RegisterOnMsg( state, substate, MSG_SPAWN_GENERIC_TIMER ); continue; } if( EVENT_PostEnter == event || (EVENT_Message == event && msg && MSG_SPAWN_GENERIC_TIMER == msg->GetName() && msg->GetIntData() == __LINE__) ) { f( s, MSG_GENERIC_TIMER, MSG_Data( __LINE__ ) ); continue; } if( EVENT_Message == event && msg && MSG_GENERIC_TIMER == msg->GetName() && msg->GetIntData() == __LINE__ ) { f2( MSG_SPAWN_GENERIC_TIMER, MSG_Data( __LINE__ ) ); ONTIMEINSTATE_ADDITIONAL_DEBUG_1
 #define OnPeriodicTimeInSubstate(s)				ONPERIODIC_INTERNAL_HELPER( SendMsgDelayedToSubstate, SendMsgToSubstate, s )
 #define OnPeriodicTimeInState(s)				ONPERIODIC_INTERNAL_HELPER( SendMsgDelayedToState, SendMsgToState, s )
 
@@ -223,6 +223,25 @@ private:
 };
 
 
+//Message names a state machine scope has handlers for, filled in on EVENT_Probe
+class RegisteredMsgs
+{
+public:
+	RegisteredMsgs( void )							{ Clear(); }
+
+	inline void Clear( void )						{ for( int i = 0; i < REGISTERED_MSGS_WORDS; ++i ) { m_bits[i] = 0; } m_any = false; }
+	inline void Add( MSG_Name name )				{ m_bits[name >> 5] |= 1u << ( name & 31 ); }
+	inline void AddAny( void )						{ m_any = true; }
+	inline bool IsRegistered( MSG_Name name )		{ return( m_any || ( m_bits[name >> 5] & ( 1u << ( name & 31 ) ) ) != 0 ); }
+
+private:
+	enum { REGISTERED_MSGS_WORDS = ( MSG_NUM + 31 ) / 32 };
+
+	unsigned int m_bits[REGISTERED_MSGS_WORDS];
+	bool m_any;						//OnAnyMsg takes everything
+};
+
+
 //Forward declarations
 class StateMachineManager;
 
@@ -252,6 +271,10 @@ public:
 	//Main state machine code stored in here
 	void Process( State_Machine_Event event, MSG_Object * msg );
 
+	//Turning this off sends every message through every scope, as if all of them had a handler
+	static void SetSkipUnregisteredMsgs( bool skip )	{ s_skipUnregisteredMsgs = skip; }
+	static bool IsSkipUnregisteredMsgs( void )			{ return( s_skipUnregisteredMsgs ); }
+
 	//Debug info
 	inline char * GetCurrentStateNameString( void )		{ return( m_currentStateNameString ); }
 	inline char * GetCurrentSubstateNameString( void )	{ return( m_currentSubstateNameString ); }
@@ -420,6 +443,13 @@ protected:
 	inline void RegisterOnMsgSubstate( void )					{ m_registeredEvents |= REGISTERED_EVENT_MESSAGE_SUBSTATE; }
 	inline void RegisterOnMsgState( void )						{ m_registeredEvents |= REGISTERED_EVENT_MESSAGE_STATE; }
 	inline void RegisterOnMsgStateMachine( void )				{ m_registeredEvents |= REGISTERED_EVENT_MESSAGE_STATEMACHINE; }
+	inline void RegisterOnMsg( int state, int substate, MSG_Name name )	{ RegisterOnMsg( state, substate ); GetRegisteredMsgs( state, substate ).Add( name ); }
+	inline void RegisterOnAnyMsg( int state, int substate )		{ RegisterOnMsg( state, substate ); GetRegisteredMsgs( state, substate ).AddAny(); }
+	inline RegisteredMsgs & GetRegisteredMsgs( int state, int substate )	{ if( state >= 0 ) { if( substate < 0 ) { return( m_stateMsgs ); } else { return( m_substateMsgs ); } } else { return( m_stateMachineMsgs ); } }
+
+	//Used for debug to name the scopes a message skips
+	inline void RegisterStateName( const char * state )			{ m_probedStateName = state; }
+	inline void RegisterSubstateName( const char * substate )	{ m_probedSubstateName = substate; }
 
 	//Used to verify proper message enums
 	inline void VerifyMessageEnum( MSG_Name name ) {}
@@ -454,6 +484,9 @@ private:
 	float m_timeOnEnterState;					//Time since state was entered
 	float m_timeOnEnterSubstate;				//Time since substate was entered
 	unsigned int m_registeredEvents;			//Whether particular events are registered
+	RegisteredMsgs m_substateMsgs;				//Messages the current substate has handlers for
+	RegisteredMsgs m_stateMsgs;					//Messages the current state has handlers for
+	RegisteredMsgs m_stateMachineMsgs;			//Messages the global state has handlers for
 	objectID m_ccMessagesToGameObject;			//A GameObject to CC messages to
 	BroadcastListContainer m_broadcastList;		//List of GameObjects to broadcast to
 	StateListContainer m_stack;					//Stack of past states (used for PopState)
@@ -464,10 +497,15 @@ private:
 	//Debug info
 	char m_currentStateNameString[MAX_STATE_NAME_SIZE];		//Current state name string
 	char m_currentSubstateNameString[MAX_STATE_NAME_SIZE];	//Current substate name string
+	const char * m_probedStateName;							//Current state name as declared
+	const char * m_probedSubstateName;						//Current substate name as declared
+
+	static bool s_skipUnregisteredMsgs;			//Whether Process skips scopes without a handler for a message
 
 	void Initialize( void );
 	virtual bool States( State_Machine_Event event, MSG_Object * msg, int state, int substate ) = 0;
 	void PerformStateChanges( void );
+	bool ProcessScope( State_Machine_Event event, MSG_Object * msg, int state, int substate, RegisteredMsgs & msgs );
 	void SendCCMsg( MSG_Name name, objectID receiver, MSG_Data& data );
 	void SendMsgDelayedToMeHelper( float delay, MSG_Name name, Scope_Rule scope, StateMachineQueue queue, MSG_Data& data, bool timer );
 
@@ -485,7 +523,7 @@ public:
 	~StateMachineManager( void );
 
 	void Update( void );
-	void SendMsg( MSG_Object msg );
+	void SendMsg( MSG_Object & msg );
 	void Process( State_Machine_Event event, MSG_Object * msg, StateMachineQueue queue );
 
 	inline StateMachine* GetStateMachine( StateMachineQueue queue )	{ if( m_stateMachineList[queue].empty() ) { return( 0 ); } else { return( m_stateMachineList[queue].back() ); } }
@@ -15,7 +15,15 @@ Terrain::Terrain( void )
   m_rPlayer(-1),
   m_cPlayer(-1),
   m_reevaluateAnalysis(false),
+  m_writtenAnalysis(-1),
+  m_analysisWallVersion(0),
   m_timerUpdatePropagation(DEFAULT_UPDATEFREQUENCY),
+  m_influenceHigh(0.0f),
+  m_influenceLow(0.0f),
+  m_influenceExtremesKnown(false),
+  m_map(0),
+  m_wallMask(0),
+  m_wallMaskWords(0),
   m_width(40)
 {
 	m_maps.push_back(Map(m_width));
@@ -47,12 +55,26 @@ void Terrain::Create( void )
 	{
 		if ((file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
 			continue;
+
+		// text maps are converted once, after that the binary twin is mapped in
+		std::wstring text = std::wstring(path) += file.cFileName;
+		std::wstring binary = text.substr(0, text.size() - 4) + MAP_FILE_EXTENSION;
+
+		WIN32_FILE_ATTRIBUTE_DATA binaryData;
+		bool useBinary = GetFileAttributesEx(binary.c_str(), GetFileExInfoStandard, &binaryData) &&
+			CompareFileTime(&binaryData.ftLastWriteTime, &file.ftLastWriteTime) >= 0;
+		if (!useBinary)
+			useBinary = Map::ConvertToBinary(text, binary);
+
 		m_maps.push_back(Map());
-		m_maps.back().Serialize(std::wstring(path) += file.cFileName);
+		m_maps.back().Serialize(useBinary ? binary : text);
 	}
 	while (FindNextFile(h, &file));
 
 	FindClose(h);
+
+	// the list grew and may have moved the bound map, point at its new place
+	BindMap(m_maps[m_nextMap]);
 }
 
 void Terrain::NextMap( void )
@@ -60,11 +82,7 @@ void Terrain::NextMap( void )
 	assert(m_maps.size() && "No maps loaded");
 	m_nextMap = ++m_nextMap % m_maps.size();
 
-	Map& map = m_maps[m_nextMap];
-	m_width = map.GetWidth();
-	m_terrain = map.GetTerrain();
-	m_terrainColor = map.GetTerrainColor();
-	m_terrainInfluenceMap = map.GetInfluenceMap();
+	BindMap(m_maps[m_nextMap]);
 	m_timerUpdatePropagation = DEFAULT_UPDATEFREQUENCY;
 
 	ResetColors();
@@ -74,6 +92,21 @@ void Terrain::NextMap( void )
 	g_database.SendMsgFromSystem(MSG_MapChange);
 }
 
+// Point the terrain at a map's data without analysis or notification.
+// Benchmarks use it to search generated maps that are not in the map list.
+void Terrain::BindMap( Map& map )
+{
+	m_map = &map;
+	m_width = map.GetWidth();
+	m_terrain = map.GetTerrain();
+	m_terrainColor = map.GetTerrainColor();
+	m_wallMask = map.GetWallMask();
+	m_wallMaskWords = map.GetWallMaskWords();
+	m_terrainInfluenceMap = map.GetInfluenceMap();
+	m_writtenAnalysis = -1;
+	m_influenceExtremesKnown = false;
+}
+
 Map *Terrain::GetCurrentMap(void) 
 { 
 	if (static_cast<unsigned>(m_nextMap) > m_maps.size()) 
@@ -164,6 +197,8 @@ void Terrain::ResetColors( void )
 void Terrain::ResetInfluenceMap( void )
 {
 	m_reevaluateAnalysis = true;
+	m_writtenAnalysis = -1;
+	m_influenceExtremesKnown = false;
 
 	for( int r=0; r<m_width; r++ )
 	{
@@ -261,6 +296,14 @@ void Terrain::DrawDebugVisualization( IDirect3DDevice9* pd3dDevice )
 
 void Terrain::Analyze( void )
 {
+	if (g_blackboard.GetTerrainAnalysisFlag() && m_map->GetWallVersion() != m_analysisWallVersion)
+	{	//Walls were edited, patch what depends on them
+		if (g_blackboard.GetTerrainAnalysisType() <= TerrainAnalysis_VisibleToPlayer)
+			m_reevaluateAnalysis = true;
+		else
+			ClearEditedWalls();
+	}
+
 	if(m_reevaluateAnalysis)
 	{
 		m_reevaluateAnalysis = false;
@@ -296,11 +339,35 @@ void Terrain::Analyze( void )
 				ResetInfluenceMap();
 				break;
 		}
+		m_analysisWallVersion = m_map->GetWallVersion();
 
 		g_clock.StopStopwatchAnalysis();
 	}
 }
 
+// Influence never rests on a wall. Walls placed since the last analysis are
+// zeroed right away rather than left to the next propagation.
+void Terrain::ClearEditedWalls(void)
+{
+	std::vector<int> tiles;
+	if (m_map->GetWallChanges(m_analysisWallVersion, tiles))
+	{
+		for (size_t i = 0; i < tiles.size(); ++i)
+			if (IsWall(tiles[i] / m_width, tiles[i] % m_width))
+				m_terrainInfluenceMap[tiles[i] / m_width][tiles[i] % m_width] = 0.0f;
+	}
+	else
+	{
+		for (int r = 0; r < m_width; ++r)
+			for (int c = 0; c < m_width; ++c)
+				if (IsWall(r, c))
+					m_terrainInfluenceMap[r][c] = 0.0f;
+	}
+
+	m_analysisWallVersion = m_map->GetWallVersion();
+	m_influenceExtremesKnown = false;
+}
+
 void Terrain::SetTerrainAnalysis(void)
 {
 	m_reevaluateAnalysis = true;
@@ -310,6 +377,8 @@ void Terrain::SetTerrainAnalysis(void)
 
 void Terrain::ClearTerrainAnalysis(void)
 {
+	m_writtenAnalysis = -1;
+	m_influenceExtremesKnown = false;
 	for (int r = 0; r<m_width; r++)
 	{
 		for (int c = 0; c<m_width; c++)
@@ -382,6 +451,8 @@ void Terrain::InitFogOfWar()
 		for (int j = 0; j < m_width; ++j)
 			if (m_terrain[i][j] == TILE_WALL)
 				m_terrain[i][j] = TILE_WALL_INVISIBLE;
+
+	m_map->WallsChanged();
 }
 
 void Terrain::ClearFogOfWar()
@@ -390,12 +461,15 @@ void Terrain::ClearFogOfWar()
 		for (int j = 0; j < m_width; ++j)
 			if (m_terrain[i][j] == TILE_WALL_INVISIBLE)
 				m_terrain[i][j] = TILE_WALL;
+
+	m_map->WallsChanged();
 }
 
 void Terrain::InitialOccupancyMap(int row, int col, float value)
 {
 	m_terrainInfluenceMap[row][col] = value;
 	m_reevaluateAnalysis = false;
+	m_influenceExtremesKnown = false;
 }
 
 void Terrain::UpdateOccupancyMap(void)
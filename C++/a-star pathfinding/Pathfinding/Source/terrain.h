@@ -32,13 +32,16 @@ public:
 
 	void Create(void);
 	void NextMap(void);
+	void BindMap(Map& map);
 	int GetMapIndex(void)					{ return(m_nextMap); }
 	Map *GetCurrentMap(void);
+	inline Map *GetMap(void)				{ return(m_map); }
 	inline size_t NumberOfMaps(void)		{ return m_maps.size(); }
 
 	D3DXVECTOR3 GetCoordinates(int r, int c);
 	bool GetRowColumn(D3DXVECTOR3* pos, int* r, int* c);
-	inline bool IsWall(int r, int c)		{ return(m_terrain[r][c] == TILE_WALL); }
+	inline bool IsWall(int r, int c)		{ return(((m_wallMask[r * m_wallMaskWords + (c >> 5)] >> (c & 31)) & 1) != 0); }
+	inline JumpDistances** GetJumpDistances(void)	{ return(m_map->GetJumpDistances()); }
 
 	bool IsClearPath(int r0, int c0, int r1, int c1);
 
@@ -49,7 +52,7 @@ public:
 
 	void Analyze(void);
 	void SetTerrainAnalysis(void);
-	inline void SetInfluenceMapValue(int r, int c, float value) { m_terrainInfluenceMap[r][c] = value; }
+	inline void SetInfluenceMapValue(int r, int c, float value) { m_terrainInfluenceMap[r][c] = value; m_influenceExtremesKnown = false; }
 	inline float GetInfluenceMapValue(int r, int c) { return m_terrainInfluenceMap[r][c]; }
 	void ResetInfluenceMap(void);
 
@@ -75,10 +78,13 @@ protected:
 	MapList m_maps;
 
 	// Parameters for current map
+	Map* m_map;
 	int m_width;
 	Tile** m_terrain;
 	DebugDrawingColor** m_terrainColor;
 	float** m_terrainInfluenceMap;
+	const unsigned int* m_wallMask;
+	int m_wallMaskWords;
 
 	bool m_reevaluateAnalysis;
 	int m_rPlayer, m_cPlayer;
@@ -86,13 +92,27 @@ protected:
 
 	float m_timerUpdatePropagation;
 
+	// extremes of the influence map as the last propagation left it
+	float m_influenceHigh, m_influenceLow;
+	bool m_influenceExtremesKnown;
+
+	WallDistance m_wallDistance;
+	FieldOfView m_fieldOfView;
+	std::vector<int> m_visibleTiles;	// tiles the player sees, filled by m_fieldOfView
+	int m_writtenAnalysis;		// analysis the influence map holds, patched after wall edits, -1 for none
+	unsigned int m_analysisWallVersion;	// wall version the last analysis ran against
+
 	void AnalyzeOpennessClosestWall(void);
 	void AnalyzeVisibility(void);
 	void AnalyzeVisibleToPlayer(void);
 	void AnalyzeSearch(void);
 	void ClearTerrainAnalysis(void);
+	void ClearEditedWalls(void);
 
 	float ClosestWall(int row, int col);
+	bool IsVisible(const VisibilitySet* visibility, int r0, int c0, int r1, int c1);
+	void WriteOpennessRow(int row);
+	void WriteVisibilityTile(const VisibilitySet* visibility, int r, int c);
 	bool LineIntersect(float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4);
 	float Lerp(float num1, float num2, float t);
 };
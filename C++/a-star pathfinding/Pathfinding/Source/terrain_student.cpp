@@ -9,40 +9,163 @@
 */
 
 #include <Stdafx.h>
+#include <algorithm>
+#include <emmintrin.h>
 
+// Constants for one propagation pass over the influence map
+struct PropagationPass
+{
+	float orthogonal;	// neighbor influence kept one tile away
+	float diagonal;		// and a diagonal away
+	float growing;
+	bool negative;		// negative influence spreads too, otherwise it is ignored
+	int stride;			// floats from one influence row to the next
+};
+
+// Of two influences, the one to keep: the largest, or the largest in size
+// when negative influence counts. Earlier candidates win ties.
+static inline float Strongest(float best, float candidate, bool negative)
+{
+	if (!negative)
+		return (std::max)(best, candidate);
 
-float Terrain::ClosestWall(int row, int col)
+	return (fabsf(candidate) > fabsf(best)) ? candidate : best;
+}
+
+static inline __m128 Strongest(__m128 best, __m128 candidate, bool negative)
 {
-	// TODO: Helper function for the Terrain Analysis project.
+	if (!negative)
+		return _mm_max_ps(best, candidate);
 
-	// For each tile, check the distance with every wall of the map.
-	// Return the distance to the closest wall or side.
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	__m128 stronger = _mm_cmpgt_ps(_mm_andnot_ps(sign, candidate), _mm_andnot_ps(sign, best));
+	return _mm_or_ps(_mm_and_ps(stronger, candidate), _mm_andnot_ps(stronger, best));
+}
+
+// One row of the propagation from source into target. The rows above and
+// below are a stride away and a zero border surrounds the map, so the
+// neighbors need no bounds checks. Walls are held at zero.
+static void PropagateRow(const float* source, float* target, const Tile* tiles, int width,
+	const PropagationPass& pass, float& high, float& low)
+{
+	static_assert(sizeof(Tile) == sizeof(int), "tiles are compared four at a time as ints");
+
+	const float* above = source - pass.stride;
+	const float* below = source + pass.stride;
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 orthogonal = _mm_set1_ps(pass.orthogonal);
+	const __m128 diagonal = _mm_set1_ps(pass.diagonal);
+	const __m128 growing = _mm_set1_ps(pass.growing);
+	const __m128 keeping = _mm_set1_ps(1.0f - pass.growing);
+	const __m128i wall = _mm_set1_epi32(TILE_WALL);
+
+	__m128 highs = zero;
+	__m128 lows = zero;
+
+	int c = 0;
+	for (; c + 4 <= width; c += 4)
+	{
+		__m128 best = zero;
+		best = Strongest(best, _mm_mul_ps(_mm_loadu_ps(above + c - 1), diagonal), pass.negative);
+		best = Strongest(best, _mm_mul_ps(_mm_load_ps(above + c), orthogonal), pass.negative);
+		best = Strongest(best, _mm_mul_ps(_mm_loadu_ps(above + c + 1), diagonal), pass.negative);
+		best = Strongest(best, _mm_mul_ps(_mm_loadu_ps(source + c - 1), orthogonal), pass.negative);
+		best = Strongest(best, _mm_mul_ps(_mm_loadu_ps(source + c + 1), orthogonal), pass.negative);
+		best = Strongest(best, _mm_mul_ps(_mm_loadu_ps(below + c - 1), diagonal), pass.negative);
+		best = Strongest(best, _mm_mul_ps(_mm_load_ps(below + c), orthogonal), pass.negative);
+		best = Strongest(best, _mm_mul_ps(_mm_loadu_ps(below + c + 1), diagonal), pass.negative);
+
+		__m128 current = _mm_load_ps(source + c);
+		if (!pass.negative)
+			current = _mm_max_ps(current, zero);
+
+		__m128 value = _mm_add_ps(_mm_mul_ps(keeping, current), _mm_mul_ps(growing, best));
+		__m128 walls = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tiles + c)), wall));
+		value = _mm_andnot_ps(walls, value);
+
+		_mm_store_ps(target + c, value);
+		highs = _mm_max_ps(highs, value);
+		lows = _mm_min_ps(lows, value);
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, highs);
+	high = (std::max)((std::max)(lanes[0], lanes[1]), (std::max)(lanes[2], lanes[3]));
+	_mm_storeu_ps(lanes, lows);
+	low = (std::min)((std::min)(lanes[0], lanes[1]), (std::min)(lanes[2], lanes[3]));
+
+	// the last few tiles one at a time, in the same order
+	for (; c < width; ++c)
+	{
+		float best = 0.0f;
+		best = Strongest(best, above[c - 1] * pass.diagonal, pass.negative);
+		best = Strongest(best, above[c] * pass.orthogonal, pass.negative);
+		best = Strongest(best, above[c + 1] * pass.diagonal, pass.negative);
+		best = Strongest(best, source[c - 1] * pass.orthogonal, pass.negative);
+		best = Strongest(best, source[c + 1] * pass.orthogonal, pass.negative);
+		best = Strongest(best, below[c - 1] * pass.diagonal, pass.negative);
+		best = Strongest(best, below[c] * pass.orthogonal, pass.negative);
+		best = Strongest(best, below[c + 1] * pass.diagonal, pass.negative);
+
+		float current = pass.negative ? source[c] : (std::max)(source[c], 0.0f);
+		float value = (tiles[c] == TILE_WALL) ? 0.0f : (1.0f - pass.growing) * current + pass.growing * best;
+
+		target[c] = value;
+		high = (std::max)(high, value);
+		low = (std::min)(low, value);
+	}
+}
 
 
-	// WRITE YOUR CODE HERE
+float Terrain::ClosestWall(int row, int col)
+{
+	// Distance to the closest wall or side, read off the wall distance
+	// transform instead of checking the tile against every wall.
 
+	std::vector<int> rows;
+	m_wallDistance.Update(*m_map, rows);
 
-	return 0.0f;	//REPLACE THIS
+	return sqrtf(static_cast<float>(m_wallDistance.GetSquaredDistance(row, col)));
 }
 
 void Terrain::AnalyzeOpennessClosestWall(void)
 {
-	// TODO: Implement this for the Terrain Analysis project.
-
 	// Mark every square on the terrain (m_terrainInfluenceMap[r][c]) with
 	// the value 1/(d*d), where d is the distance to the closest wall in 
 	// row/column grid space.
 	// Edges of the map count as walls!
+	//
+	// The squared distances come straight from the wall distance transform.
+	// After wall edits only the rows they changed are written again.
+
+	std::vector<int> rows;
+	if (!m_wallDistance.Update(*m_map, rows) || m_writtenAnalysis != TerrainAnalysis_OpennessClosestWall)
+	{
+		for (int r = 0; r < m_width; ++r)
+			WriteOpennessRow(r);
+	}
+	else
+	{
+		for (size_t i = 0; i < rows.size(); ++i)
+			WriteOpennessRow(rows[i]);
+	}
+	m_writtenAnalysis = TerrainAnalysis_OpennessClosestWall;
+}
 
-	// WRITE YOUR CODE HERE
-
-
+void Terrain::WriteOpennessRow(int row)
+{
+	for (int c = 0; c < m_width; ++c)
+	{
+		if (IsWall(row, c))
+			m_terrainInfluenceMap[row][c] = 0.0f;
+		else
+			m_terrainInfluenceMap[row][c] = 1.0f / m_wallDistance.GetSquaredDistance(row, c);
+	}
 }
 
 void Terrain::AnalyzeVisibility(void)
 {
-	// TODO: Implement this for the Terrain Analysis project.
-
 	// Mark every square on the terrain (m_terrainInfluenceMap[r][c]) with
 	// the number of grid squares (that are visible to the square in question)
 	// divided by 160 (a magic number that looks good). Cap the value at 1.0.
@@ -50,17 +173,53 @@ void Terrain::AnalyzeVisibility(void)
 	// Two grid squares are visible to each other if a line between 
 	// their centerpoints doesn't intersect the four boundary lines
 	// of every walled grid square. Put this code in IsClearPath().
+	//
+	// The map's visibility set holds every pair already, so a count is a
+	// popcount of the square's row. Maps too large for a set walk the lines.
+	// After wall edits only the squares whose row the set patched are counted
+	// again, the rest see just what they saw before.
+
+	const VisibilitySet* visibility = m_map->GetVisibility();
+
+	std::vector<int> tiles;
+	if (!visibility || m_writtenAnalysis != TerrainAnalysis_Visibility || !visibility->GetChangedTiles(m_analysisWallVersion, tiles))
+	{
+		for (int r = 0; r < m_width; ++r)
+			for (int c = 0; c < m_width; ++c)
+				WriteVisibilityTile(visibility, r, c);
+	}
+	else
+	{
+		for (size_t i = 0; i < tiles.size(); ++i)
+			WriteVisibilityTile(visibility, tiles[i] / m_width, tiles[i] % m_width);
+	}
+	m_writtenAnalysis = TerrainAnalysis_Visibility;
+}
 
-
-	// WRITE YOUR CODE HERE
-
-
+void Terrain::WriteVisibilityTile(const VisibilitySet* visibility, int r, int c)
+{
+	if (IsWall(r, c))
+	{
+		m_terrainInfluenceMap[r][c] = 0.0f;
+		return;
+	}
+
+	int count = 0;
+	if (visibility)
+		count = visibility->CountVisible(r, c);
+	else
+	{
+		for (int r1 = 0; r1 < m_width; ++r1)
+			for (int c1 = 0; c1 < m_width; ++c1)
+				if ((r1 != r || c1 != c) && IsClearPath(r, c, r1, c1))
+					++count;
+	}
+
+	m_terrainInfluenceMap[r][c] = (std::min)(count / 160.0f, 1.0f);
 }
 
 void Terrain::AnalyzeVisibleToPlayer(void)
 {
-	// TODO: Implement this for the Terrain Analysis project.
-
 	// For every square on the terrain (m_terrainInfluenceMap[r][c])
 	// that is visible to the player square, mark it with 1.0.
 	// For all non 1.0 squares that are visible to, and next to 1.0 squares,
@@ -70,16 +229,46 @@ void Terrain::AnalyzeVisibleToPlayer(void)
 	// their centerpoints doesn't intersect the four boundary lines
 	// of every walled grid square. Put this code in IsClearPath().
 
-
-	// WRITE YOUR CODE HERE
-
-
+	if (m_rPlayer < 0 || m_cPlayer < 0)
+		return;
+
+	const VisibilitySet* visibility = m_map->GetVisibility();
+
+	// one shadowcasting sweep finds what the player sees
+	m_fieldOfView.Compute(*m_map, m_rPlayer, m_cPlayer, m_visibleTiles);
+
+	for (int r = 0; r < m_width; ++r)
+		for (int c = 0; c < m_width; ++c)
+			m_terrainInfluenceMap[r][c] = 0.0f;
+	for (size_t i = 0; i < m_visibleTiles.size(); ++i)
+		m_terrainInfluenceMap[m_visibleTiles[i] / m_width][m_visibleTiles[i] % m_width] = 1.0f;
+
+	for (int r = 0; r < m_width; ++r)
+	{
+		for (int c = 0; c < m_width; ++c)
+		{
+			if (m_terrainInfluenceMap[r][c] == 1.0f || IsWall(r, c))
+				continue;
+
+			for (int dr = -1; dr <= 1; ++dr)
+			{
+				for (int dc = -1; dc <= 1; ++dc)
+				{
+					int rn = r + dr;
+					int cn = c + dc;
+					if (rn < 0 || rn >= m_width || cn < 0 || cn >= m_width)
+						continue;
+
+					if (m_terrainInfluenceMap[rn][cn] == 1.0f && IsVisible(visibility, rn, cn, r, c))
+						m_terrainInfluenceMap[r][c] = 0.5f;
+				}
+			}
+		}
+	}
 }
 
 void Terrain::AnalyzeSearch(void)
 {
-	// TODO: Implement this for the Terrain Analysis project.
-
 	// For every square on the terrain (m_terrainInfluenceMap[r][c])
 	// that is visible by the player square, mark it with 1.0.
 	// Otherwise, don't change the value (because it will get
@@ -92,34 +281,36 @@ void Terrain::AnalyzeSearch(void)
 	// their centerpoints doesn't intersect the four boundary lines
 	// of every walled grid square. Put this code in IsClearPath().
 
+	if (m_rPlayer < 0 || m_cPlayer < 0)
+		return;
 
-	// WRITE YOUR CODE HERE
+	// cosine of the angle off the facing at least -0.1, a tad over 180 degrees
+	m_fieldOfView.Compute(*m_map, m_rPlayer, m_cPlayer, m_dirPlayer.x, m_dirPlayer.z, -0.1f, m_visibleTiles);
 
+	for (size_t i = 0; i < m_visibleTiles.size(); ++i)
+		m_terrainInfluenceMap[m_visibleTiles[i] / m_width][m_visibleTiles[i] % m_width] = 1.0f;
+}
 
+bool Terrain::IsVisible(const VisibilitySet* visibility, int r0, int c0, int r1, int c1)
+{
+	// a square always sees itself, the set only holds pairs
+	if (r0 == r1 && c0 == c1)
+		return !IsWall(r0, c0);
+
+	return visibility ? visibility->IsVisible(r0, c0, r1, c1) : IsClearPath(r0, c0, r1, c1);
 }
 
 bool Terrain::IsClearPath(int r0, int c0, int r1, int c1)
 {
-	// TODO: Implement this for the Terrain Analysis project.
-
 	// Two grid squares (r0,c0) and (r1,c1) are visible to each other 
 	// if a line between their centerpoints doesn't intersect the four 
-	// boundary lines of every walled grid square. Make use of the
-	// function LineIntersect(). You should also puff out the four
-	// boundary lines by a very tiny bit so that a diagonal line passing
-	// by the corner will intersect it.
+	// boundary lines of every walled grid square. The map walks the line.
 
-
-	// WRITE YOUR CODE HERE
-
-
-	return true;	//REPLACE THIS
+	return m_map->IsClearPath(r0, c0, r1, c1);
 }
 
 void Terrain::Propagation(float decay, float growing, bool computeNegativeInfluence)
 {
-	// TODO: Implement this for the Occupancy Map project.
-
 	// computeNegativeInfluence flag is true if we need to handle two agents
 	// (have both positive and negative influence)
 	// computeNegativeInfluence flag is false if we only deal with positive
@@ -139,16 +330,37 @@ void Terrain::Propagation(float decay, float growing, bool computeNegativeInflue
 	//   Store the result to the temp layer
 	//
 	// Store influence value from temp layer
-
-	// WRITE YOUR CODE HERE
-
-
+	//
+	// The map's temp layer is the temp layer and is swapped in afterwards.
+	// Rows are spread over the analysis workers, four tiles at a time, and
+	// the extremes NormalizeOccupancyMap needs are gathered on the way.
+
+	PropagationPass pass;
+	pass.orthogonal = expf(-decay);
+	pass.diagonal = expf(-decay * sqrtf(2.0f));
+	pass.growing = growing;
+	pass.negative = computeNegativeInfluence;
+	pass.stride = m_map->GetInfluenceStride();
+
+	float** target = m_map->GetInfluenceTemp();
+	std::vector<float> highs(m_width);
+	std::vector<float> lows(m_width);
+
+	JobPool::GetAnalysisPool().Run(m_width, [&](unsigned, unsigned row)
+	{
+		PropagateRow(m_terrainInfluenceMap[row], target[row], m_terrain[row], m_width, pass, highs[row], lows[row]);
+	});
+
+	m_map->SwapInfluenceLayers();
+	m_terrainInfluenceMap = m_map->GetInfluenceMap();
+
+	m_influenceHigh = *std::max_element(highs.begin(), highs.end());
+	m_influenceLow = *std::min_element(lows.begin(), lows.end());
+	m_influenceExtremesKnown = true;
 }
 
 void Terrain::NormalizeOccupancyMap(bool computeNegativeInfluence)
 {
-	// TODO: Implement this for the Occupancy Map project.
-
 	// divide all tiles with maximum influence value, so the range of the
 	// influence is kept in [0,1]
 	// if we need to handle negative influence value, divide all positive
@@ -161,7 +373,31 @@ void Terrain::NormalizeOccupancyMap(bool computeNegativeInfluence)
 	// computeNegativeInfluence flag is false if we only deal with positive
 	// influence, ignore negative influence 
 
-	// WRITE YOUR CODE HERE
-
-
+	// right after a propagation its extremes are already known
+	if (!m_influenceExtremesKnown)
+	{
+		m_influenceHigh = 0.0f;
+		m_influenceLow = 0.0f;
+		for (int r = 0; r < m_width; ++r)
+		{
+			for (int c = 0; c < m_width; ++c)
+			{
+				m_influenceHigh = (std::max)(m_influenceHigh, m_terrainInfluenceMap[r][c]);
+				m_influenceLow = (std::min)(m_influenceLow, m_terrainInfluenceMap[r][c]);
+			}
+		}
+	}
+	m_influenceExtremesKnown = false;
+
+	float positiveScale = (m_influenceHigh > 0.0f) ? 1.0f / m_influenceHigh : 1.0f;
+	float negativeScale = (computeNegativeInfluence && m_influenceLow < 0.0f) ? -1.0f / m_influenceLow : 0.0f;
+
+	for (int r = 0; r < m_width; ++r)
+	{
+		for (int c = 0; c < m_width; ++c)
+		{
+			float& value = m_terrainInfluenceMap[r][c];
+			value *= (value > 0.0f) ? positiveScale : negativeScale;
+		}
+	}
 }
@@ -10,6 +10,12 @@
 
 #include <Stdafx.h>
 
+//Objects found by radius queries, kept to reuse the storage, one list per
+//thread as phased updates query from the workers. A query started from a
+//message handler stacks its results on top of those of the query it
+//interrupted and drops them again when it's done.
+static thread_local dbCompositionList s_inRadius;
+
 Trigger::Trigger( objectID owner, objectID attached, D3DXVECTOR2 pos, float radius, MSG_Name msgToOwner, MSG_Name msgToTarget, float periodicDelay, bool persistAfterFiring, unsigned int affectedType, float expirationTime )
 : m_owner( owner ),
   m_attached( attached ),
@@ -65,9 +71,6 @@ void TriggerSystem::Update( void )
 				continue;
 			}
 
-			dbCompositionList list;
-			g_database.ComposeList( list, (*trigger)->m_affectedType );
-		
 			if( (*trigger)->m_attached != INVALID_OBJECT_ID )
 			{	//Set dynamic position
 				GameObject* attachedGameObject = g_database.Find( (*trigger)->m_attached );
@@ -79,30 +82,29 @@ void TriggerSystem::Update( void )
 				(*trigger)->m_pos = attachedGameObject->GetBody().GetPos();
 			}
 
-			for( dbCompositionList::iterator i = list.begin(); i != list.end(); ++i )
-			{
-				GameObject* targetGameObject = (*i);
-				D3DXVECTOR3 targetPos = targetGameObject->GetBody().GetPos();
-				D3DXVECTOR3 triggerPos = (*trigger)->m_pos;
-
-				float distSquared = (targetPos.x * triggerPos.x) + (targetPos.y * triggerPos.y) + (targetPos.z * triggerPos.z);
-				if( distSquared <= (*trigger)->m_radiusSquared )
-				{	//Collision
-					if( MSG_INVALID != (*trigger)->m_msgToTarget )
-					{	//Send message to Target
-						g_database.SendMsgFromSystem( targetGameObject, (*trigger)->m_msgToTarget );
-					}
-					if( MSG_INVALID != (*trigger)->m_msgToOwner )
-					{	//Send message to Owner
-						g_database.SendMsgFromSystem( ownerGameObject, (*trigger)->m_msgToOwner );
-					}
-
-					if( !(*trigger)->m_persistAfterFiring )
-					{
-						(*trigger)->m_markedForDeletion = true;
-					}
+			//Only objects inside the trigger come back, on top of s_inRadius
+			unsigned int first = static_cast<unsigned int>( s_inRadius.size() );
+			g_database.ComposeListInRadius( s_inRadius, (*trigger)->m_pos, sqrtf( (*trigger)->m_radiusSquared ), (*trigger)->m_affectedType );
+			unsigned int last = static_cast<unsigned int>( s_inRadius.size() );
+
+			for( unsigned int i = first; i < last; ++i )
+			{	//Collision
+				GameObject* targetGameObject = s_inRadius[i];
+				if( MSG_INVALID != (*trigger)->m_msgToTarget )
+				{	//Send message to Target
+					g_database.SendMsgFromSystem( targetGameObject, (*trigger)->m_msgToTarget );
+				}
+				if( MSG_INVALID != (*trigger)->m_msgToOwner )
+				{	//Send message to Owner
+					g_database.SendMsgFromSystem( ownerGameObject, (*trigger)->m_msgToOwner );
+				}
+
+				if( !(*trigger)->m_persistAfterFiring )
+				{
+					(*trigger)->m_markedForDeletion = true;
 				}
 			}
+			s_inRadius.resize( first );
 
 			//Set the next time this trigger should run
 			(*trigger)->m_nextTimeToRun = (*trigger)->m_periodicDelay + currentTime;
@@ -121,24 +123,20 @@ void TriggerSystem::SendMsgRadius( float radius, float delay, MSG_Name name, obj
 	if( senderGameObject != INVALID_OBJECT_ID )
 	{	//The sender is a valid game object
 		D3DXVECTOR3 senderPos = senderGameObject->GetBody().GetPos();
-		float radiusSquared = radius * radius;	//Precompute the radius squared
 
-		dbCompositionList list;
-		g_database.ComposeList( list, targetGameObjectType );
+		//Only objects within the radius come back, from the cells around the sender
+		unsigned int first = static_cast<unsigned int>( s_inRadius.size() );
+		g_database.ComposeListInRadius( s_inRadius, senderPos, radius, targetGameObjectType );
+		unsigned int last = static_cast<unsigned int>( s_inRadius.size() );
 
-		for( dbCompositionList::iterator i = list.begin(); i != list.end(); ++i )
-		{	//Loop through all game objects of a given type
-			GameObject* targetGameObject = (*i);
+		for( unsigned int i = first; i < last; ++i )
+		{	//Loop through all game objects of a given type in range
+			GameObject* targetGameObject = s_inRadius[i];
 			if(targetGameObject != senderGameObject)
-			{	//Not the sender
-				D3DXVECTOR3 targetPos = targetGameObject->GetBody().GetPos();
-				float distSquared = (targetPos.x * senderPos.x) + (targetPos.y * senderPos.y) + (targetPos.z * senderPos.z);
-
-				if( distSquared <= radiusSquared && targetGameObject != senderGameObject)
-				{	//Close enough - send the message
-					g_msgroute.SendMsg( delay, name, SYSTEM_OBJECT_ID, targetGameObject->GetID(), SCOPE_TO_STATE_MACHINE, 0, STATE_MACHINE_QUEUE_ALL, data, false, false );
-				}
+			{	//Not the sender - send the message
+				g_msgroute.SendMsg( delay, name, SYSTEM_OBJECT_ID, targetGameObject->GetID(), SCOPE_TO_STATE_MACHINE, 0, STATE_MACHINE_QUEUE_ALL, data, false, false );
 			}
 		}
+		s_inRadius.resize( first );
 	}
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
  */
 
 #include <Stdafx.h>
+#include "PathRequestQueue.h"
+#include "SearchScheduler.h"
 
 //#define UNIT_TESTING
 
@@ -133,6 +135,10 @@ void World::PostInitialize()
 void World::Update()
 {
 	g_clock.MarkTimeThisTick();
+
+	// paths requested last frame are ready before any agent updates
+	g_path_requests.Update();
+	g_search_scheduler.Update();
 	g_database.Update();
 }
 